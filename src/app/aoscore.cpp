@@ -55,9 +55,14 @@ void AosCore::Init(const std::string& configFile)
     err = mIAMClientPermissions.Init(mConfig.mIAMProtectedServerURL, mConfig.mCertStorage, mIAMClientPublic);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize permissions IAM client");
 
+    // Initialize device registry
+
+    err = mDeviceRegistry.Init();
+    AOS_ERROR_CHECK_AND_THROW(err, "can't initialize device registry");
+
     // Initialize host device manager
 
-    err = mHostDeviceManager.Init();
+    err = mHostDeviceManager.Init(mDeviceRegistry);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize host device manager");
 
     // Initialize resource manager
@@ -84,7 +89,16 @@ void AosCore::Init(const std::string& configFile)
     err = mNamespaceManager.Init(mNetworkInterfaceManager);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize namespace manager");
 
-    err = mCNI.Init(mExec);
+    err = mBandwidthPlugin.Init(mTrafficControl);
+    AOS_ERROR_CHECK_AND_THROW(err, "can't initialize bandwidth plugin");
+
+    err = mNativeExec.RegisterPlugin("bandwidth", mBandwidthPlugin);
+    AOS_ERROR_CHECK_AND_THROW(err, "can't register bandwidth plugin");
+
+    err = mNativeExec.Init(mExec, mConfig.mCNIConfig.mNativePlugins);
+    AOS_ERROR_CHECK_AND_THROW(err, "can't initialize native exec");
+
+    err = mCNI.Init(mNativeExec);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize CNI");
 
     err = mNetworkManager.Init(mDatabase, mCNI, mTrafficMonitor, mNamespaceManager, mNetworkInterfaceManager,
@@ -120,7 +134,8 @@ void AosCore::Init(const std::string& configFile)
 
     // Initialize image handler
 
-    err = mImageHandler.Init(mCryptoProvider, mLayersSpaceAllocator, mServicesSpaceAllocator, mOCISpec);
+    err = mImageHandler.Init(mCryptoProvider, mLayersSpaceAllocator, mServicesSpaceAllocator, mOCISpec, 0,
+        mConfig.mImageHandlerConfig);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize image handler");
 
     // Initialize service manager
@@ -140,6 +155,11 @@ void AosCore::Init(const std::string& configFile)
     err = mRunner.Init(mLauncher);
     AOS_ERROR_CHECK_AND_THROW(err, "can't initialize runner");
 
+    // Initialize runtime
+
+    err = mRuntime.Init(mConfig.mRuntimeConfig, &mDeviceRegistry);
+    AOS_ERROR_CHECK_AND_THROW(err, "can't initialize runtime");
+
     // Initialize launcher
 
     err = mLauncher.Init(mConfig.mLauncherConfig, mIAMClientPublic, mServiceManager, mLayerManager, mResourceManager,
@@ -166,7 +186,16 @@ void AosCore::Init(const std::string& configFile)
 
 void AosCore::Start()
 {
-    auto err = mRunner.Start();
+    auto err = mDeviceRegistry.Start();
+    AOS_ERROR_CHECK_AND_THROW(err, "can't start device registry");
+
+    mCleanupManager.AddCleanup([this]() {
+        if (auto err = mDeviceRegistry.Stop(); !err.IsNone()) {
+            LOG_ERR() << "Can't stop device registry: err=" << err;
+        }
+    });
+
+    err = mRunner.Start();
     AOS_ERROR_CHECK_AND_THROW(err, "can't start runner");
 
     mCleanupManager.AddCleanup([this]() {
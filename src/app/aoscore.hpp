@@ -23,8 +23,10 @@
 #include "logger/logger.hpp"
 #include "logprovider/logprovider.hpp"
 #include "monitoring/resourceusageprovider.hpp"
+#include "networkmanager/bandwidth.hpp"
 #include "networkmanager/cni.hpp"
 #include "networkmanager/exec.hpp"
+#include "networkmanager/nativeexec.hpp"
 #include "networkmanager/trafficmonitor.hpp"
 #include "ocispec/ocispec.hpp"
 #include "resourcemanager/resourcemanager.hpp"
@@ -93,8 +95,11 @@ private:
     common::jsonprovider::JSONProvider                   mJSONProvider;
     common::logger::Logger                               mLogger;
     common::oci::OCISpec                                 mOCISpec;
+    sm::cni::BandwidthPlugin                             mBandwidthPlugin;
     sm::cni::CNI                                         mCNI;
     sm::cni::Exec                                        mExec;
+    sm::cni::NativeExec                                  mNativeExec;
+    sm::cni::NetlinkTrafficControl                       mTrafficControl;
     sm::database::Database                               mDatabase;
     sm::image::ImageHandler                              mImageHandler;
     sm::launcher::Launcher                               mLauncher;
@@ -107,6 +112,7 @@ private:
     common::network::IPTables                            mIPTables;
     aos::common::network::NamespaceManager               mNamespaceManager;
     aos::common::network::InterfaceManager               mNetworkInterfaceManager;
+    sm::resourcemanager::DeviceRegistry                  mDeviceRegistry;
     sm::resourcemanager::HostDeviceManager               mHostDeviceManager;
     sm::resourcemanager::ResourceManager                 mResourceManager;
     sm::runner::Runner                                   mRunner;
@@ -194,6 +194,39 @@ void ParseLauncherConfig(const common::utils::CaseInsensitiveObjectWrapper& obje
     }
 }
 
+void ParseRuntimeConfig(const common::utils::CaseInsensitiveObjectWrapper& object, const std::string& workingDir,
+    sm::launcher::RuntimeConfig& config)
+{
+    config.mWorkingDir = object.GetValue<std::string>("workingDir", JoinPath(workingDir, "runtime"));
+
+    const auto rootFSUpper = object.GetValue<std::string>("rootfsUpper", "none");
+
+    if (rootFSUpper == "none") {
+        config.mRootFSUpper = sm::launcher::RootFSUpperType::eNone;
+    } else if (rootFSUpper == "tmpfs") {
+        config.mRootFSUpper = sm::launcher::RootFSUpperType::eTmpfs;
+    } else if (rootFSUpper == "volatile") {
+        config.mRootFSUpper = sm::launcher::RootFSUpperType::eVolatile;
+    } else {
+        AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "invalid rootfsUpper value");
+    }
+
+    config.mPrefetchDir = object.GetValue<std::string>("prefetchDir", "");
+}
+
+void ParseImageHandlerConfig(
+    const common::utils::CaseInsensitiveObjectWrapper& object, sm::image::ImageHandlerConfig& config)
+{
+    config.mIDMappedMounts        = object.GetValue<bool>("idMappedMounts", false);
+    config.mFileStoreDir          = object.GetValue<std::string>("fileStoreDir", "");
+    config.mMaxConcurrentInstalls = object.GetValue<size_t>("maxConcurrentInstalls", 0);
+}
+
+void ParseCNIConfig(const common::utils::CaseInsensitiveObjectWrapper& object, sm::cni::CNIConfig& config)
+{
+    config.mNativePlugins = common::utils::GetArrayValue<std::string>(object, "nativePlugins");
+}
+
 void ParseSMClientConfig(const common::utils::CaseInsensitiveObjectWrapper& object, smclient::Config& config)
 {
     config.mCertStorage = object.GetValue<std::string>("certStorage").c_str();
@@ -249,10 +282,16 @@ Error ParseConfig(const std::string& filename, Config& config)
         auto logging       = object.Has("logging") ? object.GetObject("logging") : empty;
         auto journalAlerts = object.Has("journalAlerts") ? object.GetObject("journalAlerts") : empty;
         auto migration     = object.Has("migration") ? object.GetObject("migration") : empty;
+        auto runtime       = object.Has("runtime") ? object.GetObject("runtime") : empty;
+        auto imageHandler  = object.Has("imageHandler") ? object.GetObject("imageHandler") : empty;
+        auto cni           = object.Has("cni") ? object.GetObject("cni") : empty;
 
         ParseLoggingConfig(logging, config.mLogging);
         ParseJournalAlertsConfig(journalAlerts, config.mJournalAlerts);
         ParseMigrationConfig(migration, config.mWorkingDir, config.mMigration);
+        ParseRuntimeConfig(runtime, config.mWorkingDir, config.mRuntimeConfig);
+        ParseImageHandlerConfig(imageHandler, config.mImageHandlerConfig);
+        ParseCNIConfig(cni, config.mCNIConfig);
     } catch (const std::exception& e) {
         return common::utils::ToAosError(e);
     }
@@ -21,6 +21,9 @@
 #include <logprovider/config.hpp>
 #include <utils/time.hpp>
 
+#include "image/config.hpp"
+#include "launcher/config.hpp"
+#include "networkmanager/config.hpp"
 #include "smclient/config.hpp"
 
 namespace aos::sm::config {
@@ -50,21 +53,24 @@ struct MigrationConfig {
  * Config instance.
  */
 struct Config {
-    common::iamclient::Config   mIAMClientConfig;
-    sm::layermanager::Config    mLayerManagerConfig;
-    sm::servicemanager::Config  mServiceManagerConfig;
-    sm::launcher::Config        mLauncherConfig;
-    smclient::Config            mSMClientConfig;
-    std::string                 mCertStorage;
-    std::string                 mIAMProtectedServerURL;
-    std::string                 mWorkingDir;
-    uint32_t                    mServicesPartLimit;
-    uint32_t                    mLayersPartLimit;
-    std::string                 mNodeConfigFile;
-    monitoring::Config          mMonitoring;
-    common::logprovider::Config mLogging;
-    JournalAlertsConfig         mJournalAlerts;
-    MigrationConfig             mMigration;
+    common::iamclient::Config     mIAMClientConfig;
+    sm::layermanager::Config      mLayerManagerConfig;
+    sm::servicemanager::Config    mServiceManagerConfig;
+    sm::launcher::Config          mLauncherConfig;
+    sm::launcher::RuntimeConfig   mRuntimeConfig;
+    sm::image::ImageHandlerConfig mImageHandlerConfig;
+    sm::cni::CNIConfig            mCNIConfig;
+    smclient::Config              mSMClientConfig;
+    std::string                   mCertStorage;
+    std::string                   mIAMProtectedServerURL;
+    std::string                   mWorkingDir;
+    uint32_t                      mServicesPartLimit;
+    uint32_t                      mLayersPartLimit;
+    std::string                   mNodeConfigFile;
+    monitoring::Config            mMonitoring;
+    common::logprovider::Config   mLogging;
+    JournalAlertsConfig           mJournalAlerts;
+    MigrationConfig               mMigration;
 };
 
 /*******************************************************************************
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef IMAGE_CONFIG_HPP_
+#define IMAGE_CONFIG_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace aos::sm::image {
+
+/***
+ * Image handler configuration.
+ */
+struct ImageHandlerConfig {
+    bool        mIDMappedMounts = false;
+    std::string mFileStoreDir;
+    size_t      mMaxConcurrentInstalls = 0; // 0 means number of CPU cores
+};
+
+} // namespace aos::sm::image
+
+#endif
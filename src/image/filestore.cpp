@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utils/exception.hpp>
+
+#include "filestore.hpp"
+#include "logger/logmodule.hpp"
+
+namespace aos::sm::image {
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+FileStore::~FileStore()
+{
+    Stop();
+}
+
+Error FileStore::Init(const std::filesystem::path& storeDir, spaceallocator::SpaceAllocatorItf& spaceAllocator)
+{
+    LOG_DBG() << "Init file store: storeDir=" << storeDir.c_str();
+
+    Stop();
+
+    mStoreDir       = storeDir;
+    mSpaceAllocator = &spaceAllocator;
+
+    try {
+        std::filesystem::create_directories(mStoreDir);
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    if (auto err = Prune(); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    mStopped     = false;
+    mPruneThread = std::thread(&FileStore::ProcessPrune, this);
+
+    return ErrorEnum::eNone;
+}
+
+RetWithError<uint64_t> FileStore::Add(
+    const std::filesystem::path& path, const TarEntry& entry, const std::string& sha256, bool allowHardLink) const
+{
+    // Hard linked files share attributes, so they are stored by content and attributes
+    const auto cloneKey = sha256;
+    const auto linkKey  = sha256 + cKeySeparator + std::to_string(entry.mMode) + cKeySeparator
+        + std::to_string(entry.mUID) + cKeySeparator + std::to_string(entry.mGID) + cKeySeparator
+        + std::to_string(entry.mModTime);
+
+    std::lock_guard lock {mMutex};
+
+    try {
+        const auto clonePath = mStoreDir / cloneKey.substr(0, 2) / cloneKey;
+        const auto linkPath  = mStoreDir / linkKey.substr(0, 2) / linkKey;
+
+        // Hard links are preferred as, unlike reflinks, their usage is tracked by the link count
+        if (allowHardLink && std::filesystem::exists(linkPath) && LinkFile(linkPath, path)) {
+            return {entry.mSize, ErrorEnum::eNone};
+        }
+
+        for (const auto& source : {clonePath, linkPath}) {
+            if (std::filesystem::exists(source) && CloneFile(source, path)) {
+                return {0, ErrorEnum::eNone};
+            }
+        }
+
+        // First file with this content becomes the store source, store keeps exactly one link to it
+        const auto& storePath = allowHardLink ? linkPath : clonePath;
+
+        std::filesystem::create_directories(storePath.parent_path());
+
+        if (link(path.c_str(), storePath.c_str()) != 0) {
+            Error err(errno);
+
+            LOG_WRN() << "Can't add file to store: path=" << path.c_str() << ", err=" << err;
+
+            return {0, ErrorEnum::eNone};
+        }
+
+        if (!allowHardLink) {
+            return {0, ErrorEnum::eNone};
+        }
+
+        if (auto err = ChargeSpace(entry.mSize); !err.IsNone()) {
+            LOG_WRN() << "Can't charge store space: path=" << path.c_str() << ", err=" << err;
+
+            unlink(storePath.c_str());
+
+            return {0, ErrorEnum::eNone};
+        }
+    } catch (const std::exception& e) {
+        return {0, AOS_ERROR_WRAP(common::utils::ToAosError(e))};
+    }
+
+    return {entry.mSize, ErrorEnum::eNone};
+}
+
+Error FileStore::Prune()
+{
+    LOG_DBG() << "Prune file store";
+
+    try {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(mStoreDir)) {
+            if (!entry.is_regular_file() || entry.hard_link_count() != 1) {
+                continue;
+            }
+
+            PruneFile(entry.path());
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+bool FileStore::CloneFile(const std::filesystem::path& source, const std::filesystem::path& destination) const
+{
+    auto srcFD = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (srcFD < 0) {
+        return false;
+    }
+
+    [[maybe_unused]] auto closeSrcFD = DeferRelease(&srcFD, [](const int* fd) { close(*fd); });
+
+    auto dstFD = open(destination.c_str(), O_WRONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (dstFD < 0) {
+        return false;
+    }
+
+    [[maybe_unused]] auto closeDstFD = DeferRelease(&dstFD, [](const int* fd) { close(*fd); });
+
+    // Replaces destination blocks with blocks shared with the source. Destination inode is kept, but its times and
+    // set-ID bits are reset, so the caller applies attributes after the clone.
+    return ioctl(dstFD, FICLONE, srcFD) == 0;
+}
+
+bool FileStore::LinkFile(const std::filesystem::path& source, const std::filesystem::path& destination) const
+{
+    const auto tmpPath = destination.string() + cTmpSuffix;
+
+    if (link(source.c_str(), tmpPath.c_str()) != 0) {
+        return false;
+    }
+
+    if (rename(tmpPath.c_str(), destination.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+void FileStore::PruneFile(const std::filesystem::path& path)
+{
+    std::lock_guard lock {mMutex};
+
+    struct stat st;
+
+    // File could be linked by an install since it was found, it is checked again under the lock
+    if (lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_nlink != 1) {
+        return;
+    }
+
+    // File is used only by the store itself
+    if (unlink(path.c_str()) != 0) {
+        LOG_WRN() << "Can't remove store file: path=" << path.c_str() << ", err=" << Error(errno);
+
+        return;
+    }
+
+    if (path.filename().native().find(cKeySeparator) == std::string::npos) {
+        return;
+    }
+
+    if (auto err = mSpaceAllocator->FreeSpace(st.st_size); !err.IsNone()) {
+        LOG_WRN() << "Can't free store space: path=" << path.c_str() << ", err=" << err;
+    }
+}
+
+void FileStore::ProcessPrune()
+{
+    std::unique_lock lock {mPruneMutex};
+
+    while (!mPruneCondVar.wait_for(lock, cPrunePeriod, [this] { return mStopped; })) {
+        lock.unlock();
+
+        if (auto err = Prune(); !err.IsNone()) {
+            LOG_WRN() << "Can't prune file store: err=" << err;
+        }
+
+        lock.lock();
+    }
+}
+
+void FileStore::Stop()
+{
+    {
+        std::lock_guard lock {mPruneMutex};
+
+        mStopped = true;
+    }
+
+    mPruneCondVar.notify_all();
+
+    if (mPruneThread.joinable()) {
+        mPruneThread.join();
+    }
+}
+
+Error FileStore::ChargeSpace(uint64_t size) const
+{
+    auto [space, err] = mSpaceAllocator->AllocateSpace(size);
+    if (!err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    if (err = space->Accept(); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    return ErrorEnum::eNone;
+}
+
+} // namespace aos::sm::image
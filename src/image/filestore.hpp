@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FILESTORE_HPP_
+#define FILESTORE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <aos/common/spaceallocator/spaceallocator.hpp>
+#include <aos/common/tools/error.hpp>
+
+#include "tarextractor.hpp"
+
+namespace aos::sm::image {
+
+/**
+ * Content-addressed store of installed image files. Files with the same content share disk blocks: they are cloned
+ * with reflinks where the file system supports it, otherwise hard linked if the caller allows shared inodes.
+ *
+ * Hard linked content outlives the install which added it, so it is charged to the store space and released when the
+ * store keeps the only link to it. Reflinked clones are charged to their installs as shared blocks can't be tracked.
+ * Images are removed without notifying the store, so unused content is pruned on init and then periodically.
+ */
+class FileStore {
+public:
+    /**
+     * Destructor.
+     */
+    ~FileStore();
+
+    /**
+     * Initializes file store and starts periodic pruning.
+     *
+     * @param storeDir store dir, should be on the same file system as installed images.
+     * @param spaceAllocator space allocator for content shared by hard links.
+     * @return Error.
+     */
+    Error Init(const std::filesystem::path& storeDir, spaceallocator::SpaceAllocatorItf& spaceAllocator);
+
+    /**
+     * Deduplicates extracted file.
+     *
+     * @param path extracted file path.
+     * @param entry tar entry of the file.
+     * @param sha256 file content hash.
+     * @param allowHardLink allows sharing inode and its attributes with other installs.
+     * @return RetWithError<uint64_t>: size which is not charged to the install anymore.
+     */
+    RetWithError<uint64_t> Add(
+        const std::filesystem::path& path, const TarEntry& entry, const std::string& sha256, bool allowHardLink) const;
+
+    /**
+     * Removes store files which are not used by installed images anymore and releases their space. Store is walked
+     * without blocking concurrent adds.
+     *
+     * @return Error.
+     */
+    Error Prune();
+
+private:
+    static constexpr auto cTmpSuffix    = ".tmp";
+    static constexpr auto cPrunePeriod  = std::chrono::hours(1);
+    static constexpr auto cKeySeparator = '-';
+
+    bool  CloneFile(const std::filesystem::path& source, const std::filesystem::path& destination) const;
+    bool  LinkFile(const std::filesystem::path& source, const std::filesystem::path& destination) const;
+    Error ChargeSpace(uint64_t size) const;
+    void  PruneFile(const std::filesystem::path& path);
+    void  ProcessPrune();
+    void  Stop();
+
+    std::filesystem::path              mStoreDir;
+    spaceallocator::SpaceAllocatorItf* mSpaceAllocator = nullptr;
+    mutable std::mutex                 mMutex;
+    std::thread                        mPruneThread;
+    std::mutex                         mPruneMutex;
+    std::condition_variable            mPruneCondVar;
+    bool                               mStopped = false;
+};
+
+} // namespace aos::sm::image
+
+#endif
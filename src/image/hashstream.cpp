@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+
+#include "hashstream.hpp"
+
+namespace aos::sm::image {
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+HashStreamBuf::HashStreamBuf(std::istream& source)
+    : mSource(source)
+    , mBuffer(cBufferSize)
+{
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data());
+}
+
+void HashStreamBuf::AddHash(crypto::HashItf& hash)
+{
+    mHashes.push_back(&hash);
+}
+
+std::string_view HashStreamBuf::Peek(size_t size)
+{
+    if (underflow() == traits_type::eof()) {
+        return {};
+    }
+
+    return std::string_view(gptr(), std::min<size_t>(size, egptr() - gptr()));
+}
+
+Error HashStreamBuf::Drain()
+{
+    while (underflow() != traits_type::eof()) {
+        setg(mBuffer.data(), egptr(), egptr());
+    }
+
+    if (mSource.bad()) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "can't read source stream"));
+    }
+
+    return mError;
+}
+
+/***********************************************************************************************************************
+ * Protected
+ **********************************************************************************************************************/
+
+HashStreamBuf::int_type HashStreamBuf::underflow()
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if (!mError.IsNone()) {
+        return traits_type::eof();
+    }
+
+    mSource.read(mBuffer.data(), mBuffer.size());
+
+    auto size = static_cast<size_t>(mSource.gcount());
+    if (size == 0) {
+        return traits_type::eof();
+    }
+
+    for (auto hash : mHashes) {
+        if (auto err = hash->Update(Array<uint8_t>(reinterpret_cast<uint8_t*>(mBuffer.data()), size));
+            !err.IsNone()) {
+            mError = AOS_ERROR_WRAP(err);
+
+            return traits_type::eof();
+        }
+    }
+
+    mSize += size;
+
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data() + size);
+
+    return traits_type::to_int_type(*gptr());
+}
+
+} // namespace aos::sm::image
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HASHSTREAM_HPP_
+#define HASHSTREAM_HPP_
+
+#include <istream>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+#include <aos/common/crypto/crypto.hpp>
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::image {
+
+/**
+ * Input stream buffer which passes data read from the source stream to hashes and counts its size.
+ */
+class HashStreamBuf : public std::streambuf {
+public:
+    /**
+     * Constructor.
+     *
+     * @param source source stream.
+     */
+    explicit HashStreamBuf(std::istream& source);
+
+    /**
+     * Adds hash to be updated with read data.
+     *
+     * @param hash hash.
+     */
+    void AddHash(crypto::HashItf& hash);
+
+    /**
+     * Returns data at the start of the buffer without consuming it.
+     *
+     * @param size requested size.
+     * @return std::string_view: available data, may be shorter than requested.
+     */
+    std::string_view Peek(size_t size);
+
+    /**
+     * Reads the rest of the source stream.
+     *
+     * @return Error.
+     */
+    Error Drain();
+
+    /**
+     * Returns number of bytes read from the source stream.
+     *
+     * @return uint64_t.
+     */
+    uint64_t Size() const { return mSize; }
+
+    /**
+     * Returns hash update error.
+     *
+     * @return Error.
+     */
+    Error GetError() const { return mError; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    static constexpr auto cBufferSize = 64 * 1024;
+
+    std::istream&                 mSource;
+    std::vector<crypto::HashItf*> mHashes;
+    std::vector<char>             mBuffer;
+    uint64_t                      mSize  = 0;
+    Error                         mError = ErrorEnum::eNone;
+};
+
+} // namespace aos::sm::image
+
+#endif
@@ -4,23 +4,35 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <linux/fs.h>
 #include <memory>
-#include <set>
+#include <optional>
+#include <string_view>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/xattr.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
+#include <Poco/JSON/Parser.h>
+
 #include <aos/sm/image/imageparts.hpp>
 #include <utils/exception.hpp>
 #include <utils/filesystem.hpp>
 #include <utils/image.hpp>
+#include <utils/json.hpp>
 
+#include "hashstream.hpp"
 #include "imagehandler.hpp"
 #include "logger/logmodule.hpp"
+#include "readahead.hpp"
 
 namespace aos::sm::image {
 
@@ -30,80 +42,314 @@ namespace {
  * Constants
  **********************************************************************************************************************/
 
-constexpr auto cSHA256Prefix        = "sha256:";
-constexpr auto cWhiteoutPrefix      = ".wh.";
-constexpr auto cWhiteoutOpaqueDir   = ".wh..wh..opq";
-constexpr auto cBlobsFolder         = "blobs";
-constexpr auto cLayerManifestFile   = "layer.json";
-constexpr auto cServiceManifestFile = "manifest.json";
-constexpr auto cTmpRootFSDir        = "tmprootfs";
-const int      cBufferSize          = 1024 * 1024;
+constexpr auto cSHA256Prefix           = "sha256:";
+constexpr auto cWhiteoutPrefix         = ".wh.";
+constexpr auto cWhiteoutOpaqueDir      = ".wh..wh..opq";
+constexpr auto cBlobsFolder            = "blobs";
+constexpr auto cLayerManifestFile      = "layer.json";
+constexpr auto cServiceManifestFile    = "manifest.json";
+constexpr auto cTmpRootFSDir           = "tmprootfs";
+constexpr auto cOwnerXAttr             = "user.aos.owner";
+constexpr auto cDigestCacheXAttrPrefix = "user.aos.digest.";
+constexpr auto cLayerImageFile         = "layer.img";
+constexpr auto cLayerImageXAttr        = "user.aos.image";
+constexpr auto cSquashFSMagic          = "hsqs";
+constexpr auto cEROFSMagic             = "\xe2\xe1\xf5\xe0";
+const size_t   cEROFSMagicOffset       = 1024;
+const size_t   cFSImageHeaderSize      = 4096;
+const int      cBufferSize             = 1024 * 1024;
+const size_t   cReadAheadBuffers       = 4;
+const uint64_t cSpaceReserveChunk      = 16 * 1024 * 1024;
+const size_t   cSHA256HexLen           = 64;
+const size_t   cXAttrValueLen          = 256;
+constexpr auto cLayerStagingPrefix     = "layer-";
+constexpr auto cJournalSuffix          = ".journal";
+constexpr auto cDeltaFile              = "delta.json";
+
+/***********************************************************************************************************************
+ * Types
+ **********************************************************************************************************************/
+
+/**
+ * Delta service image info.
+ */
+struct DeltaInfo {
+    std::string                        mBaseDigest;
+    std::string                        mDigest;
+    std::vector<std::filesystem::path> mRemoved;
+};
 
 /***********************************************************************************************************************
  * Static
  **********************************************************************************************************************/
 
-Error OCIWhiteoutsToOverlay(const String& path, uint32_t uid, uint32_t gid)
+TarExtractor::EntryHandler OCIWhiteoutsToOverlay(const std::filesystem::path& destination, uint32_t uid, uint32_t gid)
 {
-    LOG_DBG() << "Converting OCI whiteouts to overlayfs: path=" << path;
-
-    try {
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(path.CStr())) {
-            const std::string baseName = entry.path().filename().string();
-            const std::string dirName  = entry.path().parent_path().string();
+    // OCI whiteouts are converted while entries are extracted, whiteout files themselves are extracted as well
+    return [destination, uid, gid](const TarEntry& entry, TarReader&) -> RetWithError<bool> {
+        if (entry.mType != TarEntry::Type::eFile) {
+            return {false, ErrorEnum::eNone};
+        }
 
-            if (entry.is_directory()) {
-                continue;
-            }
+        const auto path     = destination / entry.mPath;
+        const auto baseName = path.filename().native();
 
-            if (baseName == cWhiteoutOpaqueDir) {
-                if (auto res = setxattr(dirName.c_str(), "trusted.overlay.opaque", "y", 1, 0); res != 0) {
-                    return AOS_ERROR_WRAP(res);
-                }
+        if (baseName.compare(0, strlen(cWhiteoutPrefix), cWhiteoutPrefix) != 0) {
+            return {false, ErrorEnum::eNone};
+        }
 
-                continue;
+        // Parent directories are created and checked by the extractor, nothing here follows symlinks
+        if (baseName == cWhiteoutOpaqueDir) {
+            if (lsetxattr(path.parent_path().c_str(), "trusted.overlay.opaque", "y", 1, 0) != 0) {
+                return {false, AOS_ERROR_WRAP(Error(errno, "failed to set opaque dir xattr"))};
             }
 
-            if (baseName.find(cWhiteoutPrefix) == 0) {
-                auto fullPath = std::filesystem::path(dirName) / baseName.substr(strlen(cWhiteoutPrefix));
+            return {false, ErrorEnum::eNone};
+        }
 
-                if (auto res = mknod(fullPath.c_str(), S_IFCHR, 0); res != 0) {
-                    return AOS_ERROR_WRAP(res);
-                }
+        const auto whiteoutPath = path.parent_path() / baseName.substr(strlen(cWhiteoutPrefix));
 
-                if (auto res = chown(fullPath.c_str(), uid, gid); res != 0) {
-                    return AOS_ERROR_WRAP(res);
-                }
+        if (mknod(whiteoutPath.c_str(), S_IFCHR, 0) != 0) {
+            return {false, AOS_ERROR_WRAP(Error(errno, "failed to create whiteout"))};
+        }
 
-                continue;
-            }
+        if (lchown(whiteoutPath.c_str(), uid, gid) != 0) {
+            return {false, AOS_ERROR_WRAP(Error(errno, "failed to change whiteout owner"))};
         }
-    } catch (const std::exception& e) {
-        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+
+        return {false, ErrorEnum::eNone};
+    };
+}
+
+std::string GetFileRecord(const std::filesystem::path& path, const std::string& name)
+{
+    struct stat st;
+
+    if (lstat(path.c_str(), &st) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't get file status");
     }
 
-    return ErrorEnum::eNone;
+    // Content changes are reflected by size, mtime and ctime which can't be set from user space
+    return name + ":" + std::to_string(st.st_ino) + ":" + std::to_string(st.st_mode) + ":"
+        + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtim.tv_sec) + "."
+        + std::to_string(st.st_mtim.tv_nsec) + ":" + std::to_string(st.st_ctim.tv_sec) + "."
+        + std::to_string(st.st_ctim.tv_nsec) + "\n";
+}
+
+std::string GetXAttr(const std::filesystem::path& path, const std::string& name)
+{
+    char value[cXAttrValueLen];
+
+    auto size = getxattr(path.c_str(), name.c_str(), value, sizeof(value));
+    if (size < 0) {
+        return "";
+    }
+
+    return std::string(value, size);
+}
+
+bool IsFSImage(std::string_view header)
+{
+    if (header.compare(0, strlen(cSquashFSMagic), cSquashFSMagic) == 0) {
+        return true;
+    }
+
+    return header.size() >= cEROFSMagicOffset + strlen(cEROFSMagic)
+        && header.compare(cEROFSMagicOffset, strlen(cEROFSMagic), cEROFSMagic) == 0;
+}
+
+bool IsSHA256Hex(const std::string& name)
+{
+    return name.size() == cSHA256HexLen && std::all_of(name.begin(), name.end(), [](char c) { return isxdigit(c); });
 }
 
-std::set<std::filesystem::path> GetAllFilesByPath(const std::filesystem::path& path)
+std::vector<std::filesystem::path> GetAllFilesByPath(const std::filesystem::path& path)
 {
-    std::set<std::filesystem::path> files;
+    std::vector<std::filesystem::path> files;
 
     if (std::filesystem::is_regular_file(path)) {
-        files.insert(path);
+        files.push_back(path);
 
         return files;
     }
 
     for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
         if (entry.is_regular_file()) {
-            files.insert(entry.path());
+            files.push_back(entry.path());
         }
     }
 
+    // Files are hashed in sorted order
+    std::sort(files.begin(), files.end());
+
     return files;
 }
 
+DeltaInfo ParseDelta(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        AOS_ERROR_THROW(ErrorEnum::eNotFound, "can't open delta file");
+    }
+
+    Poco::JSON::Parser                          parser;
+    common::utils::CaseInsensitiveObjectWrapper object(parser.parse(file));
+    DeltaInfo                                   delta;
+
+    delta.mBaseDigest = object.GetValue<std::string>("baseDigest");
+    delta.mDigest     = object.GetValue<std::string>("digest");
+
+    for (const auto& removed : common::utils::GetArrayValue<std::string>(object, "removed")) {
+        auto removedPath = std::filesystem::path(removed).relative_path().lexically_normal();
+
+        // Removed paths should stay inside rootfs
+        if (removedPath.empty() || *removedPath.begin() == "..") {
+            AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "invalid removed path");
+        }
+
+        delta.mRemoved.push_back(removedPath);
+    }
+
+    return delta;
+}
+
+void CopyXAttrs(const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    auto size = llistxattr(source.c_str(), nullptr, 0);
+    if (size <= 0) {
+        return;
+    }
+
+    std::vector<char> names(size);
+
+    if (size = llistxattr(source.c_str(), names.data(), names.size()); size < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't list xattrs");
+    }
+
+    char value[cXAttrValueLen];
+
+    for (auto name = names.data(); name < names.data() + size; name += strlen(name) + 1) {
+        auto valueSize = lgetxattr(source.c_str(), name, value, sizeof(value));
+        if (valueSize < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't get xattr");
+        }
+
+        // Some xattrs, e.g. user ones on symlinks, can't be set and are skipped
+        if (lsetxattr(destination.c_str(), name, value, valueSize, 0) != 0 && errno != EPERM && errno != ENOTSUP) {
+            AOS_ERROR_THROW(Error(errno), "can't set xattr");
+        }
+    }
+}
+
+uint64_t CloneFile(
+    const std::filesystem::path& source, const std::filesystem::path& destination, const struct stat& st, bool link)
+{
+    if (link && ::link(source.c_str(), destination.c_str()) == 0) {
+        return 0;
+    }
+
+    uint64_t copied = 0;
+
+    {
+        auto srcFD = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (srcFD < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't open file");
+        }
+
+        [[maybe_unused]] auto closeSrcFD = DeferRelease(&srcFD, [](const int* fd) { close(*fd); });
+
+        auto dstFD = open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (dstFD < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create file");
+        }
+
+        [[maybe_unused]] auto closeDstFD = DeferRelease(&dstFD, [](const int* fd) { close(*fd); });
+
+        // Reflinked file shares blocks with the source, otherwise the content is copied
+        if (ioctl(dstFD, FICLONE, srcFD) != 0) {
+            for (off_t offset = 0; offset < st.st_size;) {
+                auto ret = copy_file_range(srcFD, nullptr, dstFD, nullptr, st.st_size - offset, 0);
+                if (ret <= 0) {
+                    AOS_ERROR_THROW(Error(ret < 0 ? errno : EIO), "can't copy file");
+                }
+
+                offset += ret;
+            }
+
+            copied = st.st_size;
+        }
+
+        if (fchown(dstFD, st.st_uid, st.st_gid) != 0 || fchmod(dstFD, st.st_mode & 07777) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't set file attributes");
+        }
+
+        struct timespec times[2] = {{0, UTIME_OMIT}, st.st_mtim};
+
+        if (futimens(dstFD, times) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't set file time");
+        }
+    }
+
+    CopyXAttrs(source, destination);
+
+    return copied;
+}
+
+uint64_t CloneTree(const std::filesystem::path& source, const std::filesystem::path& destination, bool link)
+{
+    uint64_t copied = 0;
+
+    std::filesystem::create_directories(destination);
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(source)) {
+        const auto target = destination / entry.path().lexically_relative(source);
+
+        struct stat st;
+
+        if (lstat(entry.path().c_str(), &st) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't get file status");
+        }
+
+        switch (st.st_mode & S_IFMT) {
+        case S_IFREG:
+            copied += CloneFile(entry.path(), target, st, link);
+
+            continue;
+
+        case S_IFDIR:
+            if (mkdir(target.c_str(), 0700) != 0) {
+                AOS_ERROR_THROW(Error(errno), "can't create dir");
+            }
+
+            if (chmod(target.c_str(), st.st_mode & 07777) != 0) {
+                AOS_ERROR_THROW(Error(errno), "can't change dir mode");
+            }
+
+            break;
+
+        case S_IFLNK:
+            std::filesystem::copy_symlink(entry.path(), target);
+
+            break;
+
+        default:
+            if (mknod(target.c_str(), st.st_mode, st.st_rdev) != 0) {
+                AOS_ERROR_THROW(Error(errno), "can't create special file");
+            }
+
+            break;
+        }
+
+        if (lchown(target.c_str(), st.st_uid, st.st_gid) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't change owner");
+        }
+
+        CopyXAttrs(entry.path(), target);
+    }
+
+    return copied;
+}
+
 } // namespace
 
 /***********************************************************************************************************************
@@ -111,7 +357,8 @@ std::set<std::filesystem::path> GetAllFilesByPath(const std::filesystem::path& p
  **********************************************************************************************************************/
 
 Error ImageHandler::Init(crypto::HasherItf& hasher, spaceallocator::SpaceAllocatorItf& layerSpaceAllocator,
-    spaceallocator::SpaceAllocatorItf& serviceSpaceAllocator, oci::OCISpecItf& ociSpec, uint32_t uid)
+    spaceallocator::SpaceAllocatorItf& serviceSpaceAllocator, oci::OCISpecItf& ociSpec, uint32_t uid,
+    const ImageHandlerConfig& config)
 {
     LOG_DBG() << "Init image handler";
 
@@ -120,6 +367,19 @@ Error ImageHandler::Init(crypto::HasherItf& hasher, spaceallocator::SpaceAllocat
     mServiceSpaceAllocator = &serviceSpaceAllocator;
     mOCISpec               = &ociSpec;
     mUID                   = uid;
+    mConfig                = config;
+    mMaxInstalls           = config.mMaxConcurrentInstalls;
+
+    if (mMaxInstalls == 0) {
+        mMaxInstalls = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    if (!mConfig.mFileStoreDir.empty()) {
+        // Layers always share inodes through the store, so shared content is accounted to layers space
+        if (auto err = mFileStore.Init(mConfig.mFileStoreDir, layerSpaceAllocator); !err.IsNone()) {
+            return AOS_ERROR_WRAP(Error(err, "failed to init file store"));
+        }
+    }
 
     return ErrorEnum::eNone;
 }
@@ -131,34 +391,91 @@ RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallLayer(const String
 
     RetWithError<StaticString<cFilePathLen>> result("");
 
-    auto err = CheckFileInfo(archivePath, layer.mSize, layer.mSHA256);
-    if (!err.IsNone()) {
-        result.mError = err;
+    std::error_code ec;
+    const auto      archiveSize = std::filesystem::file_size(archivePath.CStr(), ec);
+
+    if (ec.value() != 0) {
+        result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, ec.message().c_str()));
         return result;
     }
 
-    size_t      archiveSize = 0;
-    std::string extractDir;
+    if (archiveSize != layer.mSize) {
+        result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "file size mismatch"));
+        return result;
+    }
 
-    if (Tie(extractDir, err) = common::utils::MkTmpDir(installBasePath.CStr()); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(Error(err, "failed to create temporary extract dir"));
+    std::ifstream archive(archivePath.CStr(), std::ios::binary);
+    if (!archive.is_open()) {
+        result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "failed to open archive"));
         return result;
     }
 
-    if (Tie(archiveSize, err) = common::utils::GetUnpackedArchiveSize(archivePath.CStr()); !err.IsNone()) {
+    return InstallLayer(archive, installBasePath, layer, space);
+}
+
+RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallLayer(std::istream& archive,
+    const String& installBasePath, const LayerInfo& layer, UniquePtr<aos::spaceallocator::SpaceItf>& space)
+{
+    RetWithError<StaticString<cFilePathLen>> result("");
+
+    StaticString<cSHA256Size * 2> installID;
+
+    if (auto err = installID.ByteArrayToHex(layer.mSHA256); !err.IsNone()) {
         result.mError = AOS_ERROR_WRAP(err);
         return result;
     }
 
-    if (Tie(space, err) = mLayerSpaceAllocator->AllocateSpace(archiveSize); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
+    // Staging dir and journal names are derived from the archive hash, so interrupted install can be resumed
+    const auto extractDir
+        = std::filesystem::path(installBasePath.CStr()) / (std::string(cLayerStagingPrefix) + installID.CStr());
+
+    // Installs of the same archive share staging dir, so they are serialized
+    AcquireInstall(extractDir);
+
+    [[maybe_unused]] auto releaseInstall = DeferRelease(&extractDir, [this](const std::filesystem::path* dir) {
+        ReleaseInstall(*dir);
+    });
+
+    InstallJournal journal;
+    Error          err;
+    uint64_t       extractSize = 0, resumedSize = 0;
+
+    if (err = journal.Init(extractDir.string() + cJournalSuffix, installID.CStr()); !err.IsNone()) {
+        result.mError = AOS_ERROR_WRAP(Error(err, "failed to load install journal"));
         return result;
     }
 
-    auto cleanExtractDir = DeferRelease(&err, [&, extractSize = space->Size()](Error*) {
-        if (!extractDir.empty()) {
-            std::filesystem::remove_all(extractDir);
+    auto resume = journal.GetStage() >= InstallStage::eUnpacked;
+
+    if (resume) {
+        // Resumed layer is accounted by its unpacked size
+        if (Tie(resumedSize, err) = common::utils::CalculateSize(extractDir); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        // Staged data is synced before the stage is saved, size mismatch means the staged layer was changed after that
+        if (resumedSize != journal.GetSize()) {
+            LOG_WRN() << "Staged layer is corrupted, unpack it again: dir=" << extractDir.c_str()
+                      << ", size=" << resumedSize << ", expectedSize=" << journal.GetSize();
+
+            resume      = false;
+            resumedSize = 0;
         }
+    }
+
+    if (resume) {
+        LOG_INF() << "Resume layer install: digest=" << layer.mLayerDigest << ", dir=" << extractDir.c_str();
+    }
+
+    if (Tie(space, err) = mLayerSpaceAllocator->AllocateSpace(resume ? resumedSize : layer.mSize); !err.IsNone()) {
+        result.mError = AOS_ERROR_WRAP(err);
+        return result;
+    }
+
+    auto cleanExtractDir = DeferRelease(&err, [&](Error*) {
+        std::filesystem::remove_all(extractDir);
+        journal.Remove();
 
         assert(space.Get() != nullptr);
         assert(space->Size() >= extractSize);
@@ -166,9 +483,50 @@ RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallLayer(const String
         space->Resize(space->Size() - extractSize);
     });
 
-    if (err = UnpackArchive(archivePath, extractDir.c_str()); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
-        return result;
+    // Embedded layer archive is unpacked directly from the layer archive stream
+    auto unpackEmbeddedArchive = [&](const TarEntry& entry, TarReader& reader) -> RetWithError<bool> {
+        if (entry.mType != TarEntry::Type::eFile || !IsSHA256Hex(entry.mPath)) {
+            return {false, ErrorEnum::eNone};
+        }
+
+        const auto destination = std::filesystem::path(extractDir) / entry.mPath;
+
+        return {true, UnpackEmbeddedArchive(reader, entry, destination, space)};
+    };
+
+    if (!resume) {
+        try {
+            std::filesystem::remove_all(extractDir);
+            std::filesystem::create_directories(extractDir);
+        } catch (const std::exception& e) {
+            result.mError = AOS_ERROR_WRAP(Error(common::utils::ToAosError(e), "failed to create extract dir"));
+            return result;
+        }
+
+        if (err = journal.SetStage(InstallStage::eStarted); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        if (Tie(extractSize, err)
+            = UnpackVerifiedArchive(archive, extractDir, layer.mSize, layer.mSHA256, space, unpackEmbeddedArchive);
+            !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        uint64_t stagedSize = 0;
+
+        // Unpacked layer is verified while it is extracted, only its size is saved to check it on resume
+        if (Tie(stagedSize, err) = common::utils::CalculateSize(extractDir); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        if (err = journal.SetStage(InstallStage::eUnpacked, "", {extractDir}, stagedSize); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
     }
 
     auto contentDescriptor = std::make_unique<oci::ContentDescriptor>();
@@ -181,25 +539,37 @@ RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallLayer(const String
 
     const auto parsedDigest = common::utils::ParseDigest(contentDescriptor->mDigest.CStr());
     const auto installDir   = std::filesystem::path(installBasePath.CStr()) / parsedDigest.first / parsedDigest.second;
-    const auto embeddedArchivePath = std::filesystem::path(extractDir) / parsedDigest.second;
+    const auto layerDir     = std::filesystem::path(extractDir) / parsedDigest.second;
 
-    if (Tie(archiveSize, err) = common::utils::GetUnpackedArchiveSize(embeddedArchivePath, false); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
+    if (!std::filesystem::is_directory(layerDir)) {
+        result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "layer's embedded archive not found"));
         return result;
     }
 
-    if (err = space->Resize(space->Size() + archiveSize); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
-        return result;
-    }
+    if (resume) {
+        uint64_t layerSize = 0;
 
-    if (err = UnpackArchive(embeddedArchivePath.c_str(), installDir.c_str()); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(Error(err, "failed to unpack layer's embedded archive"));
-        return result;
+        if (Tie(layerSize, err) = common::utils::CalculateSize(layerDir); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        extractSize = resumedSize - std::min(layerSize, resumedSize);
     }
 
-    if (err = OCIWhiteoutsToOverlay(extractDir.c_str(), 0, 0); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(Error(err, "failed to convert OCI whiteouts to overlay"));
+    // Different archives may unpack to the same layer digest, so installs into the same dir are serialized as well
+    AcquireInstallDir(installDir);
+
+    [[maybe_unused]] auto releaseInstallDir = DeferRelease(&installDir, [this](const std::filesystem::path* dir) {
+        ReleaseInstallDir(*dir);
+    });
+
+    try {
+        std::filesystem::remove_all(installDir);
+        std::filesystem::create_directories(installDir.parent_path());
+        std::filesystem::rename(layerDir, installDir);
+    } catch (const std::exception& e) {
+        result.mError = AOS_ERROR_WRAP(Error(common::utils::ToAosError(e), "failed to install layer"));
         return result;
     }
 
@@ -216,49 +586,109 @@ RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallService(const Stri
     LOG_DBG() << "Install service: archive=" << archivePath << ", installBasePath=" << installBasePath
               << ", serviceID=" << service.mServiceID;
 
-    RetWithError<StaticString<cFilePathLen>> result("");
-
-    if (auto err = CheckFileInfo(archivePath, service.mSize, service.mSHA256); !err.IsNone()) {
-        result.mError = err;
-        return result;
+    std::ifstream archive(archivePath.CStr(), std::ios::binary);
+    if (!archive.is_open()) {
+        return {"", AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "failed to open archive"))};
     }
 
-    size_t unpackedSize = 0;
+    return InstallService(archive, installBasePath, service, space);
+}
+
+RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallService(std::istream& archive,
+    const String& installBasePath, const ServiceInfo& service, UniquePtr<aos::spaceallocator::SpaceItf>& space)
+{
+    RetWithError<StaticString<cFilePathLen>> result("");
 
     auto installDir = std::filesystem::path(installBasePath.CStr())
         / (std::string(service.mServiceID.CStr()) + "-v" + service.mVersion.CStr());
 
-    if (auto [exists, err] = fs::DirExist(installDir.c_str()); !err.IsNone() || exists) {
-        result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eAlreadyExist, "service already exists"));
+    AcquireInstall(installDir);
+
+    [[maybe_unused]] auto releaseInstall = DeferRelease(&installDir, [this](const std::filesystem::path* dir) {
+        ReleaseInstall(*dir);
+    });
+
+    StaticString<cSHA256Size * 2> installID;
+    InstallJournal                journal;
+
+    if (auto err = installID.ByteArrayToHex(service.mSHA256); !err.IsNone()) {
+        result.mError = AOS_ERROR_WRAP(err);
         return result;
     }
 
-    if (auto err = fs::MakeDirAll(installDir.c_str()); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(Error(err, "failed to create service installation dir"));
+    if (auto err = journal.Init(installDir.string() + cJournalSuffix, installID.CStr()); !err.IsNone()) {
+        result.mError = AOS_ERROR_WRAP(Error(err, "failed to load install journal"));
         return result;
     }
 
+    // Install dir without journal belongs to completely installed service
+    if (journal.GetStage() == InstallStage::eNone) {
+        if (auto [exists, err] = fs::DirExist(installDir.c_str()); !err.IsNone() || exists) {
+            result.mError = AOS_ERROR_WRAP(Error(ErrorEnum::eAlreadyExist, "service already exists"));
+            return result;
+        }
+    }
+
     Error err = ErrorEnum::eNone;
 
-    auto cleanInstallDir = DeferRelease(&err, [installDir](const Error* err) {
+    auto cleanInstallDir = DeferRelease(&err, [&installDir, &journal](const Error* err) {
         if (!err->IsNone()) {
             std::filesystem::remove_all(installDir);
         }
+
+        journal.Remove();
     });
 
-    if (Tie(unpackedSize, err) = common::utils::GetUnpackedArchiveSize(archivePath.CStr()); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
-        return result;
-    }
+    if (journal.GetStage() < InstallStage::eUnpacked) {
+        // Journal is created before the install dir, so partially created install dir is always detected
+        if (err = fs::MakeDirAll(installBasePath); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(Error(err, "failed to create service installation dir"));
+            return result;
+        }
 
-    if (Tie(space, err) = mServiceSpaceAllocator->AllocateSpace(unpackedSize); !err.IsNone()) {
-        result.mError = AOS_ERROR_WRAP(err);
-        return result;
-    }
+        if (err = journal.SetStage(InstallStage::eStarted); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
 
-    if (err = UnpackArchive(archivePath, installDir.c_str()); !err.IsNone()) {
-        result.mError = err;
-        return result;
+        std::filesystem::remove_all(installDir);
+
+        if (err = fs::MakeDirAll(installDir.c_str()); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(Error(err, "failed to create service installation dir"));
+            return result;
+        }
+
+        if (Tie(space, err) = mServiceSpaceAllocator->AllocateSpace(service.mSize); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        if (Tie(std::ignore, err) = UnpackVerifiedArchive(archive, installDir, service.mSize, service.mSHA256, space);
+            !err.IsNone()) {
+            result.mError = err;
+            return result;
+        }
+
+        // Unpacked blobs are verified by their digests when install is resumed
+        if (err = journal.SetStage(InstallStage::eUnpacked, "", {installDir}); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+    } else {
+        LOG_INF() << "Resume service install: serviceID=" << service.mServiceID << ", dir=" << installDir.c_str();
+
+        // Resumed service is accounted by its current size
+        size_t installedSize = 0;
+
+        if (Tie(installedSize, err) = common::utils::CalculateSize(installDir); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
+
+        if (Tie(space, err) = mServiceSpaceAllocator->AllocateSpace(installedSize); !err.IsNone()) {
+            result.mError = AOS_ERROR_WRAP(err);
+            return result;
+        }
     }
 
     auto manifest     = std::make_unique<oci::ImageManifest>();
@@ -269,17 +699,18 @@ RetWithError<StaticString<cFilePathLen>> ImageHandler::InstallService(const Stri
         return result;
     }
 
-    if (err = ValidateService(installDir.c_str(), *manifest); !err.IsNone()) {
+    // Rootfs layer digest is validated by PrepareServiceFS while the layer is unpacked
+    if (err = ValidateServiceManifest(installDir.c_str(), *manifest); !err.IsNone()) {
         result.mError = AOS_ERROR_WRAP(err);
         return result;
     }
 
-    if (err = PrepareServiceFS(installDir.c_str(), service, *manifest, space); !err.IsNone()) {
+    if (err = PrepareServiceFS(installDir.c_str(), service, *manifest, space, journal); !err.IsNone()) {
         result.mError = err;
         return result;
     }
-    LOG_DBG() << "Service has been successfully installed: src=" << archivePath << ", dst=" << installDir.c_str()
-              << ", size=" << space->Size();
+
+    LOG_DBG() << "Service has been successfully installed: path=" << installDir.c_str() << ", size=" << space->Size();
 
     result.mValue = installDir.c_str();
 
@@ -339,6 +770,19 @@ Error ImageHandler::ValidateServiceConfig(const String& path, const String& dige
 }
 
 Error ImageHandler::ValidateService(const String& path, const oci::ImageManifest& manifest) const
+{
+    if (auto err = ValidateServiceManifest(path, manifest); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    if (auto err = ValidateDigest(path, manifest.mLayers[0].mDigest); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error ImageHandler::ValidateServiceManifest(const String& path, const oci::ImageManifest& manifest) const
 {
     if (auto err = ValidateDigest(path, manifest.mConfig.mDigest); !err.IsNone()) {
         return AOS_ERROR_WRAP(err);
@@ -358,10 +802,6 @@ Error ImageHandler::ValidateService(const String& path, const oci::ImageManifest
         return AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidArgument, "no layers found"));
     }
 
-    if (auto err = ValidateDigest(path, manifest.mLayers[0].mDigest); !err.IsNone()) {
-        return AOS_ERROR_WRAP(err);
-    }
-
     return ErrorEnum::eNone;
 }
 
@@ -377,50 +817,99 @@ Error ImageHandler::ValidateDigest(const String& path, const String& digest) con
         return AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, ec.message().c_str()));
     }
 
-    StaticString<oci::cMaxDigestLen> calculatedDigest;
+    // Verified digests are cached in the blobs dir xattrs together with the blob metadata fingerprint
+    const auto cacheDir = fullPath.parent_path();
+    const auto cacheKey = std::string(cDigestCacheXAttrPrefix) + parsedDigest.first + "." + parsedDigest.second;
 
-    if (std::filesystem::is_directory(fullPath)) {
-        auto [hash, err] = common::utils::HashDir(fullPath);
-        if (!err.IsNone()) {
-            return AOS_ERROR_WRAP(err);
-        }
+    auto [fingerprint, err] = CalculateFingerprint(fullPath);
+    if (!err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
 
-        calculatedDigest = hash.c_str();
+    if (GetXAttr(cacheDir, cacheKey) == fingerprint) {
+        LOG_DBG() << "Digest is verified by cache: path=" << fullPath.c_str();
 
-        return (calculatedDigest == digest) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
+        return ErrorEnum::eNone;
     }
 
-    auto [sha256, err] = CalculateHash(fullPath.c_str(), crypto::HashEnum::eSHA256);
-    if (!err.IsNone()) {
+    if (err = CheckDigest(fullPath, digest); !err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    if (err = calculatedDigest.ByteArrayToHex(sha256); !err.IsNone()) {
-        return AOS_ERROR_WRAP(err);
+    if (setxattr(cacheDir.c_str(), cacheKey.c_str(), fingerprint.c_str(), fingerprint.size(), 0) != 0) {
+        LOG_WRN() << "Can't cache verified digest: path=" << fullPath.c_str() << ", err=" << Error(errno);
     }
 
-    return (calculatedDigest.Prepend(cSHA256Prefix) == digest) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
+    return ErrorEnum::eNone;
 }
 
-Error ImageHandler::CheckFileInfo(const String& path, uint64_t size, const Array<uint8_t>& sha256) const
+Error ImageHandler::CheckDigest(const std::filesystem::path& path, const String& digest) const
 {
-    std::error_code ec;
-    const auto      actualSize = std::filesystem::file_size(path.CStr(), ec);
+    StaticString<oci::cMaxDigestLen> calculatedDigest;
 
-    if (ec.value() != 0) {
-        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, ec.message().c_str()));
-    }
+    if (std::filesystem::is_directory(path)) {
+        auto [hash, err] = common::utils::HashDir(path);
+        if (!err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
+
+        calculatedDigest = hash.c_str();
 
-    if (size != actualSize) {
-        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "file size mismatch"));
+        return (calculatedDigest == digest) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
     }
 
-    auto [calculatedSHA256, err] = CalculateHash(path, crypto::HashEnum::eSHA3_256);
+    auto [sha256, err] = CalculateHash(path.c_str(), crypto::HashEnum::eSHA256);
     if (!err.IsNone()) {
-        return err;
+        return AOS_ERROR_WRAP(err);
+    }
+
+    if (err = calculatedDigest.ByteArrayToHex(sha256); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
     }
 
-    return (sha256 == calculatedSHA256) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
+    return (calculatedDigest.Prepend(cSHA256Prefix) == digest) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
+}
+
+RetWithError<std::string> ImageHandler::CalculateFingerprint(const std::filesystem::path& path) const
+{
+    try {
+        std::vector<std::string> records {GetFileRecord(path, "")};
+
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                records.push_back(GetFileRecord(entry.path(), entry.path().lexically_relative(path).string()));
+            }
+
+            std::sort(records.begin(), records.end());
+        }
+
+        auto [hasher, err] = mHasher->CreateHash(crypto::HashEnum::eSHA256);
+        if (!err.IsNone()) {
+            return {"", AOS_ERROR_WRAP(err)};
+        }
+
+        for (auto& record : records) {
+            if (err = hasher->Update(Array<uint8_t>(reinterpret_cast<uint8_t*>(record.data()), record.size()));
+                !err.IsNone()) {
+                return {"", AOS_ERROR_WRAP(err)};
+            }
+        }
+
+        StaticArray<uint8_t, cSHA256Size> hash;
+        StaticString<oci::cMaxDigestLen>  fingerprint;
+
+        if (err = hasher->Finalize(hash); !err.IsNone()) {
+            return {"", AOS_ERROR_WRAP(err)};
+        }
+
+        if (err = fingerprint.ByteArrayToHex(hash); !err.IsNone()) {
+            return {"", AOS_ERROR_WRAP(err)};
+        }
+
+        return {fingerprint.CStr(), ErrorEnum::eNone};
+    } catch (const std::exception& e) {
+        return {"", AOS_ERROR_WRAP(common::utils::ToAosError(e))};
+    }
 }
 
 RetWithError<StaticArray<uint8_t, cSHA256Size>> ImageHandler::CalculateHash(
@@ -434,24 +923,18 @@ RetWithError<StaticArray<uint8_t, cSHA256Size>> ImageHandler::CalculateHash(
             return {{}, AOS_ERROR_WRAP(err)};
         }
 
-        for (const auto& file : GetAllFilesByPath(path.CStr())) {
-            std::ifstream ifile(file, std::ios::binary);
-            if (!ifile.is_open()) {
-                return {{}, AOS_ERROR_WRAP(ErrorEnum::eNotFound)};
-            }
-
-            std::vector<uint8_t> buffer(cBufferSize, 0);
-
-            while (ifile) {
-                ifile.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        // Reading of next file chunks overlaps with hashing, hash is updated in the same order as before
+        ReadAheadReader reader(cBufferSize, cReadAheadBuffers);
 
-                if (const auto bytesRead = ifile.gcount(); bytesRead > 0) {
-                    if (err = hasher->Update(Array<uint8_t>(buffer.data(), static_cast<size_t>(bytesRead)));
-                        !err.IsNone()) {
-                        return {{}, AOS_ERROR_WRAP(Error(err, "failed to calculate hash"))};
-                    }
-                }
+        err = reader.Read(GetAllFilesByPath(path.CStr()), [&hasher](uint8_t* data, size_t size) -> Error {
+            if (auto err = hasher->Update(Array<uint8_t>(data, size)); !err.IsNone()) {
+                return AOS_ERROR_WRAP(Error(err, "failed to calculate hash"));
             }
+
+            return ErrorEnum::eNone;
+        });
+        if (!err.IsNone()) {
+            return {{}, AOS_ERROR_WRAP(err)};
         }
 
         if (err = hasher->Finalize(hash); !err.IsNone()) {
@@ -464,82 +947,387 @@ RetWithError<StaticArray<uint8_t, cSHA256Size>> ImageHandler::CalculateHash(
     return {hash, ErrorEnum::eNone};
 }
 
-Error ImageHandler::UnpackArchive(const String& source, const String& destination) const
+RetWithError<uint64_t> ImageHandler::UnpackVerifiedArchive(std::istream& archive,
+    const std::filesystem::path& destination, uint64_t size, const Array<uint8_t>& sha3,
+    UniquePtr<aos::spaceallocator::SpaceItf>& space, TarExtractor::EntryHandler entryHandler) const
+{
+    LOG_DBG() << "Unpack archive: destination=" << destination.c_str() << ", size=" << size;
+
+    auto [hash, err] = mHasher->CreateHash(crypto::HashEnum::eSHA3_256);
+    if (!err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(err)};
+    }
+
+    // Archive is read once: the same data is hashed and extracted while it is being received
+    HashStreamBuf hashBuf(archive);
+    std::istream  stream(&hashBuf);
+
+    hashBuf.AddHash(*hash.Get());
+
+    uint64_t extractedSize = 0;
+
+    if (Tie(extractedSize, err) = UnpackArchive(stream, destination, space, size, std::move(entryHandler));
+        !err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(err)};
+    }
+
+    if (err = hashBuf.Drain(); !err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(err)};
+    }
+
+    if (hashBuf.Size() != size) {
+        return {0, AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "file size mismatch"))};
+    }
+
+    StaticArray<uint8_t, cSHA256Size> calculatedSHA3;
+
+    if (err = hash->Finalize(calculatedSHA3); !err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(Error(err, "failed to calculate hash"))};
+    }
+
+    if (!(sha3 == calculatedSHA3)) {
+        return {0, AOS_ERROR_WRAP(ErrorEnum::eInvalidChecksum)};
+    }
+
+    return {extractedSize, ErrorEnum::eNone};
+}
+
+RetWithError<uint64_t> ImageHandler::UnpackArchive(std::istream& stream, const std::filesystem::path& destination,
+    UniquePtr<aos::spaceallocator::SpaceItf>& space, uint64_t reserved, TarExtractor::EntryHandler entryHandler,
+    TarExtractor::FileHandler fileHandler, const std::optional<std::pair<uint32_t, uint32_t>>& owner) const
 {
-    LOG_DBG() << "Unpack archive: source=" << source << ", destination=" << destination;
+    TarExtractor extractor(destination);
+
+    extractor.SetEntryHandler(std::move(entryHandler));
+
+    if (owner) {
+        extractor.SetOwner(owner->first, owner->second);
+    }
+
+    if (fileHandler) {
+        extractor.SetFileHandler(*mHasher, std::move(fileHandler));
+    }
+
+    // Space is reserved while extracting as unpacked size is not known in advance
+    extractor.SetSizeHandler([&space, &reserved](uint64_t size) -> Error {
+        if (size <= reserved) {
+            return ErrorEnum::eNone;
+        }
+
+        auto grow = std::max(size - reserved, cSpaceReserveChunk);
+
+        if (auto err = space->Resize(space->Size() + grow); !err.IsNone()) {
+            grow = size - reserved;
+
+            if (err = space->Resize(space->Size() + grow); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
 
-    if (auto err = fs::MakeDirAll(destination); !err.IsNone()) {
+        reserved += grow;
+
+        return ErrorEnum::eNone;
+    });
+
+    if (auto err = extractor.Extract(stream); !err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(err)};
+    }
+
+    if (auto err = space->Resize(space->Size() - (reserved - extractor.ExtractedSize())); !err.IsNone()) {
+        return {0, AOS_ERROR_WRAP(err)};
+    }
+
+    return {extractor.ExtractedSize(), ErrorEnum::eNone};
+}
+
+TarExtractor::FileHandler ImageHandler::FileStoreHandler(
+    bool allowHardLink, UniquePtr<aos::spaceallocator::SpaceItf>& space) const
+{
+    if (mConfig.mFileStoreDir.empty()) {
+        return {};
+    }
+
+    return [this, allowHardLink, &space](
+               const std::filesystem::path& path, const TarEntry& entry, const std::string& sha256) -> Error {
+        auto [saved, err] = mFileStore.Add(path, entry, sha256, allowHardLink);
+        if (!err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
+
+        // Deduplicated file is charged to the store space
+        if (saved != 0) {
+            if (err = space->Resize(space->Size() - saved); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
+
+        return ErrorEnum::eNone;
+    };
+}
+
+Error ImageHandler::UnpackEmbeddedArchive(TarReader& reader, const TarEntry& entry,
+    const std::filesystem::path& destination, UniquePtr<aos::spaceallocator::SpaceItf>& space) const
+{
+    LOG_DBG() << "Unpack embedded archive: destination=" << destination.c_str();
+
+    auto [hash, err] = mHasher->CreateHash(crypto::HashEnum::eSHA256);
+    if (!err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    if (auto err = common::utils::UnpackTarImage(source.CStr(), destination.CStr()); !err.IsNone()) {
+    TarEntryStreamBuf entryBuf(reader);
+    std::istream      entryStream(&entryBuf);
+    HashStreamBuf     hashBuf(entryStream);
+    std::istream      stream(&hashBuf);
+
+    hashBuf.AddHash(*hash.Get());
+
+    if (IsFSImage(hashBuf.Peek(cFSImageHeaderSize))) {
+        // Layers shipped as read-only file system images are stored as is and mounted by runtime
+        err = StoreLayerImage(stream, destination / cLayerImageFile, entry.mSize, space);
+    } else {
+        // Layer files keep their attributes, so they can share inodes with other layers
+        Tie(std::ignore, err) = UnpackArchive(
+            stream, destination, space, 0, OCIWhiteoutsToOverlay(destination, 0, 0), FileStoreHandler(true, space));
+    }
+
+    if (!err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    return ErrorEnum::eNone;
+    if (err = hashBuf.Drain(); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    if (err = entryBuf.GetError(); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    StaticArray<uint8_t, cSHA256Size> calculatedSHA256;
+
+    if (err = hash->Finalize(calculatedSHA256); !err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "failed to calculate hash"));
+    }
+
+    StaticString<oci::cMaxDigestLen> calculatedDigest;
+
+    if (err = calculatedDigest.ByteArrayToHex(calculatedSHA256); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    return (calculatedDigest == entry.mPath.c_str()) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
 }
 
-Error ImageHandler::PrepareServiceFS(const String& baseDir, const ServiceInfo& service, oci::ImageManifest& manifest,
+Error ImageHandler::StoreLayerImage(std::istream& stream, const std::filesystem::path& path, uint64_t size,
     UniquePtr<aos::spaceallocator::SpaceItf>& space) const
 {
-    LOG_DBG() << "Preparing service rootfs: baseDir=" << baseDir << ", service=" << service.mServiceID;
+    LOG_DBG() << "Store layer image: path=" << path.c_str() << ", size=" << size;
 
-    auto imageParts = std::make_unique<ImageParts>();
+    if (auto err = space->Resize(space->Size() + size); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
 
-    Error err = GetImagePartsFromManifest(manifest, *imageParts);
+    try {
+        std::filesystem::create_directories(path.parent_path());
 
-    if (!err.IsNone()) {
-        return AOS_ERROR_WRAP(Error(err, "failed to get image parts"));
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "failed to create layer image"));
+        }
+
+        file << stream.rdbuf();
+        file.close();
+
+        if (!file || std::filesystem::file_size(path) != size) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "failed to write layer image"));
+        }
+
+        // Layer kind is marked on the layer dir, as unpacked layers may contain a file with the same name
+        const auto imageName = path.filename().string();
+
+        if (setxattr(path.parent_path().c_str(), cLayerImageXAttr, imageName.c_str(), imageName.size(), 0) != 0) {
+            return AOS_ERROR_WRAP(Error(errno, "failed to mark layer image"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
     }
 
-    const auto rootFSArchive = std::filesystem::path(baseDir.CStr()) / cBlobsFolder / imageParts->mServiceFSPath.CStr();
-    const auto tmpRootFS     = std::filesystem::path(baseDir.CStr()) / cTmpRootFSDir;
-    size_t     archiveSize   = 0;
-    size_t     unpackedSize  = 0;
+    return ErrorEnum::eNone;
+}
 
-    if (Tie(archiveSize, err) = common::utils::CalculateSize(rootFSArchive); !err.IsNone()) {
-        return AOS_ERROR_WRAP(err);
+Error ImageHandler::UnpackRootFS(const std::filesystem::path& archivePath, const std::filesystem::path& destination,
+    const String& digest, uint32_t uid, uint32_t gid, UniquePtr<aos::spaceallocator::SpaceItf>& space) const
+{
+    LOG_DBG() << "Unpack rootfs: source=" << archivePath.c_str() << ", destination=" << destination.c_str();
+
+    std::ifstream file(archivePath, std::ios::binary);
+    if (!file.is_open()) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "failed to open rootfs archive"));
     }
 
-    if (Tie(unpackedSize, err) = common::utils::GetUnpackedArchiveSize(rootFSArchive); !err.IsNone()) {
+    auto [hash, err] = mHasher->CreateHash(crypto::HashEnum::eSHA256);
+    if (!err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    if (err = space->Resize(space->Size() + unpackedSize); !err.IsNone()) {
+    // Rootfs layer digest is validated while the layer is unpacked
+    HashStreamBuf hashBuf(file);
+    std::istream  stream(&hashBuf);
+
+    hashBuf.AddHash(*hash.Get());
+
+    // Without idmapped mounts rootfs files are chowned to the service owner after unpacking, so they can't share inodes.
+    // With idmapped mounts all files are stored with the given owner, as runtime maps only this owner to the service.
+    if (Tie(std::ignore, err) = UnpackArchive(stream, destination, space, 0,
+            OCIWhiteoutsToOverlay(destination, uid, gid), FileStoreHandler(mConfig.mIDMappedMounts, space),
+            mConfig.mIDMappedMounts ? std::make_optional(std::make_pair(uid, gid)) : std::nullopt);
+        !err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    if (err = UnpackArchive(rootFSArchive.c_str(), tmpRootFS.c_str()); !err.IsNone()) {
+    if (err = hashBuf.Drain(); !err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    std::filesystem::remove_all(rootFSArchive);
+    StaticArray<uint8_t, cSHA256Size> sha256;
 
-    if (err = space->Resize(space->Size() - archiveSize); !err.IsNone()) {
+    if (err = hash->Finalize(sha256); !err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "failed to calculate hash"));
+    }
+
+    StaticString<oci::cMaxDigestLen> calculatedDigest;
+
+    if (err = calculatedDigest.ByteArrayToHex(sha256); !err.IsNone()) {
         return AOS_ERROR_WRAP(err);
     }
 
-    if (err = common::utils::ChangeOwner(tmpRootFS, mUID, service.mGID); !err.IsNone()) {
-        return AOS_ERROR_WRAP(Error(err, "failed to change service rootfs owner"));
+    return (calculatedDigest.Prepend(cSHA256Prefix) == digest) ? ErrorEnum::eNone : ErrorEnum::eInvalidChecksum;
+}
+
+Error ImageHandler::PrepareServiceFS(const String& baseDir, const ServiceInfo& service, oci::ImageManifest& manifest,
+    UniquePtr<aos::spaceallocator::SpaceItf>& space, InstallJournal& journal) const
+{
+    LOG_DBG() << "Preparing service rootfs: baseDir=" << baseDir << ", service=" << service.mServiceID;
+
+    auto imageParts = std::make_unique<ImageParts>();
+
+    Error err = GetImagePartsFromManifest(manifest, *imageParts);
+
+    if (!err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "failed to get image parts"));
+    }
+
+    const auto rootFSArchive = std::filesystem::path(baseDir.CStr()) / cBlobsFolder / imageParts->mServiceFSPath.CStr();
+    const auto tmpRootFS     = std::filesystem::path(baseDir.CStr()) / cTmpRootFSDir;
+    const auto deltaPath     = std::filesystem::path(baseDir.CStr()) / cDeltaFile;
+
+    // Delta image contains only files changed since the base rootfs, the rest is taken from the installed base service
+    std::optional<DeltaInfo> delta;
+
+    try {
+        if (std::filesystem::exists(deltaPath)) {
+            delta = ParseDelta(deltaPath);
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(Error(common::utils::ToAosError(e), "failed to parse delta info"));
     }
 
-    if (err = OCIWhiteoutsToOverlay(tmpRootFS.c_str(), mUID, service.mGID); !err.IsNone()) {
-        return AOS_ERROR_WRAP(Error(err, "failed to convert OCI whiteouts to overlay"));
+    if (journal.GetStage() >= InstallStage::eRootFSUnpacked) {
+        if (err = CheckStagedRootFS(baseDir.CStr(), tmpRootFS, journal); !err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
     }
 
-    std::string rootFSHash;
-    if (Tie(rootFSHash, err) = common::utils::HashDir(tmpRootFS.c_str()); !err.IsNone()) {
-        return AOS_ERROR_WRAP(Error(err, "failed to hash service rootfs directory"));
+    if (journal.GetStage() < InstallStage::eRootFSUnpacked) {
+        // Rootfs partially unpacked before interruption is unpacked again
+        std::filesystem::remove_all(tmpRootFS);
+
+        // With idmapped mounts files are stored root owned and runtime maps root to the service owner on mount
+        const auto uid = mConfig.mIDMappedMounts ? 0 : mUID;
+        const auto gid = mConfig.mIDMappedMounts ? 0 : service.mGID;
+
+        if (delta) {
+            if (err = CloneDeltaBase(baseDir.CStr(), delta->mBaseDigest, tmpRootFS, space); !err.IsNone()) {
+                return AOS_ERROR_WRAP(Error(err, "failed to clone delta base rootfs"));
+            }
+
+            if (err = RemoveDeltaFiles(tmpRootFS, delta->mRemoved); !err.IsNone()) {
+                return AOS_ERROR_WRAP(Error(err, "failed to remove delta files"));
+            }
+        }
+
+        if (err = UnpackRootFS(rootFSArchive, tmpRootFS, manifest.mLayers[0].mDigest, uid, gid, space);
+            !err.IsNone()) {
+            return AOS_ERROR_WRAP(Error(err, "failed to unpack service rootfs"));
+        }
+
+        if (!mConfig.mIDMappedMounts) {
+            if (err = common::utils::ChangeOwner(tmpRootFS, mUID, service.mGID); !err.IsNone()) {
+                return AOS_ERROR_WRAP(Error(err, "failed to change service rootfs owner"));
+            }
+        }
+
+        std::string rootFSHash;
+
+        if (Tie(rootFSHash, err) = common::utils::HashDir(tmpRootFS.c_str()); !err.IsNone()) {
+            return AOS_ERROR_WRAP(Error(err, "failed to hash service rootfs directory"));
+        }
+
+        if (err = journal.SetStage(InstallStage::eRootFSUnpacked, rootFSHash, {tmpRootFS}); !err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
     }
 
+    // Once rootfs is hashed, the saved manifest may already refer to the installed rootfs instead of the archive
+    if (journal.GetStage() < InstallStage::eRootFSHashed) {
+        if (std::filesystem::is_regular_file(rootFSArchive)) {
+            size_t archiveSize = 0;
+
+            if (Tie(archiveSize, err) = common::utils::CalculateSize(rootFSArchive); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+
+            std::filesystem::remove_all(rootFSArchive);
+
+            if (err = space->Resize(space->Size() - archiveSize); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
+
+        const auto rootFSHash = journal.GetDigest();
+
+        if (delta && rootFSHash != delta->mDigest) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidChecksum, "delta rootfs digest mismatch"));
+        }
+
+        if (err = journal.SetStage(InstallStage::eRootFSHashed, rootFSHash, {rootFSArchive.parent_path()});
+            !err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
+    }
+
+    const auto rootFSHash        = journal.GetDigest();
     const auto [algorithm, hash] = common::utils::ParseDigest(rootFSHash);
     const auto installPath       = std::filesystem::path(baseDir.CStr()) / cBlobsFolder / algorithm / hash;
 
     std::error_code ec;
 
-    std::filesystem::rename(tmpRootFS, installPath, ec);
-    if (ec.value() != 0) {
-        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, ec.message().c_str()));
+    // Rootfs could be already renamed before interruption
+    if (std::filesystem::exists(tmpRootFS, ec)) {
+        std::filesystem::remove_all(installPath, ec);
+        std::filesystem::rename(tmpRootFS, installPath, ec);
+    }
+
+    if (ec.value() != 0 || !std::filesystem::is_directory(installPath, ec)) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, ec ? ec.message().c_str() : "service rootfs not found"));
+    }
+
+    if (mConfig.mIDMappedMounts) {
+        const auto owner = std::to_string(mUID) + ":" + std::to_string(service.mGID);
+
+        if (setxattr(installPath.c_str(), cOwnerXAttr, owner.c_str(), owner.size(), 0) != 0) {
+            return AOS_ERROR_WRAP(Error(errno, "failed to set service rootfs owner"));
+        }
     }
 
     manifest.mLayers[0].mDigest = rootFSHash.c_str();
@@ -549,7 +1337,184 @@ Error ImageHandler::PrepareServiceFS(const String& baseDir, const ServiceInfo& s
         return AOS_ERROR_WRAP(Error(err, "failed to save image manifest"));
     }
 
+    std::filesystem::remove(deltaPath, ec);
+
+    return ErrorEnum::eNone;
+}
+
+Error ImageHandler::CheckStagedRootFS(
+    const std::filesystem::path& baseDir, const std::filesystem::path& tmpRootFS, InstallJournal& journal) const
+{
+    auto stagedRootFS = tmpRootFS;
+
+    // Rootfs could be already renamed before interruption
+    if (!std::filesystem::exists(stagedRootFS) && !journal.GetDigest().empty()) {
+        const auto [algorithm, hash] = common::utils::ParseDigest(journal.GetDigest());
+
+        stagedRootFS = baseDir / cBlobsFolder / algorithm / hash;
+    }
+
+    // Staged rootfs could be corrupted by the interruption, so it is verified before install continues
+    auto err = CheckDigest(stagedRootFS, journal.GetDigest().c_str());
+    if (err.IsNone()) {
+        return ErrorEnum::eNone;
+    }
+
+    // Rootfs archive is removed once rootfs is hashed, corrupted rootfs can't be unpacked again
+    if (journal.GetStage() > InstallStage::eRootFSUnpacked) {
+        return AOS_ERROR_WRAP(Error(err, "staged service rootfs is corrupted"));
+    }
+
+    LOG_WRN() << "Staged service rootfs is corrupted, unpack it again: path=" << stagedRootFS.c_str()
+              << ", err=" << err;
+
+    if (err = journal.SetStage(InstallStage::eUnpacked); !err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    return ErrorEnum::eNone;
+}
+
+RetWithError<std::filesystem::path> ImageHandler::FindDeltaBase(
+    const std::filesystem::path& baseDir, const std::string& baseDigest) const
+{
+    const auto [algorithm, hash] = common::utils::ParseDigest(baseDigest);
+
+    auto manifest = std::make_unique<oci::ImageManifest>();
+
+    try {
+        // Installed services are siblings of the install dir, their manifests refer to the installed rootfs digest
+        for (const auto& entry : std::filesystem::directory_iterator(baseDir.parent_path())) {
+            const auto& path = entry.path();
+
+            if (path == baseDir || !entry.is_directory() || std::filesystem::exists(path.string() + cJournalSuffix)) {
+                continue;
+            }
+
+            const auto manifestPath = path / cServiceManifestFile;
+
+            if (!std::filesystem::exists(manifestPath)
+                || !mOCISpec->LoadImageManifest(manifestPath.c_str(), *manifest).IsNone()
+                || manifest->mLayers.Size() == 0 || baseDigest != manifest->mLayers[0].mDigest.CStr()) {
+                continue;
+            }
+
+            const auto rootFS = path / cBlobsFolder / algorithm / hash;
+
+            if (std::filesystem::is_directory(rootFS)) {
+                return {rootFS, ErrorEnum::eNone};
+            }
+        }
+    } catch (const std::exception& e) {
+        return {{}, AOS_ERROR_WRAP(common::utils::ToAosError(e))};
+    }
+
+    return {{}, AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "delta base service not found"))};
+}
+
+Error ImageHandler::CloneDeltaBase(const std::filesystem::path& baseDir, const std::string& baseDigest,
+    const std::filesystem::path& destination, UniquePtr<aos::spaceallocator::SpaceItf>& space) const
+{
+    auto [baseRootFS, err] = FindDeltaBase(baseDir, baseDigest);
+    if (!err.IsNone()) {
+        return AOS_ERROR_WRAP(err);
+    }
+
+    LOG_DBG() << "Clone delta base rootfs: source=" << baseRootFS.c_str() << ", destination=" << destination.c_str();
+
+    // Base rootfs could be modified since it was installed
+    if (err = CheckDigest(baseRootFS, baseDigest.c_str()); !err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "delta base rootfs is corrupted"));
+    }
+
+    try {
+        // Without idmapped mounts rootfs files are chowned to the service owner, so they can't share inodes
+        const auto copied = CloneTree(baseRootFS, destination, mConfig.mIDMappedMounts);
+
+        if (err = space->Resize(space->Size() + copied); !err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
     return ErrorEnum::eNone;
 }
 
+Error ImageHandler::RemoveDeltaFiles(
+    const std::filesystem::path& rootFS, const std::vector<std::filesystem::path>& removed) const
+{
+    try {
+        for (const auto& path : removed) {
+            auto current = rootFS;
+            auto skip    = false;
+
+            // Symlinks from the base rootfs are not followed, otherwise files outside rootfs could be removed
+            for (auto it = path.begin(); it != path.end() && !skip; ++it) {
+                current /= *it;
+
+                const auto status = std::filesystem::symlink_status(current);
+
+                skip = !std::filesystem::exists(status)
+                    || (std::filesystem::is_symlink(status) && std::next(it) != path.end());
+            }
+
+            if (skip) {
+                LOG_WRN() << "Skip removing delta file: path=" << path.c_str();
+                continue;
+            }
+
+            std::filesystem::remove_all(current);
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+void ImageHandler::AcquireInstall(const std::string& installKey)
+{
+    std::unique_lock lock {mInstallMutex};
+
+    // Number of parallel installs is limited as each of them keeps a decompression and a read ahead thread busy
+    mInstallCondVar.wait(lock, [this, &installKey]() {
+        return mActiveInstalls.size() < mMaxInstalls && mActiveInstalls.count(installKey) == 0;
+    });
+
+    mActiveInstalls.insert(installKey);
+}
+
+void ImageHandler::ReleaseInstall(const std::string& installKey)
+{
+    {
+        std::lock_guard lock {mInstallMutex};
+
+        mActiveInstalls.erase(installKey);
+    }
+
+    mInstallCondVar.notify_all();
+}
+
+void ImageHandler::AcquireInstallDir(const std::string& installDir)
+{
+    std::unique_lock lock {mInstallMutex};
+
+    // Install dir is held only while it is replaced, so it doesn't count against parallel installs limit
+    mInstallCondVar.wait(lock, [this, &installDir]() { return mActiveInstallDirs.count(installDir) == 0; });
+
+    mActiveInstallDirs.insert(installDir);
+}
+
+void ImageHandler::ReleaseInstallDir(const std::string& installDir)
+{
+    {
+        std::lock_guard lock {mInstallMutex};
+
+        mActiveInstallDirs.erase(installDir);
+    }
+
+    mInstallCondVar.notify_all();
+}
+
 } // namespace aos::sm::image
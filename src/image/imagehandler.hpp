@@ -7,10 +7,24 @@
 #ifndef IMAGEHANDLER_HPP_
 #define IMAGEHANDLER_HPP_
 
+#include <condition_variable>
+#include <filesystem>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <aos/common/crypto/crypto.hpp>
 #include <aos/common/tools/error.hpp>
 #include <aos/sm/image/imagehandler.hpp>
 
+#include "config.hpp"
+#include "filestore.hpp"
+#include "installjournal.hpp"
+#include "tarextractor.hpp"
+
 namespace aos::sm::image {
 
 /**
@@ -26,10 +40,12 @@ public:
      * @param serviceSpaceAllocator service space allocator.
      * @param ociSpec OCI spec.
      * @param uid default user id.
+     * @param config image handler configuration.
      * @return Error.
      */
     Error Init(crypto::HasherItf& hasher, spaceallocator::SpaceAllocatorItf& layerSpaceAllocator,
-        spaceallocator::SpaceAllocatorItf& serviceSpaceAllocator, oci::OCISpecItf& ociSpec, uint32_t uid = 0);
+        spaceallocator::SpaceAllocatorItf& serviceSpaceAllocator, oci::OCISpecItf& ociSpec, uint32_t uid = 0,
+        const ImageHandlerConfig& config = {});
 
     /**
      * Installs layer from the provided archive.
@@ -55,6 +71,34 @@ public:
     RetWithError<StaticString<cFilePathLen>> InstallService(const String& archivePath, const String& installBasePath,
         const ServiceInfo& service, UniquePtr<aos::spaceallocator::SpaceItf>& space) override;
 
+    /**
+     * Installs layer from the archive stream. Archive is hashed and unpacked while it is being read, so the layer can
+     * be installed while the archive is still being downloaded. Layer is installed only if the archive digest matches.
+     * Archive stream is not read if interrupted install of the same archive is resumed.
+     *
+     * @param archive archive stream.
+     * @param installBasePath installation base path.
+     * @param layer layer info.
+     * @param space[out] installed layer space.
+     * @return RetWithError<StaticString<cFilePathLen>>.
+     */
+    RetWithError<StaticString<cFilePathLen>> InstallLayer(std::istream& archive, const String& installBasePath,
+        const LayerInfo& layer, UniquePtr<aos::spaceallocator::SpaceItf>& space);
+
+    /**
+     * Installs service from the archive stream. Archive is hashed and unpacked while it is being read, so the service
+     * can be installed while the archive is still being downloaded. Service is installed only if the archive digest
+     * matches. Archive stream is not read if interrupted install of the same archive is resumed.
+     *
+     * @param archive archive stream.
+     * @param installBasePath installation base path.
+     * @param service service info.
+     * @param space[out] installed service space.
+     * @return RetWithError<StaticString<cFilePathLen>>.
+     */
+    RetWithError<StaticString<cFilePathLen>> InstallService(std::istream& archive, const String& installBasePath,
+        const ServiceInfo& service, UniquePtr<aos::spaceallocator::SpaceItf>& space);
+
     /**
      * Validates service.
      *
@@ -79,18 +123,53 @@ public:
 private:
     Error ValidateServiceConfig(const String& path, const String& digest) const;
     Error ValidateService(const String& path, const oci::ImageManifest& manifest) const;
+    Error ValidateServiceManifest(const String& path, const oci::ImageManifest& manifest) const;
     Error ValidateDigest(const String& path, const String& digest) const;
+    Error CheckDigest(const std::filesystem::path& path, const String& digest) const;
+    RetWithError<std::string> CalculateFingerprint(const std::filesystem::path& path) const;
     RetWithError<StaticArray<uint8_t, cSHA256Size>> CalculateHash(const String& path, crypto::Hash algorithm) const;
-    Error CheckFileInfo(const String& path, uint64_t size, const Array<uint8_t>& sha256) const;
-    Error UnpackArchive(const String& source, const String& destination) const;
-    Error PrepareServiceFS(const String& baseDir, const ServiceInfo& service, oci::ImageManifest& manifest,
+    RetWithError<uint64_t> UnpackVerifiedArchive(std::istream& archive, const std::filesystem::path& destination,
+        uint64_t size, const Array<uint8_t>& sha3, UniquePtr<aos::spaceallocator::SpaceItf>& space,
+        TarExtractor::EntryHandler entryHandler = {}) const;
+    RetWithError<uint64_t> UnpackArchive(std::istream& stream, const std::filesystem::path& destination,
+        UniquePtr<aos::spaceallocator::SpaceItf>& space, uint64_t reserved = 0,
+        TarExtractor::EntryHandler entryHandler = {}, TarExtractor::FileHandler fileHandler = {},
+        const std::optional<std::pair<uint32_t, uint32_t>>& owner = std::nullopt) const;
+    TarExtractor::FileHandler FileStoreHandler(
+        bool allowHardLink, UniquePtr<aos::spaceallocator::SpaceItf>& space) const;
+    Error UnpackEmbeddedArchive(TarReader& reader, const TarEntry& entry, const std::filesystem::path& destination,
         UniquePtr<aos::spaceallocator::SpaceItf>& space) const;
+    Error StoreLayerImage(std::istream& stream, const std::filesystem::path& path, uint64_t size,
+        UniquePtr<aos::spaceallocator::SpaceItf>& space) const;
+    Error UnpackRootFS(const std::filesystem::path& archivePath, const std::filesystem::path& destination,
+        const String& digest, uint32_t uid, uint32_t gid, UniquePtr<aos::spaceallocator::SpaceItf>& space) const;
+    Error CheckStagedRootFS(
+        const std::filesystem::path& baseDir, const std::filesystem::path& tmpRootFS, InstallJournal& journal) const;
+    Error PrepareServiceFS(const String& baseDir, const ServiceInfo& service, oci::ImageManifest& manifest,
+        UniquePtr<aos::spaceallocator::SpaceItf>& space, InstallJournal& journal) const;
+    RetWithError<std::filesystem::path> FindDeltaBase(
+        const std::filesystem::path& baseDir, const std::string& baseDigest) const;
+    Error CloneDeltaBase(const std::filesystem::path& baseDir, const std::string& baseDigest,
+        const std::filesystem::path& destination, UniquePtr<aos::spaceallocator::SpaceItf>& space) const;
+    Error RemoveDeltaFiles(
+        const std::filesystem::path& rootFS, const std::vector<std::filesystem::path>& removed) const;
+    void  AcquireInstall(const std::string& installKey);
+    void  ReleaseInstall(const std::string& installKey);
+    void  AcquireInstallDir(const std::string& installDir);
+    void  ReleaseInstallDir(const std::string& installDir);
 
     crypto::HasherItf*                 mHasher                = nullptr;
     spaceallocator::SpaceAllocatorItf* mLayerSpaceAllocator   = nullptr;
     spaceallocator::SpaceAllocatorItf* mServiceSpaceAllocator = nullptr;
     mutable oci::OCISpecItf*           mOCISpec               = nullptr;
     uint32_t                           mUID                   = 0;
+    ImageHandlerConfig                 mConfig;
+    FileStore                          mFileStore;
+    size_t                             mMaxInstalls = 0;
+    std::set<std::string>              mActiveInstalls;
+    std::set<std::string>              mActiveInstallDirs;
+    std::mutex                         mInstallMutex;
+    std::condition_variable            mInstallCondVar;
 };
 
 } // namespace aos::sm::image
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+#include <utils/exception.hpp>
+
+#include "installjournal.hpp"
+#include "logger/logmodule.hpp"
+
+namespace aos::sm::image {
+
+namespace {
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+Error SyncPath(const std::filesystem::path& path, bool isDir)
+{
+    auto fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | (isDir ? O_DIRECTORY : 0));
+    if (fd < 0) {
+        return Error(errno);
+    }
+
+    auto err = (fsync(fd) != 0) ? Error(errno) : ErrorEnum::eNone;
+
+    close(fd);
+
+    return err;
+}
+
+Error SyncTree(const std::filesystem::path& path)
+{
+    try {
+        const auto isDir = std::filesystem::is_directory(std::filesystem::symlink_status(path));
+
+        if (isDir) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                const auto status = entry.symlink_status();
+
+                // Entries of other types have no data, they are synced with their parent dir
+                if (!std::filesystem::is_regular_file(status) && !std::filesystem::is_directory(status)) {
+                    continue;
+                }
+
+                if (auto err = SyncPath(entry.path(), std::filesystem::is_directory(status)); !err.IsNone()) {
+                    return err;
+                }
+            }
+        }
+
+        if (auto err = SyncPath(path, isDir); !err.IsNone()) {
+            return err;
+        }
+    } catch (const std::exception& e) {
+        return common::utils::ToAosError(e);
+    }
+
+    // Parent dir holds the entry of the synced path
+    return SyncPath(path.parent_path(), true);
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+Error InstallJournal::Init(const std::filesystem::path& path, const std::string& installID)
+{
+    mPath      = path;
+    mInstallID = installID;
+    mStage     = InstallStage::eNone;
+    mSize      = 0;
+    mDigest.clear();
+
+    std::ifstream file(mPath);
+    if (!file.is_open()) {
+        return ErrorEnum::eNone;
+    }
+
+    std::string id;
+    int         stage = 0;
+
+    file >> id >> stage >> mSize;
+
+    const auto corrupted = file.fail();
+
+    // Digest goes last as it may be empty
+    file >> mDigest;
+
+    // Partial install of another image or corrupted journal can't be resumed, it is started over
+    if (corrupted || id != mInstallID || stage <= static_cast<int>(InstallStage::eStarted)
+        || stage > static_cast<int>(InstallStage::eRootFSHashed)) {
+        mStage = InstallStage::eStarted;
+        mSize  = 0;
+        mDigest.clear();
+
+        return ErrorEnum::eNone;
+    }
+
+    mStage = static_cast<InstallStage>(stage);
+
+    LOG_DBG() << "Install journal loaded: path=" << mPath.c_str() << ", stage=" << stage;
+
+    return ErrorEnum::eNone;
+}
+
+Error InstallJournal::SetStage(
+    InstallStage stage, const std::string& digest, const std::vector<std::filesystem::path>& paths, uint64_t size)
+{
+    LOG_DBG() << "Set install stage: path=" << mPath.c_str() << ", stage=" << static_cast<int>(stage);
+
+    const auto tmpPath = mPath.string() + cTmpSuffix;
+
+    // Stage data should be on disk before the stage is marked as completed
+    for (const auto& path : paths) {
+        if (auto err = SyncTree(path); !err.IsNone()) {
+            return AOS_ERROR_WRAP(Error(err, "failed to sync install data"));
+        }
+    }
+
+    const auto record = mInstallID + " " + std::to_string(static_cast<int>(stage)) + " " + std::to_string(size) + " "
+        + digest + "\n";
+
+    auto fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return AOS_ERROR_WRAP(Error(errno, "failed to create install journal"));
+    }
+
+    Error err = ErrorEnum::eNone;
+
+    if (auto written = write(fd, record.c_str(), record.size()); written != static_cast<ssize_t>(record.size())) {
+        err = written < 0 ? Error(errno) : Error(ErrorEnum::eFailed);
+    } else if (fsync(fd) != 0) {
+        err = Error(errno);
+    }
+
+    close(fd);
+
+    if (!err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "failed to write install journal"));
+    }
+
+    if (rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        return AOS_ERROR_WRAP(Error(errno, "failed to save install journal"));
+    }
+
+    if (err = SyncPath(mPath.parent_path(), true); !err.IsNone()) {
+        return AOS_ERROR_WRAP(Error(err, "failed to sync install journal"));
+    }
+
+    mStage  = stage;
+    mSize   = size;
+    mDigest = digest;
+
+    return ErrorEnum::eNone;
+}
+
+Error InstallJournal::Remove()
+{
+    mStage = InstallStage::eNone;
+    mSize  = 0;
+    mDigest.clear();
+
+    std::error_code ec;
+
+    std::filesystem::remove(mPath.string() + cTmpSuffix, ec);
+
+    if (std::filesystem::remove(mPath, ec); ec.value() != 0) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, ec.message().c_str()));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+} // namespace aos::sm::image
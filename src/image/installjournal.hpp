@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INSTALLJOURNAL_HPP_
+#define INSTALLJOURNAL_HPP_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::image {
+
+/**
+ * Install stage.
+ */
+enum class InstallStage {
+    eNone,           // install is not started
+    eStarted,        // install dir is created, its content is incomplete
+    eUnpacked,       // image archive is unpacked and verified
+    eRootFSUnpacked, // service rootfs is unpacked, verified, owned by the service user and its digest is calculated
+    eRootFSHashed,   // service rootfs archive is removed
+};
+
+/**
+ * Journal of image install stages. Completed stages survive node reboots and SM crashes, so an interrupted install is
+ * resumed from the last completed stage instead of starting over.
+ */
+class InstallJournal {
+public:
+    /**
+     * Loads install journal.
+     *
+     * @param path journal file path, should be on the same file system as the install dir.
+     * @param installID identifies installed image, journal of another image is reset to the started stage.
+     * @return Error.
+     */
+    Error Init(const std::filesystem::path& path, const std::string& installID);
+
+    /**
+     * Returns last completed stage.
+     *
+     * @return InstallStage.
+     */
+    InstallStage GetStage() const { return mStage; }
+
+    /**
+     * Returns digest saved with the last completed stage.
+     *
+     * @return const std::string&.
+     */
+    const std::string& GetDigest() const { return mDigest; }
+
+    /**
+     * Returns size saved with the last completed stage.
+     *
+     * @return uint64_t.
+     */
+    uint64_t GetSize() const { return mSize; }
+
+    /**
+     * Saves completed stage. Files and dirs produced by the stage are synced before the stage is saved.
+     *
+     * @param stage completed stage.
+     * @param digest optional digest of the stage result, used to verify the result when install is resumed.
+     * @param paths files and dirs produced by the stage, dirs are synced recursively.
+     * @param size optional size of the stage result, used as a cheap check of the result when install is resumed.
+     * @return Error.
+     */
+    Error SetStage(InstallStage stage, const std::string& digest = "",
+        const std::vector<std::filesystem::path>& paths = {}, uint64_t size = 0);
+
+    /**
+     * Removes install journal.
+     *
+     * @return Error.
+     */
+    Error Remove();
+
+private:
+    static constexpr auto cTmpSuffix = ".tmp";
+
+    std::filesystem::path mPath;
+    std::string           mInstallID;
+    InstallStage          mStage = InstallStage::eNone;
+    uint64_t              mSize = 0;
+    std::string           mDigest;
+};
+
+} // namespace aos::sm::image
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+#include "readahead.hpp"
+
+namespace aos::sm::image {
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+ReadAheadReader::ReadAheadReader(size_t bufferSize, size_t bufferCount)
+    : mBufferSize(bufferSize)
+{
+    for (size_t i = 0; i < bufferCount; i++) {
+        auto buffer = static_cast<uint8_t*>(std::aligned_alloc(cBufferAlignment, mBufferSize));
+        if (buffer == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        mBuffers.emplace_back(buffer);
+    }
+}
+
+Error ReadAheadReader::Read(const std::vector<std::filesystem::path>& files, const ChunkHandler& handler)
+{
+    {
+        std::lock_guard lock {mMutex};
+
+        mFreeBuffers.clear();
+        mChunks.clear();
+
+        for (size_t i = 0; i < mBuffers.size(); i++) {
+            mFreeBuffers.push_back(i);
+        }
+
+        mDone    = false;
+        mStopped = false;
+        mError   = ErrorEnum::eNone;
+    }
+
+    std::thread readThread(&ReadAheadReader::ReadFiles, this, std::cref(files));
+
+    Error err;
+
+    while (true) {
+        Chunk chunk;
+
+        {
+            std::unique_lock lock {mMutex};
+
+            mCondVar.wait(lock, [this] { return !mChunks.empty() || mDone; });
+
+            if (mChunks.empty()) {
+                err = mError;
+
+                break;
+            }
+
+            chunk = mChunks.front();
+            mChunks.pop_front();
+        }
+
+        err = handler(mBuffers[chunk.mIndex].get(), chunk.mSize);
+
+        {
+            std::lock_guard lock {mMutex};
+
+            mFreeBuffers.push_back(chunk.mIndex);
+
+            if (!err.IsNone()) {
+                mStopped = true;
+            }
+        }
+
+        mCondVar.notify_all();
+
+        if (!err.IsNone()) {
+            break;
+        }
+    }
+
+    readThread.join();
+
+    return err;
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+void ReadAheadReader::ReadFiles(const std::vector<std::filesystem::path>& files)
+{
+    Error err;
+
+    for (const auto& file : files) {
+        if (err = ReadFile(file); !err.IsNone()) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard lock {mMutex};
+
+        mDone  = true;
+        mError = err;
+    }
+
+    mCondVar.notify_all();
+}
+
+Error ReadAheadReader::ReadFile(const std::filesystem::path& file)
+{
+    auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "can't open file"));
+    }
+
+    [[maybe_unused]] auto closeFD = DeferRelease(&fd, [](const int* fd) { close(*fd); });
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    while (true) {
+        size_t index = 0;
+
+        {
+            std::unique_lock lock {mMutex};
+
+            mCondVar.wait(lock, [this] { return !mFreeBuffers.empty() || mStopped; });
+
+            if (mStopped) {
+                return ErrorEnum::eNone;
+            }
+
+            index = mFreeBuffers.front();
+            mFreeBuffers.pop_front();
+        }
+
+        ssize_t size = 0;
+
+        do {
+            size = read(fd, mBuffers[index].get(), mBufferSize);
+        } while (size < 0 && errno == EINTR);
+
+        if (size <= 0) {
+            Error err = size < 0 ? Error(errno, "can't read file") : ErrorEnum::eNone;
+
+            std::lock_guard lock {mMutex};
+
+            mFreeBuffers.push_back(index);
+
+            return AOS_ERROR_WRAP(err);
+        }
+
+        {
+            std::lock_guard lock {mMutex};
+
+            mChunks.push_back({index, static_cast<size_t>(size)});
+        }
+
+        mCondVar.notify_all();
+    }
+}
+
+} // namespace aos::sm::image
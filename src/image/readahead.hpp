@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef READAHEAD_HPP_
+#define READAHEAD_HPP_
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::image {
+
+/**
+ * Reads files one after another in a background thread into a ring of reusable buffers. Data is passed to the
+ * consumer in file order, so reading the next chunks overlaps with processing the current one.
+ */
+class ReadAheadReader {
+public:
+    /**
+     * Chunk handler.
+     */
+    using ChunkHandler = std::function<Error(uint8_t* data, size_t size)>;
+
+    /**
+     * Constructor.
+     *
+     * @param bufferSize size of each buffer.
+     * @param bufferCount number of buffers.
+     */
+    ReadAheadReader(size_t bufferSize, size_t bufferCount);
+
+    /**
+     * Reads files and passes their content to the handler.
+     *
+     * @param files files to read.
+     * @param handler chunk handler.
+     * @return Error.
+     */
+    Error Read(const std::vector<std::filesystem::path>& files, const ChunkHandler& handler);
+
+private:
+    static constexpr auto cBufferAlignment = 4096;
+
+    struct Chunk {
+        size_t mIndex;
+        size_t mSize;
+    };
+
+    struct FreeDeleter {
+        void operator()(uint8_t* ptr) const { std::free(ptr); }
+    };
+
+    void  ReadFiles(const std::vector<std::filesystem::path>& files);
+    Error ReadFile(const std::filesystem::path& file);
+
+    size_t                                             mBufferSize;
+    std::vector<std::unique_ptr<uint8_t, FreeDeleter>> mBuffers;
+    std::mutex                                         mMutex;
+    std::condition_variable                            mCondVar;
+    std::deque<size_t>                                 mFreeBuffers;
+    std::deque<Chunk>                                  mChunks;
+    bool                                               mDone    = false;
+    bool                                               mStopped = false;
+    Error                                              mError;
+};
+
+} // namespace aos::sm::image
+
+#endif
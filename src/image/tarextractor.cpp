@@ -0,0 +1,898 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <string_view>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <Poco/InflatingStream.h>
+
+#include <utils/exception.hpp>
+
+#include "hashstream.hpp"
+#include "logger/logmodule.hpp"
+#include "tarextractor.hpp"
+#include "zstdstream.hpp"
+
+namespace aos::sm::image {
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+// Tar header fields: offset and length.
+constexpr std::pair<size_t, size_t> cNameField     = {0, 100};
+constexpr std::pair<size_t, size_t> cModeField     = {100, 8};
+constexpr std::pair<size_t, size_t> cUIDField      = {108, 8};
+constexpr std::pair<size_t, size_t> cGIDField      = {116, 8};
+constexpr std::pair<size_t, size_t> cSizeField     = {124, 12};
+constexpr std::pair<size_t, size_t> cModTimeField  = {136, 12};
+constexpr std::pair<size_t, size_t> cChecksumField = {148, 8};
+constexpr std::pair<size_t, size_t> cLinkNameField = {157, 100};
+constexpr std::pair<size_t, size_t> cMagicField    = {257, 6};
+constexpr std::pair<size_t, size_t> cDevMajorField = {329, 8};
+constexpr std::pair<size_t, size_t> cDevMinorField = {337, 8};
+constexpr std::pair<size_t, size_t> cPrefixField   = {345, 155};
+constexpr size_t                    cTypeOffset    = 156;
+constexpr auto                      cUstarMagic    = "ustar";
+
+constexpr auto cPAXXAttrPrefix        = "SCHILY.xattr.";
+constexpr auto cLibarchiveXAttrPrefix = "LIBARCHIVE.xattr.";
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+std::string GetString(const char* block, std::pair<size_t, size_t> field)
+{
+    const auto* begin = block + field.first;
+
+    return std::string(begin, strnlen(begin, field.second));
+}
+
+template <size_t cSize>
+bool HasMagic(std::string_view data, const unsigned char (&magic)[cSize])
+{
+    return data.substr(0, cSize) == std::string_view(reinterpret_cast<const char*>(magic), cSize);
+}
+
+uint64_t GetNumber(const char* block, std::pair<size_t, size_t> field)
+{
+    const auto* data = reinterpret_cast<const uint8_t*>(block + field.first);
+
+    // Base-256 encoding is used by GNU tar for values that don't fit into octal field
+    if (data[0] & 0x80) {
+        uint64_t value = data[0] & 0x7f;
+
+        for (size_t i = 1; i < field.second; i++) {
+            value = (value << 8) | data[i];
+        }
+
+        return value;
+    }
+
+    uint64_t value = 0;
+    size_t   i     = 0;
+
+    while (i < field.second && (data[i] == ' ' || data[i] == '\0')) {
+        i++;
+    }
+
+    for (; i < field.second && data[i] >= '0' && data[i] <= '7'; i++) {
+        value = (value << 3) | (data[i] - '0');
+    }
+
+    return value;
+}
+
+bool IsZeroBlock(const char* block, size_t size)
+{
+    return std::all_of(block, block + size, [](char c) { return c == '\0'; });
+}
+
+bool CheckChecksum(const char* block, size_t size)
+{
+    uint64_t unsignedSum = 0;
+    int64_t  signedSum   = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        auto c = (i >= cChecksumField.first && i < cChecksumField.first + cChecksumField.second) ? ' ' : block[i];
+
+        unsignedSum += static_cast<uint8_t>(c);
+        signedSum += static_cast<int8_t>(c);
+    }
+
+    auto checksum = GetNumber(block, cChecksumField);
+
+    return checksum == unsignedSum || static_cast<int64_t>(checksum) == signedSum;
+}
+
+std::string NormalizePath(const std::string& path)
+{
+    auto normalized = std::filesystem::path(path).relative_path().lexically_normal().string();
+
+    while (!normalized.empty() && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+
+    return normalized == "." ? "" : normalized;
+}
+
+bool HasPrefix(const std::string& str, const char* prefix)
+{
+    return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+void CheckXAttr(const std::string& name)
+{
+    // Overlay and SM own xattrs change how the image is mounted, so images can't set them
+    if (HasPrefix(name, "trusted.") || HasPrefix(name, "user.aos.")) {
+        AOS_ERROR_THROW(ErrorEnum::eNotSupported, "tar entry xattr is not allowed");
+    }
+}
+
+void SetXAttrs(const std::filesystem::path& path, int fd, const TarEntry& entry)
+{
+    for (const auto& [name, value] : entry.mXAttrs) {
+        auto ret = fd >= 0 ? fsetxattr(fd, name.c_str(), value.data(), value.size(), 0)
+                           : lsetxattr(path.c_str(), name.c_str(), value.data(), value.size(), 0);
+
+        // Xattr which can't be restored, e.g. file capability without privileges, fails the extraction
+        if (ret != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't set xattr");
+        }
+    }
+}
+
+void RemoveExisting(const std::filesystem::path& path)
+{
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        AOS_ERROR_THROW(Error(errno), "can't remove existing file");
+    }
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * TarReader
+ **********************************************************************************************************************/
+
+TarReader::TarReader(std::istream& stream)
+    : mStream(stream)
+{
+}
+
+RetWithError<bool> TarReader::Next(TarEntry& entry)
+{
+    if (auto err = Skip(mRemaining + mPadding); !err.IsNone()) {
+        return {false, err};
+    }
+
+    mRemaining = 0;
+    mPadding   = 0;
+
+    std::string longName, longLink, pax;
+    char        block[cBlockSize];
+
+    while (true) {
+        if (auto err = ReadBlock(block); !err.IsNone()) {
+            return {false, err};
+        }
+
+        if (IsZeroBlock(block, sizeof(block))) {
+            return {false, ErrorEnum::eNone};
+        }
+
+        if (!CheckChecksum(block, sizeof(block))) {
+            return {false, AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidChecksum, "invalid tar header checksum"))};
+        }
+
+        auto type = block[cTypeOffset];
+        auto size = GetNumber(block, cSizeField);
+
+        Error err = ErrorEnum::eNone;
+
+        switch (type) {
+        case 'L':
+            err = ReadExtension(size, longName);
+            break;
+
+        case 'K':
+            err = ReadExtension(size, longLink);
+            break;
+
+        case 'x':
+            err = ReadExtension(size, pax);
+            break;
+
+        case 'g': {
+            std::string global;
+
+            if (err = ReadExtension(size, global); err.IsNone()) {
+                mGlobalPAX.clear();
+
+                err = ParsePAX(global, mGlobalPAX);
+            }
+
+            break;
+        }
+
+        default:
+            entry = TarEntry {};
+
+            entry.mPath = GetString(block, cNameField);
+
+            if (GetString(block, cMagicField) == cUstarMagic) {
+                if (auto prefix = GetString(block, cPrefixField); !prefix.empty()) {
+                    entry.mPath = prefix + "/" + entry.mPath;
+                }
+            }
+
+            entry.mLinkPath = GetString(block, cLinkNameField);
+            entry.mSize     = size;
+            entry.mMode     = GetNumber(block, cModeField) & 07777;
+            entry.mUID      = GetNumber(block, cUIDField);
+            entry.mGID      = GetNumber(block, cGIDField);
+            entry.mModTime  = GetNumber(block, cModTimeField);
+            entry.mDevMajor = GetNumber(block, cDevMajorField);
+            entry.mDevMinor = GetNumber(block, cDevMinorField);
+
+            if (!longName.empty()) {
+                entry.mPath = longName;
+            }
+
+            if (!longLink.empty()) {
+                entry.mLinkPath = longLink;
+            }
+
+            PAXRecords records;
+
+            if (err = ParsePAX(pax, records); !err.IsNone()) {
+                return {false, err};
+            }
+
+            // Local records override global ones
+            if (err = ApplyPAX(mGlobalPAX, entry); !err.IsNone()) {
+                return {false, err};
+            }
+
+            if (err = ApplyPAX(records, entry); !err.IsNone()) {
+                return {false, err};
+            }
+
+            mRemaining = entry.mSize;
+            mPadding   = (cBlockSize - entry.mSize % cBlockSize) % cBlockSize;
+
+            switch (type) {
+            case '\0':
+            case '0':
+            case '7':
+                entry.mType = TarEntry::Type::eFile;
+                break;
+
+            case '1':
+                entry.mType = TarEntry::Type::eHardLink;
+                break;
+
+            case '2':
+                entry.mType = TarEntry::Type::eSymLink;
+                break;
+
+            case '3':
+                entry.mType = TarEntry::Type::eCharDevice;
+                break;
+
+            case '4':
+                entry.mType = TarEntry::Type::eBlockDevice;
+                break;
+
+            case '5':
+                entry.mType = TarEntry::Type::eDir;
+                break;
+
+            case '6':
+                entry.mType = TarEntry::Type::eFIFO;
+                break;
+
+            default:
+                // Skipped entry would leave extracted tree incomplete
+                LOG_ERR() << "Unsupported tar entry: path=" << entry.mPath.c_str() << ", type=" << type;
+
+                return {false, AOS_ERROR_WRAP(Error(ErrorEnum::eNotSupported, "unsupported tar entry type"))};
+            }
+
+            // Only regular files have data
+            if (entry.mType != TarEntry::Type::eFile) {
+                if (err = Skip(mRemaining + mPadding); !err.IsNone()) {
+                    return {false, err};
+                }
+
+                mRemaining  = 0;
+                mPadding    = 0;
+                entry.mSize = 0;
+            }
+
+            entry.mPath     = NormalizePath(entry.mPath);
+            entry.mLinkPath = entry.mType == TarEntry::Type::eHardLink ? NormalizePath(entry.mLinkPath)
+                                                                        : entry.mLinkPath;
+
+            return {true, ErrorEnum::eNone};
+        }
+
+        if (!err.IsNone()) {
+            return {false, err};
+        }
+    }
+}
+
+RetWithError<size_t> TarReader::Read(char* buffer, size_t size)
+{
+    size = static_cast<size_t>(std::min<uint64_t>(size, mRemaining));
+    if (size == 0) {
+        return {0, ErrorEnum::eNone};
+    }
+
+    mStream.read(buffer, size);
+
+    if (static_cast<size_t>(mStream.gcount()) != size) {
+        return {0, AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "unexpected end of tar archive"))};
+    }
+
+    mRemaining -= size;
+
+    return {size, ErrorEnum::eNone};
+}
+
+/***********************************************************************************************************************
+ * TarReader private
+ **********************************************************************************************************************/
+
+Error TarReader::ReadBlock(char* block)
+{
+    mStream.read(block, cBlockSize);
+
+    if (mStream.gcount() != cBlockSize) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "unexpected end of tar archive"));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error TarReader::Skip(uint64_t size)
+{
+    while (size > 0) {
+        auto chunk = static_cast<std::streamsize>(std::min<uint64_t>(size, std::numeric_limits<int32_t>::max()));
+
+        mStream.ignore(chunk);
+
+        if (mStream.gcount() != chunk) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "unexpected end of tar archive"));
+        }
+
+        size -= chunk;
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error TarReader::ReadExtension(uint64_t size, std::string& data)
+{
+    data.resize(size);
+
+    mStream.read(data.data(), size);
+
+    if (static_cast<uint64_t>(mStream.gcount()) != size) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "unexpected end of tar archive"));
+    }
+
+    // GNU long names are null terminated
+    data.resize(strnlen(data.c_str(), data.size()));
+
+    return Skip((cBlockSize - size % cBlockSize) % cBlockSize);
+}
+
+Error TarReader::ParsePAX(const std::string& data, PAXRecords& records)
+{
+    size_t pos = 0;
+
+    while (pos < data.size()) {
+        auto space = data.find(' ', pos);
+        if (space == std::string::npos) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidArgument, "invalid PAX record"));
+        }
+
+        auto length = std::strtoull(data.c_str() + pos, nullptr, 10);
+        if (length == 0 || pos + length > data.size() || space + 1 >= pos + length) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidArgument, "invalid PAX record"));
+        }
+
+        // Record format: "<length> <key>=<value>\n"
+        auto record = data.substr(space + 1, pos + length - space - 2);
+
+        pos += length;
+
+        if (auto equal = record.find('='); equal != std::string::npos) {
+            records.emplace_back(record.substr(0, equal), record.substr(equal + 1));
+        }
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error TarReader::ApplyPAX(const PAXRecords& records, TarEntry& entry)
+{
+    for (const auto& [key, value] : records) {
+        if (HasPrefix(key, cPAXXAttrPrefix)) {
+            auto name = key.substr(strlen(cPAXXAttrPrefix));
+
+            entry.mXAttrs.erase(std::remove_if(entry.mXAttrs.begin(), entry.mXAttrs.end(),
+                                    [&name](const auto& xattr) { return xattr.first == name; }),
+                entry.mXAttrs.end());
+            entry.mXAttrs.emplace_back(std::move(name), value);
+
+            continue;
+        }
+
+        // Libarchive records have encoded names and values, they are rejected instead of being dropped silently
+        if (HasPrefix(key, cLibarchiveXAttrPrefix)) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eNotSupported, "unsupported PAX xattr record"));
+        }
+
+        if (key == "path") {
+            entry.mPath = value;
+        } else if (key == "linkpath") {
+            entry.mLinkPath = value;
+        } else if (key == "size") {
+            entry.mSize = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "uid") {
+            entry.mUID = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "gid") {
+            entry.mGID = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "mtime") {
+            entry.mModTime = std::strtoll(value.c_str(), nullptr, 10);
+        }
+    }
+
+    return ErrorEnum::eNone;
+}
+
+/***********************************************************************************************************************
+ * TarEntryStreamBuf
+ **********************************************************************************************************************/
+
+TarEntryStreamBuf::TarEntryStreamBuf(TarReader& reader)
+    : mReader(reader)
+    , mBuffer(cBufferSize)
+{
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data());
+}
+
+TarEntryStreamBuf::int_type TarEntryStreamBuf::underflow()
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if (!mError.IsNone()) {
+        return traits_type::eof();
+    }
+
+    auto [size, err] = mReader.Read(mBuffer.data(), mBuffer.size());
+    if (!err.IsNone()) {
+        mError = AOS_ERROR_WRAP(err);
+
+        return traits_type::eof();
+    }
+
+    if (size == 0) {
+        return traits_type::eof();
+    }
+
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data() + size);
+
+    return traits_type::to_int_type(*gptr());
+}
+
+/***********************************************************************************************************************
+ * TarExtractor
+ **********************************************************************************************************************/
+
+TarExtractor::TarExtractor(const std::filesystem::path& destination)
+    : mDestination(destination)
+    , mIsRoot(geteuid() == 0)
+    , mBuffer(cBufferSize)
+{
+}
+
+Error TarExtractor::Extract(std::istream& stream)
+{
+    // Stream is buffered, so the whole compression magic can be checked before the decoder is chosen
+    HashStreamBuf sourceBuf(stream);
+    std::istream  source(&sourceBuf);
+
+    const auto magic = sourceBuf.Peek(sizeof(ZstdStreamBuf::cMagic));
+
+    if (HasMagic(magic, cGzipMagic)) {
+        Poco::InflatingInputStream gzipStream(source, Poco::InflatingStreamBuf::STREAM_GZIP);
+
+        return ExtractTar(gzipStream);
+    }
+
+    if (HasMagic(magic, ZstdStreamBuf::cMagic)) {
+        ZstdStreamBuf zstdBuf(source);
+        std::istream  zstdStream(&zstdBuf);
+
+        // Space for the whole tar stream is requested at once if the frame header declares its size
+        if (mSizeHandler && zstdBuf.ContentSize() != 0) {
+            if (auto err = mSizeHandler(zstdBuf.ContentSize()); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
+
+        auto err = ExtractTar(zstdStream);
+
+        // Decompression error is the root cause of the tar read failure
+        if (auto zstdErr = zstdBuf.GetError(); !zstdErr.IsNone()) {
+            return AOS_ERROR_WRAP(zstdErr);
+        }
+
+        return err;
+    }
+
+    return ExtractTar(source);
+}
+
+/***********************************************************************************************************************
+ * TarExtractor private
+ **********************************************************************************************************************/
+
+Error TarExtractor::ExtractTar(std::istream& stream)
+{
+    try {
+        std::filesystem::create_directories(mDestination);
+
+        TarReader reader(stream);
+        TarEntry  entry;
+
+        while (true) {
+            auto [hasEntry, err] = reader.Next(entry);
+            if (!err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+
+            if (!hasEntry) {
+                break;
+            }
+
+            if (entry.mPath.empty()) {
+                continue;
+            }
+
+            if (mOwner) {
+                entry.mUID = mOwner->first;
+                entry.mGID = mOwner->second;
+            }
+
+            CheckPath(entry.mPath);
+            MakeDirs(std::filesystem::path(entry.mPath).parent_path(), true);
+
+            for (const auto& xattr : entry.mXAttrs) {
+                CheckXAttr(xattr.first);
+            }
+
+            if (mEntryHandler) {
+                bool handled = false;
+
+                if (Tie(handled, err) = mEntryHandler(entry, reader); !err.IsNone()) {
+                    return AOS_ERROR_WRAP(err);
+                }
+
+                if (handled) {
+                    continue;
+                }
+            }
+
+            ExtractEntry(entry, reader);
+        }
+
+        // Set directory attributes at the end as extracting entries modifies them
+        for (auto it = mDirs.rbegin(); it != mDirs.rend(); ++it) {
+            SetAttributes(mDestination / it->mPath, *it);
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+void TarExtractor::ExtractEntry(const TarEntry& entry, TarReader& reader)
+{
+    const auto path = mDestination / entry.mPath;
+
+    switch (entry.mType) {
+    case TarEntry::Type::eDir: {
+        // Directory entry replacing a symlink would apply its attributes to the symlink target
+        if (mSymLinks.count(entry.mPath) != 0) {
+            AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "directory entry is a symlink");
+        }
+
+        if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+            AOS_ERROR_THROW(Error(errno), "can't create directory");
+        }
+
+        struct stat st;
+
+        if (lstat(path.c_str(), &st) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't get directory status");
+        }
+
+        if (!S_ISDIR(st.st_mode)) {
+            AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "directory entry is not a directory");
+        }
+
+        mDirs.push_back(entry);
+
+        return;
+    }
+
+    case TarEntry::Type::eFile:
+        WriteFile(path, entry, reader);
+
+        return;
+
+    case TarEntry::Type::eHardLink:
+        CheckPath(entry.mLinkPath);
+        MakeDirs(std::filesystem::path(entry.mLinkPath).parent_path(), false);
+        RemoveExisting(path);
+
+        if (link((mDestination / entry.mLinkPath).c_str(), path.c_str()) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create hard link");
+        }
+
+        return;
+
+    case TarEntry::Type::eSymLink:
+        RemoveExisting(path);
+
+        if (symlink(entry.mLinkPath.c_str(), path.c_str()) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create symlink");
+        }
+
+        mSymLinks.insert(entry.mPath);
+
+        break;
+
+    case TarEntry::Type::eCharDevice:
+    case TarEntry::Type::eBlockDevice:
+    case TarEntry::Type::eFIFO: {
+        auto type = entry.mType == TarEntry::Type::eCharDevice
+            ? S_IFCHR
+            : (entry.mType == TarEntry::Type::eBlockDevice ? S_IFBLK : S_IFIFO);
+
+        RemoveExisting(path);
+
+        if (mknod(path.c_str(), type | entry.mMode, makedev(entry.mDevMajor, entry.mDevMinor)) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create special file");
+        }
+
+        break;
+    }
+    }
+
+    SetAttributes(path, entry);
+}
+
+void TarExtractor::WriteFile(const std::filesystem::path& path, const TarEntry& entry, TarReader& reader)
+{
+    mExtractedSize += entry.mSize;
+
+    if (mSizeHandler) {
+        auto err = mSizeHandler(mExtractedSize);
+        AOS_ERROR_CHECK_AND_THROW(err, "can't extract file");
+    }
+
+    auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        RemoveExisting(path);
+
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    }
+
+    if (fd < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't create file");
+    }
+
+    [[maybe_unused]] auto closeFD = DeferRelease(&fd, [](const int* fd) { close(*fd); });
+
+    UniquePtr<crypto::HashItf> hash;
+
+    // Deduplicated files share inode, so files with xattrs are not deduplicated as xattrs are not part of the key
+    if (mFileHandler && entry.mXAttrs.empty()) {
+        Error err;
+
+        Tie(hash, err) = mHasher->CreateHash(crypto::HashEnum::eSHA256);
+        AOS_ERROR_CHECK_AND_THROW(err, "can't create hash");
+    }
+
+    while (true) {
+        auto [size, err] = reader.Read(mBuffer.data(), mBuffer.size());
+        AOS_ERROR_CHECK_AND_THROW(err, "can't read file data");
+
+        if (size == 0) {
+            break;
+        }
+
+        if (hash.Get()) {
+            err = hash->Update(Array<uint8_t>(reinterpret_cast<uint8_t*>(mBuffer.data()), size));
+            AOS_ERROR_CHECK_AND_THROW(err, "can't calculate file hash");
+        }
+
+        for (size_t written = 0; written < size;) {
+            auto ret = write(fd, mBuffer.data() + written, size - written);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                AOS_ERROR_THROW(Error(errno), "can't write file");
+            }
+
+            written += ret;
+        }
+    }
+
+    // File is deduplicated before attributes are set, as cloning resets its times and set-ID bits. Hard linked file
+    // gets attributes of the store file, which are the same as they are part of the store key.
+    if (hash.Get()) {
+        StaticArray<uint8_t, cSHA256Size> sha256;
+        StaticString<cSHA256Size * 2>     sha256Str;
+
+        auto err = hash->Finalize(sha256);
+        AOS_ERROR_CHECK_AND_THROW(err, "can't calculate file hash");
+
+        err = sha256Str.ByteArrayToHex(sha256);
+        AOS_ERROR_CHECK_AND_THROW(err, "can't convert file hash");
+
+        err = mFileHandler(path, entry, sha256Str.CStr());
+        AOS_ERROR_CHECK_AND_THROW(err, "can't handle extracted file");
+    }
+
+    if (mIsRoot && fchown(fd, entry.mUID, entry.mGID) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change file owner");
+    }
+
+    if (fchmod(fd, mIsRoot ? entry.mMode : entry.mMode & ~(S_ISUID | S_ISGID)) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change file mode");
+    }
+
+    // Changing owner drops file capabilities, so xattrs are set after it
+    SetXAttrs(path, fd, entry);
+
+    struct timespec times[2] = {{0, UTIME_OMIT}, {entry.mModTime, 0}};
+
+    if (futimens(fd, times) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change file time");
+    }
+}
+
+void TarExtractor::SetAttributes(const std::filesystem::path& path, const TarEntry& entry)
+{
+    if (entry.mType == TarEntry::Type::eDir) {
+        SetDirAttributes(path, entry);
+
+        return;
+    }
+
+    struct stat st;
+
+    if (lstat(path.c_str(), &st) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't get file status");
+    }
+
+    if (mIsRoot && lchown(path.c_str(), entry.mUID, entry.mGID) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change owner");
+    }
+
+    // Hard link may point to a symlink, so mode is set only if the entry itself is not a symlink
+    if (!S_ISLNK(st.st_mode) && chmod(path.c_str(), mIsRoot ? entry.mMode : entry.mMode & ~(S_ISUID | S_ISGID)) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change mode");
+    }
+
+    SetXAttrs(path, -1, entry);
+
+    struct timespec times[2] = {{0, UTIME_OMIT}, {entry.mModTime, 0}};
+
+    if (utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change time");
+    }
+}
+
+void TarExtractor::SetDirAttributes(const std::filesystem::path& path, const TarEntry& entry)
+{
+    // Directory is opened without following symlinks, so attributes are never applied outside destination
+    auto fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't open directory");
+    }
+
+    [[maybe_unused]] auto closeFD = DeferRelease(&fd, [](const int* fd) { close(*fd); });
+
+    if (mIsRoot && fchown(fd, entry.mUID, entry.mGID) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change directory owner");
+    }
+
+    if (fchmod(fd, mIsRoot ? entry.mMode : entry.mMode & ~(S_ISUID | S_ISGID)) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change directory mode");
+    }
+
+    SetXAttrs(path, fd, entry);
+
+    struct timespec times[2] = {{0, UTIME_OMIT}, {entry.mModTime, 0}};
+
+    if (futimens(fd, times) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't change directory time");
+    }
+}
+
+void TarExtractor::CheckPath(const std::string& path) const
+{
+    if (path == ".." || path.rfind("../", 0) == 0) {
+        AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "tar entry is outside of destination");
+    }
+
+    // Entries can't be extracted through symlinks created by the archive itself
+    for (auto pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        if (mSymLinks.count(path.substr(0, pos)) != 0) {
+            AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "tar entry is placed under symlink");
+        }
+    }
+}
+
+void TarExtractor::MakeDirs(const std::filesystem::path& path, bool create)
+{
+    std::filesystem::path current;
+
+    // Destination may already contain symlinks (e.g. delta base tree), so every component is checked on disk
+    for (const auto& component : path) {
+        current /= component;
+
+        if (mCheckedDirs.count(current.native()) != 0) {
+            continue;
+        }
+
+        const auto dirPath = mDestination / current;
+
+        struct stat st;
+
+        if (lstat(dirPath.c_str(), &st) != 0) {
+            if (errno != ENOENT || !create) {
+                AOS_ERROR_THROW(Error(errno), "can't get directory status");
+            }
+
+            if (mkdir(dirPath.c_str(), 0755) != 0) {
+                AOS_ERROR_THROW(Error(errno), "can't create directory");
+            }
+        } else if (!S_ISDIR(st.st_mode)) {
+            AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "tar entry is placed under symlink or file");
+        }
+
+        // Existing directories can't be replaced by other entries as they are removed with unlink
+        mCheckedDirs.insert(current.native());
+    }
+}
+
+} // namespace aos::sm::image
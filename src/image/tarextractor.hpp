@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TAREXTRACTOR_HPP_
+#define TAREXTRACTOR_HPP_
+
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <aos/common/crypto/crypto.hpp>
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::image {
+
+/**
+ * Tar archive entry.
+ */
+struct TarEntry {
+    /**
+     * Entry types.
+     */
+    enum class Type {
+        eFile,
+        eHardLink,
+        eSymLink,
+        eCharDevice,
+        eBlockDevice,
+        eDir,
+        eFIFO,
+    };
+
+    Type                                             mType = Type::eFile;
+    std::string                                      mPath;
+    std::string                                      mLinkPath;
+    uint64_t                                         mSize     = 0;
+    uint32_t                                         mMode     = 0;
+    uint32_t                                         mUID      = 0;
+    uint32_t                                         mGID      = 0;
+    int64_t                                          mModTime  = 0;
+    uint32_t                                         mDevMajor = 0;
+    uint32_t                                         mDevMinor = 0;
+    std::vector<std::pair<std::string, std::string>> mXAttrs;
+};
+
+/**
+ * Streaming tar archive reader. Supports ustar, GNU long names and PAX headers with SCHILY xattr records. Entries of
+ * other types, e.g. GNU sparse files, are not supported.
+ */
+class TarReader {
+public:
+    /**
+     * Constructor.
+     *
+     * @param stream tar stream.
+     */
+    explicit TarReader(std::istream& stream);
+
+    /**
+     * Reads next entry header. Unread data of the previous entry is skipped.
+     *
+     * @param[out] entry tar entry.
+     * @return RetWithError<bool>: false if there are no more entries, eNotSupported error for unsupported entries.
+     */
+    RetWithError<bool> Next(TarEntry& entry);
+
+    /**
+     * Reads current entry data.
+     *
+     * @param buffer buffer.
+     * @param size buffer size.
+     * @return RetWithError<size_t>: number of bytes read, 0 at the end of entry data.
+     */
+    RetWithError<size_t> Read(char* buffer, size_t size);
+
+private:
+    static constexpr auto cBlockSize = 512;
+
+    using PAXRecords = std::vector<std::pair<std::string, std::string>>;
+
+    Error ReadBlock(char* block);
+    Error Skip(uint64_t size);
+    Error ReadExtension(uint64_t size, std::string& data);
+    Error ParsePAX(const std::string& data, PAXRecords& records);
+    Error ApplyPAX(const PAXRecords& records, TarEntry& entry);
+
+    std::istream& mStream;
+    uint64_t      mRemaining = 0;
+    uint64_t      mPadding   = 0;
+    PAXRecords    mGlobalPAX;
+};
+
+/**
+ * Input stream buffer which reads data of the current tar entry.
+ */
+class TarEntryStreamBuf : public std::streambuf {
+public:
+    /**
+     * Constructor.
+     *
+     * @param reader tar reader positioned at the entry.
+     */
+    explicit TarEntryStreamBuf(TarReader& reader);
+
+    /**
+     * Returns read error.
+     *
+     * @return Error.
+     */
+    Error GetError() const { return mError; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    static constexpr auto cBufferSize = 64 * 1024;
+
+    TarReader&        mReader;
+    std::vector<char> mBuffer;
+    Error             mError = ErrorEnum::eNone;
+};
+
+/**
+ * Extracts tar archives to the file system.
+ */
+class TarExtractor {
+public:
+    /**
+     * Entry handler. Returns true if the entry is handled and should not be extracted. Parent directories of the
+     * entry are created and checked not to be symlinks before the handler is called.
+     */
+    using EntryHandler = std::function<RetWithError<bool>(const TarEntry& entry, TarReader& reader)>;
+
+    /**
+     * Size handler. Called with total extracted size before each regular file is written.
+     */
+    using SizeHandler = std::function<Error(uint64_t size)>;
+
+    /**
+     * File handler. Called after each regular file is written with its SHA256 content hash, before file attributes
+     * are applied.
+     */
+    using FileHandler
+        = std::function<Error(const std::filesystem::path& path, const TarEntry& entry, const std::string& sha256)>;
+
+    /**
+     * Constructor.
+     *
+     * @param destination destination directory.
+     */
+    explicit TarExtractor(const std::filesystem::path& destination);
+
+    /**
+     * Sets entry handler.
+     *
+     * @param handler entry handler.
+     */
+    void SetEntryHandler(EntryHandler handler) { mEntryHandler = std::move(handler); }
+
+    /**
+     * Sets size handler.
+     *
+     * @param handler size handler.
+     */
+    void SetSizeHandler(SizeHandler handler) { mSizeHandler = std::move(handler); }
+
+    /**
+     * Sets file handler.
+     *
+     * @param hasher hasher used to calculate file content hash.
+     * @param handler file handler.
+     */
+    void SetFileHandler(crypto::HasherItf& hasher, FileHandler handler)
+    {
+        mHasher      = &hasher;
+        mFileHandler = std::move(handler);
+    }
+
+    /**
+     * Sets owner of all extracted entries instead of the owner recorded in the archive.
+     *
+     * @param uid user ID.
+     * @param gid group ID.
+     */
+    void SetOwner(uint32_t uid, uint32_t gid) { mOwner = std::make_pair(uid, gid); }
+
+    /**
+     * Extracts tar or gzipped tar stream.
+     *
+     * @param stream archive stream.
+     * @return Error.
+     */
+    Error Extract(std::istream& stream);
+
+    /**
+     * Returns total size of extracted regular files.
+     *
+     * @return uint64_t.
+     */
+    uint64_t ExtractedSize() const { return mExtractedSize; }
+
+private:
+    static constexpr auto          cBufferSize  = 64 * 1024;
+    static constexpr unsigned char cGzipMagic[] = {0x1f, 0x8b};
+
+    Error ExtractTar(std::istream& stream);
+    void  ExtractEntry(const TarEntry& entry, TarReader& reader);
+    void  WriteFile(const std::filesystem::path& path, const TarEntry& entry, TarReader& reader);
+    void  SetAttributes(const std::filesystem::path& path, const TarEntry& entry);
+    void  SetDirAttributes(const std::filesystem::path& path, const TarEntry& entry);
+    void  CheckPath(const std::string& path) const;
+    void  MakeDirs(const std::filesystem::path& path, bool create);
+
+    std::filesystem::path                        mDestination;
+    EntryHandler                                 mEntryHandler;
+    SizeHandler                                  mSizeHandler;
+    crypto::HasherItf*                           mHasher = nullptr;
+    FileHandler                                  mFileHandler;
+    uint64_t                                     mExtractedSize = 0;
+    bool                                         mIsRoot        = false;
+    std::optional<std::pair<uint32_t, uint32_t>> mOwner;
+    std::unordered_set<std::string>              mSymLinks;
+    std::unordered_set<std::string>              mCheckedDirs;
+    std::vector<TarEntry>                        mDirs;
+    std::vector<char>                            mBuffer;
+};
+
+} // namespace aos::sm::image
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+
+#include <zstd.h>
+
+#include "zstdstream.hpp"
+
+namespace aos::sm::image {
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+ZstdStreamBuf::ZstdStreamBuf(std::istream& source)
+    : mSource(source)
+    , mInput(ZSTD_DStreamInSize())
+{
+    setg(nullptr, nullptr, nullptr);
+
+    // First input chunk is read in advance to get decompressed size from the frame header without extra pass
+    mSource.read(mInput.data(), mInput.size());
+    mInputSize = static_cast<size_t>(mSource.gcount());
+
+    if (auto size = ZSTD_getFrameContentSize(mInput.data(), mInputSize);
+        size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR) {
+        mContentSize = size;
+    }
+
+    mThread = std::thread(&ZstdStreamBuf::Decompress, this);
+}
+
+ZstdStreamBuf::~ZstdStreamBuf()
+{
+    {
+        std::lock_guard lock {mMutex};
+
+        mStopped = true;
+    }
+
+    mCondVar.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+Error ZstdStreamBuf::GetError() const
+{
+    std::lock_guard lock {mMutex};
+
+    return mError;
+}
+
+/***********************************************************************************************************************
+ * Protected
+ **********************************************************************************************************************/
+
+ZstdStreamBuf::int_type ZstdStreamBuf::underflow()
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::unique_lock lock {mMutex};
+
+    mCondVar.wait(lock, [this]() { return !mChunks.empty() || mFinished; });
+
+    if (mChunks.empty()) {
+        return traits_type::eof();
+    }
+
+    mCurrent = std::move(mChunks.front());
+    mChunks.pop_front();
+
+    lock.unlock();
+
+    mCondVar.notify_all();
+
+    setg(mCurrent.data(), mCurrent.data(), mCurrent.data() + mCurrent.size());
+
+    return traits_type::to_int_type(*gptr());
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+void ZstdStreamBuf::Decompress()
+{
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+
+    auto   err       = Error(ErrorEnum::eNone);
+    size_t lastRet   = 0;
+    bool   hasFrames = false;
+
+    if (!ctx) {
+        err = Error(ErrorEnum::eNoMemory, "can't create zstd context");
+    }
+
+    while (err.IsNone() && mInputSize != 0) {
+        ZSTD_inBuffer input {mInput.data(), mInputSize, 0};
+        bool          outputFull = false;
+
+        // Decompressor may keep data internally when output is full, so it is called until output is not full
+        while (input.pos < input.size || outputFull) {
+            std::vector<char> chunk(ZSTD_DStreamOutSize());
+            ZSTD_outBuffer    output {chunk.data(), chunk.size(), 0};
+
+            lastRet    = ZSTD_decompressStream(ctx.get(), &output, &input);
+            hasFrames  = true;
+            outputFull = output.pos == output.size;
+
+            if (ZSTD_isError(lastRet)) {
+                err = Error(ErrorEnum::eFailed, ZSTD_getErrorName(lastRet));
+                break;
+            }
+
+            if (output.pos != 0) {
+                chunk.resize(output.pos);
+
+                Push(std::move(chunk));
+            }
+
+            std::lock_guard lock {mMutex};
+
+            if (mStopped) {
+                return;
+            }
+        }
+
+        mSource.read(mInput.data(), mInput.size());
+        mInputSize = static_cast<size_t>(mSource.gcount());
+    }
+
+    // Non zero result at the end of input means the last frame is truncated
+    if (err.IsNone() && (!hasFrames || lastRet != 0)) {
+        err = Error(ErrorEnum::eFailed, "truncated zstd stream");
+    }
+
+    if (err.IsNone() && mSource.bad()) {
+        err = Error(ErrorEnum::eFailed, "can't read source stream");
+    }
+
+    {
+        std::lock_guard lock {mMutex};
+
+        mError    = err;
+        mFinished = true;
+    }
+
+    mCondVar.notify_all();
+}
+
+void ZstdStreamBuf::Push(std::vector<char>&& chunk)
+{
+    std::unique_lock lock {mMutex};
+
+    mCondVar.wait(lock, [this]() { return mChunks.size() < cQueueSize || mStopped; });
+
+    if (mStopped) {
+        return;
+    }
+
+    mChunks.push_back(std::move(chunk));
+
+    lock.unlock();
+
+    mCondVar.notify_all();
+}
+
+} // namespace aos::sm::image
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZSTDSTREAM_HPP_
+#define ZSTDSTREAM_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::image {
+
+/**
+ * Input stream buffer which decompresses zstd stream read from the source stream. Data is decompressed in a separate
+ * thread ahead of the reader, so decompression runs in parallel with processing of already decompressed data.
+ */
+class ZstdStreamBuf : public std::streambuf {
+public:
+    /**
+     * Zstd frame magic.
+     */
+    static constexpr unsigned char cMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+    /**
+     * Constructor.
+     *
+     * @param source compressed source stream.
+     */
+    explicit ZstdStreamBuf(std::istream& source);
+
+    /**
+     * Destructor.
+     */
+    ~ZstdStreamBuf();
+
+    /**
+     * Returns decompressed size declared in the first frame header.
+     *
+     * @return uint64_t: decompressed size or 0 if the frame header doesn't declare it.
+     */
+    uint64_t ContentSize() const { return mContentSize; }
+
+    /**
+     * Returns decompression error.
+     *
+     * @return Error.
+     */
+    Error GetError() const;
+
+protected:
+    int_type underflow() override;
+
+private:
+    static constexpr auto cQueueSize = 4;
+
+    void Decompress();
+    void Push(std::vector<char>&& chunk);
+
+    std::istream&                 mSource;
+    std::vector<char>             mInput;
+    size_t                        mInputSize   = 0;
+    uint64_t                      mContentSize = 0;
+    std::vector<char>             mCurrent;
+    std::deque<std::vector<char>> mChunks;
+    bool                          mFinished = false;
+    bool                          mStopped  = false;
+    Error                         mError    = ErrorEnum::eNone;
+    mutable std::mutex            mMutex;
+    std::condition_variable       mCondVar;
+    std::thread                   mThread;
+};
+
+} // namespace aos::sm::image
+
+#endif
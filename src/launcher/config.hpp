@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LAUNCHER_RUNTIME_CONFIG_HPP_
+#define LAUNCHER_RUNTIME_CONFIG_HPP_
+
+#include <string>
+
+namespace aos::sm::launcher {
+
+/***
+ * Service root filesystem upper layer type.
+ */
+enum class RootFSUpperType {
+    eNone,     // read-only root filesystem
+    eTmpfs,    // writable root filesystem, changes are kept in memory
+    eVolatile, // writable root filesystem, changes are kept in working dir without sync
+};
+
+/***
+ * Runtime configuration.
+ */
+struct RuntimeConfig {
+    std::string     mWorkingDir;
+    RootFSUpperType mRootFSUpper = RootFSUpperType::eNone;
+    std::string     mPrefetchDir; // layer hot lists dir, empty disables layer prefetch
+};
+
+} // namespace aos::sm::launcher
+
+#endif
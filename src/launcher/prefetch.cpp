@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <Poco/SHA2Engine.h>
+
+#include <aos/common/tools/memory.hpp>
+#include <utils/exception.hpp>
+
+#include "logger/logmodule.hpp"
+
+#include "prefetch.hpp"
+
+namespace aos::sm::launcher {
+namespace fs = std::filesystem;
+
+namespace {
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+// Writes resident page ranges of the file as "<offset> <length> <path>" lines
+size_t SampleFile(const fs::path& path, const fs::path& relPath, size_t maxRanges, std::ostream& out)
+{
+    auto fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st;
+    void*       addr = MAP_FAILED;
+
+    // Mapping doesn't fault pages in, mincore only reports pages already in the page cache
+    if (fstat(fd, &st) == 0 && st.st_size != 0) {
+        addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        return 0;
+    }
+
+    const auto                 pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((st.st_size + pageSize - 1) / pageSize);
+    size_t                     ranges = 0;
+
+    if (mincore(addr, st.st_size, pages.data()) == 0) {
+        for (size_t i = 0; i < pages.size() && ranges < maxRanges;) {
+            if (!(pages[i] & 1)) {
+                i++;
+                continue;
+            }
+
+            auto start = i;
+
+            while (i < pages.size() && (pages[i] & 1)) {
+                i++;
+            }
+
+            out << start * pageSize << " " << (i - start) * pageSize << " " << relPath.string() << "\n";
+            ranges++;
+        }
+    }
+
+    munmap(addr, st.st_size);
+
+    return ranges;
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+LayerPrefetcher::~LayerPrefetcher()
+{
+    Stop();
+}
+
+Error LayerPrefetcher::Init(const fs::path& hotListsDir)
+{
+    LOG_DBG() << "Init layer prefetcher: hotListsDir=" << hotListsDir.c_str();
+
+    Stop();
+
+    mHotListsDir = hotListsDir;
+
+    try {
+        fs::create_directories(mHotListsDir);
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    mStopped      = false;
+    mWorkerThread = std::thread(&LayerPrefetcher::ProcessLearn, this);
+
+    return ErrorEnum::eNone;
+}
+
+void LayerPrefetcher::ScheduleLearn(const std::vector<std::string>& layers)
+{
+    std::lock_guard lock {mLearnMutex};
+
+    for (const auto& layer : layers) {
+        // Layer already waiting to be learned is sampled once
+        if (std::find(mLearnQueue.begin(), mLearnQueue.end(), layer) == mLearnQueue.end()) {
+            mLearnQueue.push_back(layer);
+        }
+    }
+
+    mLearnCondVar.notify_one();
+}
+
+Error LayerPrefetcher::Learn(const fs::path& layer)
+{
+    const auto hotListPath = GetHotListPath(layer);
+
+    try {
+        if (!fs::is_directory(layer)) {
+            fs::remove(hotListPath);
+
+            return ErrorEnum::eNone;
+        }
+
+        std::ostringstream hotList;
+        size_t             ranges = 0;
+
+        // Layer path goes first, so hot lists of removed layers can be pruned
+        hotList << layer.lexically_normal().string() << "\n";
+
+        for (const auto& entry : fs::recursive_directory_iterator(layer)) {
+            if (ranges >= cMaxHotRanges) {
+                break;
+            }
+
+            if (!entry.is_regular_file() || entry.is_symlink()) {
+                continue;
+            }
+
+            ranges += SampleFile(entry.path(), entry.path().lexically_relative(layer), cMaxHotRanges - ranges, hotList);
+        }
+
+        // Layer released before anything was read keeps hot list of the previous run
+        if (ranges == 0) {
+            return ErrorEnum::eNone;
+        }
+
+        LOG_DBG() << "Layer hot list learned: layer=" << layer.c_str() << ", ranges=" << ranges;
+
+        std::lock_guard lock {mMutex};
+
+        const auto tmpPath = hotListPath.string() + cTmpSuffix;
+
+        if (std::ofstream file(tmpPath, std::ios::trunc); !(file << hotList.str())) {
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eFailed, "can't write hot list"));
+        }
+
+        fs::rename(tmpPath, hotListPath);
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error LayerPrefetcher::Prefetch(const fs::path& layer) const
+{
+    std::ifstream hotList(GetHotListPath(layer));
+    if (!hotList.is_open()) {
+        return ErrorEnum::eNone;
+    }
+
+    std::string currentPath, relPath;
+
+    // Skip layer path
+    std::getline(hotList, relPath);
+
+    int         fd     = -1;
+    size_t      ranges = 0;
+    off_t       offset = 0, length = 0;
+
+    [[maybe_unused]] auto closeFD = DeferRelease(&fd, [](const int* fd) {
+        if (*fd >= 0) {
+            close(*fd);
+        }
+    });
+
+    while (hotList >> offset >> length && std::getline(hotList >> std::ws, relPath)) {
+        if (relPath != currentPath) {
+            currentPath = relPath;
+
+            if (fd >= 0) {
+                close(fd);
+            }
+
+            // Hot list may be stale, e.g. layer is updated, so missing files are skipped
+            auto path = (layer / relPath).lexically_normal();
+
+            fd = (*path.lexically_relative(layer).begin() != "..")
+                ? open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC)
+                : -1;
+        }
+
+        if (fd < 0) {
+            continue;
+        }
+
+        // WILLNEED only schedules read ahead, pages are read in background while the instance is being prepared
+        if (auto err = posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED); err != 0) {
+            return AOS_ERROR_WRAP(Error(err, "can't prefetch layer file"));
+        }
+
+        ranges++;
+    }
+
+    LOG_DBG() << "Layer prefetched: layer=" << layer.c_str() << ", ranges=" << ranges;
+
+    return ErrorEnum::eNone;
+}
+
+Error LayerPrefetcher::Prune()
+{
+    std::lock_guard lock {mMutex};
+
+    try {
+        for (const auto& entry : fs::directory_iterator(mHotListsDir)) {
+            std::string layer;
+
+            if (entry.path().extension() != cTmpSuffix) {
+                std::ifstream file(entry.path());
+
+                std::getline(file, layer);
+            }
+
+            // Hot lists written partially before a crash are removed as well
+            if (!layer.empty() && fs::is_directory(layer)) {
+                continue;
+            }
+
+            LOG_DBG() << "Remove layer hot list: path=" << entry.path().c_str() << ", layer=" << layer.c_str();
+
+            fs::remove(entry.path());
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+fs::path LayerPrefetcher::GetHotListPath(const fs::path& layer) const
+{
+    // Hot lists survive SM updates, so their names should not depend on the toolchain
+    Poco::SHA2Engine engine(Poco::SHA2Engine::SHA_256);
+
+    engine.update(layer.lexically_normal().string());
+
+    return mHotListsDir / Poco::DigestEngine::digestToHex(engine.digest());
+}
+
+void LayerPrefetcher::ProcessLearn()
+{
+    // Layers are removed by layer manager, so hot lists of removed layers are pruned on start and periodically
+    auto prune = true;
+
+    while (true) {
+        if (prune) {
+            if (auto err = Prune(); !err.IsNone()) {
+                LOG_WRN() << "Can't prune layer hot lists: err=" << err;
+            }
+        }
+
+        std::string layer;
+
+        {
+            std::unique_lock lock {mLearnMutex};
+
+            prune = !mLearnCondVar.wait_for(
+                lock, cPrunePeriod, [this] { return mStopped || !mLearnQueue.empty(); });
+
+            if (mStopped) {
+                break;
+            }
+
+            if (prune) {
+                continue;
+            }
+
+            layer = mLearnQueue.front();
+            mLearnQueue.pop_front();
+        }
+
+        // Removed layer drops its hot list on learn
+        if (auto err = Learn(layer); !err.IsNone()) {
+            LOG_WRN() << "Can't learn layer hot list: layer=" << layer.c_str() << ", err=" << err;
+        }
+    }
+}
+
+void LayerPrefetcher::Stop()
+{
+    {
+        std::lock_guard lock {mLearnMutex};
+
+        mStopped = true;
+        mLearnQueue.clear();
+    }
+
+    mLearnCondVar.notify_all();
+
+    if (mWorkerThread.joinable()) {
+        mWorkerThread.join();
+    }
+}
+
+} // namespace aos::sm::launcher
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LAUNCHER_PREFETCH_HPP_
+#define LAUNCHER_PREFETCH_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <aos/common/tools/error.hpp>
+
+namespace aos::sm::launcher {
+
+/**
+ * Layer page cache prefetcher. Parts of layer files resident in the page cache when a layer is released are saved as
+ * the layer hot list. Next time the layer is mounted, its hot list is read ahead, so instance start doesn't fault in
+ * binaries and libraries from the storage one page at a time.
+ */
+class LayerPrefetcher {
+public:
+    /**
+     * Destructor.
+     */
+    ~LayerPrefetcher();
+
+    /**
+     * Initializes prefetcher and starts background learning.
+     *
+     * @param hotListsDir directory to keep layer hot lists, should survive reboots.
+     * @return Error.
+     */
+    Error Init(const std::filesystem::path& hotListsDir);
+
+    /**
+     * Schedules learning of layers hot lists in background.
+     *
+     * @param layers layer paths.
+     */
+    void ScheduleLearn(const std::vector<std::string>& layers);
+
+    /**
+     * Samples layer files resident in the page cache and saves them as the layer hot list.
+     *
+     * @param layer layer path.
+     * @return Error.
+     */
+    Error Learn(const std::filesystem::path& layer);
+
+    /**
+     * Starts asynchronous read ahead of the layer hot list.
+     *
+     * @param layer layer path.
+     * @return Error.
+     */
+    Error Prefetch(const std::filesystem::path& layer) const;
+
+    /**
+     * Removes hot lists of removed layers.
+     *
+     * @return Error.
+     */
+    Error Prune();
+
+private:
+    static constexpr auto cMaxHotRanges = 65536;
+    static constexpr auto cTmpSuffix    = ".tmp";
+    static constexpr auto cPrunePeriod  = std::chrono::hours(1);
+
+    std::filesystem::path GetHotListPath(const std::filesystem::path& layer) const;
+    void                  ProcessLearn();
+    void                  Stop();
+
+    std::filesystem::path   mHotListsDir;
+    std::mutex              mMutex;
+    std::thread             mWorkerThread;
+    std::deque<std::string> mLearnQueue;
+    std::mutex              mLearnMutex;
+    std::condition_variable mLearnCondVar;
+    bool                    mStopped = false;
+};
+
+} // namespace aos::sm::launcher
+
+#endif
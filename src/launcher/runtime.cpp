@@ -4,21 +4,39 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <grp.h>
 #include <iostream>
+#include <linux/loop.h>
+#include <memory>
+#include <optional>
+#include <sched.h>
+#include <set>
+#include <sstream>
 #include <string>
+#include <sys/ioctl.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/sysmacros.h>
+#include <sys/wait.h>
+#include <sys/xattr.h>
+#include <thread>
 #include <unistd.h>
 
 #include <utils/exception.hpp>
 #include <utils/retry.hpp>
 
 #include "logger/logmodule.hpp"
+#include "utils/parallel.hpp"
 
 #include "runtime.hpp"
 
@@ -40,10 +58,359 @@ constexpr auto cStatePermissions = fs::perms::owner_read | fs::perms::owner_writ
 constexpr auto cMountRetryCount = 3;
 constexpr auto cMountretryDelay = Time::cSeconds;
 
+constexpr auto cOverlayLowerDirAppend = "lowerdir+";
+constexpr auto cOverlayVolatile       = "volatile";
+constexpr auto cFSContextMsgLen       = 256;
+
+// Mount API constants from linux/mount.h: libc headers may not provide them.
+constexpr unsigned cFSOpenCloexec       = 0x00000001;
+constexpr unsigned cFSConfigSetFlag     = 0;
+constexpr unsigned cFSConfigSetString   = 1;
+constexpr unsigned cFSConfigCmdCreate   = 6;
+constexpr unsigned cFSMountCloexec      = 0x00000001;
+constexpr unsigned cMoveMountFEmptyPath = 0x00000004;
+constexpr unsigned cOpenTreeClone       = 1;
+constexpr uint64_t cMountAttrReadOnly   = 0x00000001;
+constexpr uint64_t cMountAttrIDMap      = 0x00100000;
+
+constexpr auto cOwnerXAttr = "user.aos.owner";
+constexpr auto cOwnerLen   = 32;
+
+constexpr auto cLayerImageXAttr   = "user.aos.image";
+constexpr auto cLayerImageNameLen = 256;
+constexpr auto cLoopControl       = "/dev/loop-control";
+constexpr auto cLoopDevicePrefix  = "/dev/loop";
+constexpr auto cLoopAttachRetries = 8;
+constexpr auto cSquashFSMagic     = "hsqs";
+constexpr auto cEROFSMagic        = "\xe2\xe1\xf5\xe0";
+constexpr auto cEROFSMagicOffset  = 1024;
+
+// Mount API syscall numbers are common for all architectures.
+#ifndef SYS_move_mount
+#define SYS_move_mount 429
+#endif
+
+#ifndef SYS_fsopen
+#define SYS_fsopen 430
+#endif
+
+#ifndef SYS_fsconfig
+#define SYS_fsconfig 431
+#endif
+
+#ifndef SYS_fsmount
+#define SYS_fsmount 432
+#endif
+
+#ifndef SYS_open_tree
+#define SYS_open_tree 428
+#endif
+
+#ifndef SYS_mount_setattr
+#define SYS_mount_setattr 442
+#endif
+
 /***********************************************************************************************************************
  * Static
  **********************************************************************************************************************/
 
+class UniqueFD {
+public:
+    explicit UniqueFD(int fd = -1)
+        : mFD(fd)
+    {
+    }
+
+    UniqueFD(const UniqueFD&)            = delete;
+    UniqueFD& operator=(const UniqueFD&) = delete;
+
+    ~UniqueFD()
+    {
+        if (mFD >= 0) {
+            close(mFD);
+        }
+    }
+
+    int Get() const { return mFD; }
+
+private:
+    int mFD;
+};
+
+int FSOpen(const char* fsName)
+{
+    return static_cast<int>(syscall(SYS_fsopen, fsName, cFSOpenCloexec));
+}
+
+int FSConfigFlag(int fsFD, const char* key)
+{
+    return static_cast<int>(syscall(SYS_fsconfig, fsFD, cFSConfigSetFlag, key, nullptr, 0));
+}
+
+int FSConfigString(int fsFD, const char* key, const char* value)
+{
+    return static_cast<int>(syscall(SYS_fsconfig, fsFD, cFSConfigSetString, key, value, 0));
+}
+
+int FSConfigCreate(int fsFD)
+{
+    return static_cast<int>(syscall(SYS_fsconfig, fsFD, cFSConfigCmdCreate, nullptr, nullptr, 0));
+}
+
+int FSMount(int fsFD)
+{
+    return static_cast<int>(syscall(SYS_fsmount, fsFD, cFSMountCloexec, 0));
+}
+
+int MoveMount(int mountFD, const fs::path& mountPoint)
+{
+    return static_cast<int>(syscall(SYS_move_mount, mountFD, "", AT_FDCWD, mountPoint.c_str(), cMoveMountFEmptyPath));
+}
+
+int OpenTree(const fs::path& path)
+{
+    return static_cast<int>(syscall(SYS_open_tree, AT_FDCWD, path.c_str(), cOpenTreeClone | O_CLOEXEC));
+}
+
+int MountSetIDMap(int mountFD, int userNSFD)
+{
+    // struct mount_attr from linux/mount.h
+    struct {
+        uint64_t mAttrSet;
+        uint64_t mAttrClr;
+        uint64_t mPropagation;
+        uint64_t mUserNSFD;
+    } attr {cMountAttrIDMap | cMountAttrReadOnly, 0, 0, static_cast<uint64_t>(userNSFD)};
+
+    return static_cast<int>(syscall(SYS_mount_setattr, mountFD, "", AT_EMPTY_PATH, &attr, sizeof(attr)));
+}
+
+bool WriteIDMap(pid_t pid, const char* mapName, uint32_t id)
+{
+    std::ofstream file(fs::path("/proc") / std::to_string(pid) / mapName);
+
+    file << "0 " << id << " 1\n";
+    file.close();
+
+    return !file.fail();
+}
+
+// Creates user namespace which maps root to the specified owner IDs. Layers are stored root owned, any other IDs would
+// be mapped to the overflow IDs.
+int CreateUserNS(uint32_t uid, uint32_t gid)
+{
+    int syncPipe[2];
+
+    if (pipe2(syncPipe, O_CLOEXEC) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't create pipe");
+    }
+
+    auto pid = fork();
+    if (pid < 0) {
+        auto err = errno;
+
+        close(syncPipe[0]);
+        close(syncPipe[1]);
+
+        AOS_ERROR_THROW(Error(err), "can't create user namespace process");
+    }
+
+    if (pid == 0) {
+        char ready = unshare(CLONE_NEWUSER) == 0 ? 1 : 0;
+
+        std::ignore = write(syncPipe[1], &ready, sizeof(ready));
+
+        pause();
+        _exit(0);
+    }
+
+    close(syncPipe[1]);
+
+    char ready = 0;
+    auto size  = read(syncPipe[0], &ready, sizeof(ready));
+
+    close(syncPipe[0]);
+
+    auto nsFD = -1;
+
+    if (size == sizeof(ready) && ready && WriteIDMap(pid, "uid_map", uid) && WriteIDMap(pid, "gid_map", gid)) {
+        nsFD = open((fs::path("/proc") / std::to_string(pid) / "ns" / "user").c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    auto err = errno;
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+
+    if (nsFD < 0) {
+        AOS_ERROR_THROW(Error(err), "can't create user namespace");
+    }
+
+    return nsFD;
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> GetLayerOwner(const fs::path& path)
+{
+    char owner[cOwnerLen] {};
+
+    if (getxattr(path.c_str(), cOwnerXAttr, owner, sizeof(owner) - 1) <= 0) {
+        return std::nullopt;
+    }
+
+    uint32_t uid = 0, gid = 0;
+
+    if (sscanf(owner, "%u:%u", &uid, &gid) != 2) {
+        AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "invalid layer owner");
+    }
+
+    return std::make_pair(uid, gid);
+}
+
+void MountIDMapped(const fs::path& source, const fs::path& mountPoint, uint32_t uid, uint32_t gid)
+{
+    LOG_DBG() << "Mount idmapped: source=" << source.c_str() << ", mountPoint=" << mountPoint.c_str()
+              << ", uid=" << uid << ", gid=" << gid;
+
+    UniqueFD userNSFD(CreateUserNS(uid, gid));
+
+    UniqueFD treeFD(OpenTree(source));
+    if (treeFD.Get() < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't clone layer tree");
+    }
+
+    if (MountSetIDMap(treeFD.Get(), userNSFD.Get()) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't set idmapped mount");
+    }
+
+    if (MoveMount(treeFD.Get(), mountPoint) != 0) {
+        AOS_ERROR_THROW(Error(errno), "can't attach idmapped mount");
+    }
+}
+
+fs::path GetLayerImage(const fs::path& layer)
+{
+    char name[cLayerImageNameLen] {};
+
+    // Only layers stored by image handler as file system images are marked
+    if (getxattr(layer.c_str(), cLayerImageXAttr, name, sizeof(name) - 1) <= 0) {
+        return {};
+    }
+
+    auto image = layer / name;
+
+    if (image.filename() != name || !fs::is_regular_file(fs::symlink_status(image))) {
+        AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "invalid layer image");
+    }
+
+    return image;
+}
+
+std::string GetImageFSType(const fs::path& image)
+{
+    char header[cEROFSMagicOffset + 4] {};
+
+    std::ifstream file(image, std::ios::binary);
+
+    file.read(header, sizeof(header));
+
+    if (std::string(header, strlen(cSquashFSMagic)) == cSquashFSMagic) {
+        return "squashfs";
+    }
+
+    if (file.gcount() == sizeof(header)
+        && std::string(header + cEROFSMagicOffset, strlen(cEROFSMagic)) == cEROFSMagic) {
+        return "erofs";
+    }
+
+    AOS_ERROR_THROW(ErrorEnum::eNotSupported, "unsupported layer image format");
+}
+
+void MountLayerImage(const fs::path& image, const fs::path& mountPoint)
+{
+    auto fsType = GetImageFSType(image);
+
+    LOG_DBG() << "Mount layer image: image=" << image.c_str() << ", mountPoint=" << mountPoint.c_str()
+              << ", type=" << fsType.c_str();
+
+    UniqueFD controlFD(open(cLoopControl, O_RDWR | O_CLOEXEC));
+    if (controlFD.Get() < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't open loop control");
+    }
+
+    UniqueFD imageFD(open(image.c_str(), O_RDONLY | O_CLOEXEC));
+    if (imageFD.Get() < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't open layer image");
+    }
+
+    for (int i = 0; i < cLoopAttachRetries; i++) {
+        auto index = ioctl(controlFD.Get(), LOOP_CTL_GET_FREE);
+        if (index < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't get free loop device");
+        }
+
+        auto device = cLoopDevicePrefix + std::to_string(index);
+
+        UniqueFD loopFD(open(device.c_str(), O_RDONLY | O_CLOEXEC));
+        if (loopFD.Get() < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't open loop device");
+        }
+
+        // Loop device is detached automatically when the layer image is unmounted
+        struct loop_config config {};
+
+        config.fd            = imageFD.Get();
+        config.info.lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR;
+
+        auto ret = ioctl(loopFD.Get(), LOOP_CONFIGURE, &config);
+
+        // Kernels older than 5.8 don't support LOOP_CONFIGURE
+        if (ret != 0 && (errno == EINVAL || errno == ENOTTY)) {
+            ret = ioctl(loopFD.Get(), LOOP_SET_FD, imageFD.Get());
+            if (ret == 0 && ioctl(loopFD.Get(), LOOP_SET_STATUS64, &config.info) != 0) {
+                auto err = errno;
+
+                ioctl(loopFD.Get(), LOOP_CLR_FD, 0);
+
+                AOS_ERROR_THROW(Error(err), "can't set loop device status");
+            }
+        }
+
+        if (ret != 0) {
+            // Device was taken by someone else between getting and configuring it
+            if (errno == EBUSY) {
+                continue;
+            }
+
+            AOS_ERROR_THROW(Error(errno), "can't configure loop device");
+        }
+
+        // Loop device fd should be kept open until mounted, otherwise it is cleared
+        if (mount(device.c_str(), mountPoint.c_str(), fsType.c_str(), MS_RDONLY, nullptr) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't mount layer image");
+        }
+
+        return;
+    }
+
+    AOS_ERROR_THROW(ErrorEnum::eFailed, "can't attach loop device");
+}
+
+void LogFSContextMessages(int fsFD)
+{
+    char msg[cFSContextMsgLen];
+
+    for (;;) {
+        auto size = read(fsFD, msg, sizeof(msg) - 1);
+        if (size <= 0) {
+            break;
+        }
+
+        msg[size] = '\0';
+
+        LOG_ERR() << "Overlay context message: msg=" << msg;
+    }
+}
+
 unsigned GetMountPermissions(const Mount& mount)
 {
     for (const auto& option : mount.mOptions) {
@@ -105,19 +472,89 @@ void MountDir(const fs::path& source, const fs::path& mountPoint, const std::str
     AOS_ERROR_CHECK_AND_THROW(err, "can't mount dir");
 }
 
-void MountOverlay(const fs::path& mountPoint, const std::vector<fs::path>& lowerDirs, const fs::path& workDir,
-    const fs::path& upperDir)
+// Mounts overlay using fd-based mount API. Returns false if the API or lowerdir+ option is not supported by the kernel.
+bool MountOverlayFD(const fs::path& mountPoint, const std::vector<fs::path>& lowerDirs, const fs::path& workDir,
+    const fs::path& upperDir, bool volatileUpper)
 {
-    auto opts = std::string("lowerdir=");
+    UniqueFD fsFD(FSOpen("overlay"));
+    if (fsFD.Get() < 0) {
+        if (errno == ENOSYS) {
+            return false;
+        }
 
-    for (auto it = lowerDirs.begin(); it != lowerDirs.end(); ++it) {
-        opts += *it;
+        AOS_ERROR_THROW(Error(errno), "can't create overlay context");
+    }
 
-        if (it + 1 != lowerDirs.end()) {
-            opts += ":";
+    for (const auto& lowerDir : lowerDirs) {
+        if (FSConfigString(fsFD.Get(), cOverlayLowerDirAppend, lowerDir.c_str()) == 0) {
+            continue;
+        }
+
+        // lowerdir+ is supported since Linux 6.8
+        if (errno == EINVAL && &lowerDir == &lowerDirs.front()) {
+            return false;
+        }
+
+        auto err = errno;
+
+        LOG_ERR() << "Can't set overlay lower dir: path=" << lowerDir.c_str();
+        LogFSContextMessages(fsFD.Get());
+
+        AOS_ERROR_THROW(Error(err), "can't set overlay lower dir");
+    }
+
+    if (!upperDir.empty()) {
+        if (FSConfigString(fsFD.Get(), "upperdir", upperDir.c_str()) != 0
+            || FSConfigString(fsFD.Get(), "workdir", workDir.c_str()) != 0) {
+            auto err = errno;
+
+            LogFSContextMessages(fsFD.Get());
+
+            AOS_ERROR_THROW(Error(err), "can't set overlay upper dir");
         }
+
+        if (volatileUpper && FSConfigFlag(fsFD.Get(), cOverlayVolatile) != 0) {
+            auto err = errno;
+
+            LogFSContextMessages(fsFD.Get());
+
+            AOS_ERROR_THROW(Error(err), "can't set overlay volatile option");
+        }
+    }
+
+    if (FSConfigCreate(fsFD.Get()) != 0) {
+        auto err = errno;
+
+        LogFSContextMessages(fsFD.Get());
+
+        AOS_ERROR_THROW(Error(err), "can't create overlay");
+    }
+
+    UniqueFD mountFD(FSMount(fsFD.Get()));
+    if (mountFD.Get() < 0) {
+        AOS_ERROR_THROW(Error(errno), "can't create overlay mount");
     }
 
+    LOG_DBG() << "Move mount: mountPoint=" << mountPoint.c_str() << ", layers=" << lowerDirs.size();
+
+    // Overlay superblock is created once, only attaching is retried.
+    auto err = common::utils::Retry(
+        [&]() { return MoveMount(mountFD.Get(), mountPoint); },
+        [&]([[maybe_unused]] int retryCount, [[maybe_unused]] Duration delay, const aos::Error& err) {
+            LOG_WRN() << "Move mount error: err=" << err << ", try remount...";
+
+            sync();
+            umount2(mountPoint.c_str(), MNT_FORCE);
+        },
+        cMountRetryCount, cMountretryDelay, Duration(0));
+    AOS_ERROR_CHECK_AND_THROW(err, "can't move overlay mount");
+
+    return true;
+}
+
+void MountOverlay(const fs::path& mountPoint, const std::vector<fs::path>& lowerDirs, const fs::path& workDir,
+    const fs::path& upperDir, bool volatileUpper = false)
+{
     if (!upperDir.empty()) {
         if (workDir.empty()) {
             AOS_ERROR_THROW(ErrorEnum::eRuntime, "working dir path should be set");
@@ -126,9 +563,31 @@ void MountOverlay(const fs::path& mountPoint, const std::vector<fs::path>& lower
         fs::remove_all(workDir);
         fs::create_directories(workDir);
         fs::permissions(workDir, cDirPermissions);
+    }
+
+    if (MountOverlayFD(mountPoint, lowerDirs, workDir, upperDir, volatileUpper)) {
+        return;
+    }
+
+    LOG_DBG() << "Fd-based overlay mount is not supported, use mount";
 
+    auto opts = std::string("lowerdir=");
+
+    for (auto it = lowerDirs.begin(); it != lowerDirs.end(); ++it) {
+        opts += *it;
+
+        if (it + 1 != lowerDirs.end()) {
+            opts += ":";
+        }
+    }
+
+    if (!upperDir.empty()) {
         opts += ",workdir=" + workDir.string();
         opts += ",upperdir=" + upperDir.string();
+
+        if (volatileUpper) {
+            opts += std::string(",") + cOverlayVolatile;
+        }
     }
 
     MountDir("overlay", mountPoint, "overlay", 0, opts);
@@ -152,6 +611,82 @@ void UmountDir(const fs::path& mountPoint)
     AOS_ERROR_CHECK_AND_THROW(err, "can't umount dir");
 }
 
+size_t GetDirID(const fs::path& path)
+{
+    return strtoul(path.filename().c_str(), nullptr, 10);
+}
+
+// Detaches mounts under dir and removes their mount points. Returns ID next to the highest ID of the remaining dirs.
+size_t DetachMountPoints(const fs::path& dir, bool perStack)
+{
+    size_t nextID = 0;
+
+    if (!fs::exists(dir)) {
+        return nextID;
+    }
+
+    std::vector<fs::path> entries;
+
+    std::transform(fs::directory_iterator(dir), fs::directory_iterator(), std::back_inserter(entries),
+        [](const auto& entry) { return entry.path(); });
+
+    for (const auto& path : entries) {
+        if (perStack) {
+            DetachMountPoints(path, false);
+        } else {
+            umount2(path.c_str(), MNT_DETACH);
+        }
+
+        if (rmdir(path.c_str()) != 0) {
+            LOG_WRN() << "Can't remove mount point: path=" << path.c_str() << ", err=" << Error(errno);
+
+            nextID = std::max(nextID, GetDirID(path) + 1);
+        }
+    }
+
+    return nextID;
+}
+
+// Returns upper dirs under upperDirsDir used by mounted overlays, keyed by mount point.
+std::map<std::string, std::string> GetMountedUpperDirs(const fs::path& upperDirsDir)
+{
+    constexpr auto cMountPointIndex = 4;
+    constexpr auto cUpperDirOption  = "upperdir=";
+
+    std::map<std::string, std::string> upperDirs;
+    std::ifstream                      file("/proc/self/mountinfo");
+    std::string                        line;
+    const auto                         prefix = upperDirsDir.string() + "/";
+
+    while (std::getline(file, line)) {
+        auto separator = line.find(" - ");
+        if (separator == std::string::npos) {
+            continue;
+        }
+
+        auto optionPos = line.find(cUpperDirOption, separator);
+        if (optionPos == std::string::npos) {
+            continue;
+        }
+
+        optionPos += strlen(cUpperDirOption);
+
+        auto upperDir = line.substr(optionPos, line.find_first_of(", ", optionPos) - optionPos);
+        if (upperDir.rfind(prefix, 0) != 0) {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(0, separator));
+        std::string        mountPoint;
+
+        for (auto i = 0; i <= cMountPointIndex && fields >> mountPoint; i++) { }
+
+        upperDirs[mountPoint] = fs::path(upperDir).parent_path().string();
+    }
+
+    return upperDirs;
+}
+
 oci::LinuxDevice DeviceFromPath(const fs::path& path)
 {
     auto devPath = path;
@@ -199,37 +734,101 @@ oci::LinuxDevice DeviceFromPath(const fs::path& path)
  * Public
  **********************************************************************************************************************/
 
-Error Runtime::CreateHostFSWhiteouts(const String& path, const Array<StaticString<cFilePathLen>>& hostBinds)
-{
-    try {
-        auto destPath = fs::path(path.CStr());
+Error Runtime::Init(const RuntimeConfig& config, const resourcemanager::DeviceRegistry* deviceRegistry)
+{
+    LOG_DBG() << "Init runtime: workingDir=" << config.mWorkingDir.c_str();
+
+    mConfig         = config;
+    mDeviceRegistry = deviceRegistry;
+
+    try {
+        CleanupLayerStacks();
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e, ErrorEnum::eRuntime));
+    }
+
+    if (!mConfig.mPrefetchDir.empty()) {
+        if (auto err = mPrefetcher.Init(mConfig.mPrefetchDir); !err.IsNone()) {
+            return AOS_ERROR_WRAP(err);
+        }
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error Runtime::CreateHostFSWhiteouts(const String& path, const Array<StaticString<cFilePathLen>>& hostBinds)
+{
+    try {
+        auto destPath = fs::path(path.CStr());
+
+        std::set<std::string> binds;
+
+        for (const auto& bind : hostBinds) {
+            binds.insert((fs::path("/") / bind.CStr()).string());
+        }
+
+        std::string key;
+
+        for (const auto& bind : binds) {
+            key += bind + ":";
+        }
+
+        struct stat rootStat;
+
+        if (stat("/", &rootStat) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't get root dir stat");
+        }
+
+        if (mConfig.mWorkingDir.empty()) {
+            HostFSWhiteouts whiteouts;
+
+            whiteouts.mTemplateDir = destPath.string();
+
+            UpdateWhiteoutsTemplate(whiteouts, binds);
+
+            return ErrorEnum::eNone;
+        }
+
+        HostFSWhiteouts* whiteouts = nullptr;
 
-        fs::create_directories(destPath);
-        fs::permissions(destPath, cDirPermissions);
+        // Runtime lock covers cache lookups only, templates are updated and cloned under their own locks
+        {
+            std::lock_guard lock {mMutex};
 
-        for (const auto& entry : fs::directory_iterator("/")) {
-            if (hostBinds.FindIf([&entry](const StaticString<cFilePathLen>& bind) {
-                    return entry.path() == fs::path("/") / bind.CStr();
-                })
-                != hostBinds.end()) {
-                continue;
+            whiteouts = &mHostFSWhiteouts[key];
+
+            if (whiteouts->mTemplateDir.empty()) {
+                whiteouts->mTemplateDir
+                    = (fs::path(mConfig.mWorkingDir) / cWhiteoutsDir / std::to_string(mHostFSWhiteouts.size())).string();
             }
+        }
 
-            auto itemPath(fs::path(destPath) += entry.path());
+        auto isOutdated = [&]() {
+            return whiteouts->mGeneration == 0 || whiteouts->mRootModTime.tv_sec != rootStat.st_mtim.tv_sec
+                || whiteouts->mRootModTime.tv_nsec != rootStat.st_mtim.tv_nsec;
+        };
 
-            if (fs::exists(itemPath)) {
-                continue;
-            }
+        std::shared_lock templateLock {whiteouts->mMutex};
+
+        if (isOutdated()) {
+            templateLock.unlock();
 
-            LOG_DBG() << "Create rootfs white out: path=" << itemPath.c_str();
+            {
+                std::unique_lock updateLock {whiteouts->mMutex};
 
-            if (auto ret = mknod(itemPath.c_str(), S_IFCHR, makedev(0, 0)); ret != 0) {
-                return Error(ErrorEnum::eRuntime, "can't create white out");
+                if (isOutdated()) {
+                    UpdateWhiteoutsTemplate(*whiteouts, binds);
+
+                    whiteouts->mRootModTime = rootStat.st_mtim;
+                }
             }
+
+            templateLock.lock();
         }
-    }
 
-    catch (const std::exception& e) {
+        // Clone is idempotent: existing links are kept and missing ones are restored
+        CloneWhiteoutsTemplate(*whiteouts, destPath);
+    } catch (const std::exception& e) {
         return AOS_ERROR_WRAP(common::utils::ToAosError(e, ErrorEnum::eRuntime));
     }
 
@@ -261,12 +860,53 @@ Error Runtime::MountServiceRootFS(const String& rootfsPath, const Array<StaticSt
         fs::create_directories(mountPoint);
         fs::permissions(mountPoint, cDirPermissions);
 
-        std::vector<fs::path> lowerDirs;
+        PrefetchLayers(layers);
+
+        if (mConfig.mWorkingDir.empty()) {
+            std::vector<fs::path> lowerDirs;
 
-        std::transform(layers.begin(), layers.end(), std::back_inserter(lowerDirs),
+            std::transform(layers.begin(), layers.end(), std::back_inserter(lowerDirs),
+                [](const auto& layer) { return layer.CStr(); });
+
+            if (std::any_of(lowerDirs.begin(), lowerDirs.end(),
+                    [](const auto& layer) { return GetLayerOwner(layer).has_value(); })) {
+                AOS_ERROR_THROW(ErrorEnum::eNotSupported, "idmapped layers require runtime working dir");
+            }
+
+            if (std::any_of(lowerDirs.begin(), lowerDirs.end(),
+                    [](const auto& layer) { return !GetLayerImage(layer).empty(); })) {
+                AOS_ERROR_THROW(ErrorEnum::eNotSupported, "layer images require runtime working dir");
+            }
+
+            MountOverlay(mountPoint, lowerDirs, "", "");
+
+            return ErrorEnum::eNone;
+        }
+
+        std::vector<std::string> layerPaths;
+
+        std::transform(layers.begin(), layers.end(), std::back_inserter(layerPaths),
             [](const auto& layer) { return layer.CStr(); });
 
-        MountOverlay(mountPoint, lowerDirs, "", "");
+        std::string stackMountPoint;
+
+        auto key = AcquireLayerStack(layerPaths, stackMountPoint);
+
+        try {
+            if (mConfig.mRootFSUpper == RootFSUpperType::eNone) {
+                MountDir(stackMountPoint, mountPoint, "", MS_BIND, "");
+            } else {
+                MountRootFSUpper(stackMountPoint, mountPoint);
+            }
+        } catch (...) {
+            ReleaseLayerStack(key);
+
+            throw;
+        }
+
+        std::lock_guard lock {mMutex};
+
+        mRootFSLayerStacks[fs::absolute(mountPoint).lexically_normal().string()] = key;
     } catch (const std::exception& e) {
         return AOS_ERROR_WRAP(common::utils::ToAosError(e, ErrorEnum::eRuntime));
     }
@@ -281,6 +921,40 @@ Error Runtime::UmountServiceRootFS(const String& rootfsPath)
 
         UmountDir(mountPoint);
         fs::remove_all(mountPoint);
+
+        std::optional<std::string> key;
+        std::optional<fs::path>    upperDir;
+
+        {
+            std::lock_guard lock {mMutex};
+
+            if (auto it = mRootFSLayerStacks.find(fs::absolute(mountPoint).lexically_normal().string());
+                it != mRootFSLayerStacks.end()) {
+                key = it->second;
+
+                mRootFSLayerStacks.erase(it);
+            }
+
+            if (auto it = mRootFSUpperDirs.find(fs::absolute(mountPoint).lexically_normal().string());
+                it != mRootFSUpperDirs.end()) {
+                upperDir = it->second;
+
+                mRootFSUpperDirs.erase(it);
+            }
+        }
+
+        if (key.has_value()) {
+            // Pages left in the page cache by the last instance of the stack form the layers hot lists
+            LearnLayers(ReleaseLayerStack(*key));
+        }
+
+        if (upperDir.has_value()) {
+            if (mConfig.mRootFSUpper == RootFSUpperType::eTmpfs) {
+                UmountDir(*upperDir);
+            }
+
+            fs::remove_all(*upperDir);
+        }
     } catch (const std::exception& e) {
         return AOS_ERROR_WRAP(common::utils::ToAosError(e, ErrorEnum::eRuntime));
     }
@@ -349,6 +1023,24 @@ Error Runtime::PrepareNetworkDir(const String& path)
     return ErrorEnum::eNone;
 }
 
+Error Runtime::PrepareInstances(const std::vector<InstanceEnvironment>& instances, std::vector<Error>& errors)
+{
+    LOG_DBG() << "Prepare instances: count=" << instances.size();
+
+    errors.assign(instances.size(), ErrorEnum::eNone);
+
+    utils::ParallelFor(instances.size(), std::min<size_t>(cMaxPrepareThreads, std::thread::hardware_concurrency()),
+        [&](size_t i) { errors[i] = PrepareInstance(instances[i]); });
+
+    for (const auto& err : errors) {
+        if (!err.IsNone()) {
+            return err;
+        }
+    }
+
+    return ErrorEnum::eNone;
+}
+
 RetWithError<StaticString<cFilePathLen>> Runtime::GetAbsPath(const String& path)
 {
     try {
@@ -373,6 +1065,19 @@ RetWithError<uint32_t> Runtime::GetGIDByName(const String& groupName)
 Error Runtime::PopulateHostDevices(const String& devicePath, Array<oci::LinuxDevice>& devices)
 {
     try {
+        if (mDeviceRegistry) {
+            std::vector<oci::LinuxDevice> registryDevices;
+
+            if (auto err = mDeviceRegistry->GetDevices(devicePath.CStr(), registryDevices); err.IsNone()) {
+                for (const auto& device : registryDevices) {
+                    err = devices.PushBack(device);
+                    AOS_ERROR_CHECK_AND_THROW(err, "can't populate host devices");
+                }
+
+                return ErrorEnum::eNone;
+            }
+        }
+
         auto devPath = fs::path(devicePath.CStr());
 
         if (!fs::is_directory(devPath)) {
@@ -397,4 +1102,411 @@ Error Runtime::PopulateHostDevices(const String& devicePath, Array<oci::LinuxDev
     return ErrorEnum::eNone;
 }
 
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+std::string Runtime::AcquireLayerStack(const std::vector<std::string>& layers, std::string& mountPoint)
+{
+    std::string key;
+
+    for (const auto& layer : layers) {
+        key += (key.empty() ? "" : ":") + layer;
+    }
+
+    std::unique_lock lock {mMutex};
+
+    // Reference keeps the stack while it is created without the runtime lock
+    auto& stack       = mLayerStacks[key];
+    auto  createMutex = stack.mCreateMutex;
+
+    stack.mRefCount++;
+
+    lock.unlock();
+
+    // Instances with the same layers wait until the first one creates the stack, others don't wait
+    std::lock_guard createLock {*createMutex};
+
+    if (!stack.mMountPoint.empty()) {
+        mountPoint = stack.mMountPoint;
+
+        return key;
+    }
+
+    lock.lock();
+
+    auto stackID = std::to_string(mLayerStackID++);
+
+    lock.unlock();
+
+    auto stackMountPoint = fs::path(mConfig.mWorkingDir) / cLayerStacksDir / stackID;
+    auto idMapDir        = fs::path(mConfig.mWorkingDir) / cIDMappedDir / stackID;
+    auto imagesDir       = fs::path(mConfig.mWorkingDir) / cImagesDir / stackID;
+
+    LOG_DBG() << "Create layer stack: mountPoint=" << stackMountPoint.c_str() << ", layers=" << layers.size();
+
+    std::vector<fs::path> lowerDirs(layers.begin(), layers.end());
+
+    try {
+        fs::create_directories(stackMountPoint);
+        fs::permissions(stackMountPoint, cDirPermissions);
+
+        // Layers installed as file system images are mounted and used as lower dirs
+        for (size_t i = 0; i < lowerDirs.size(); i++) {
+            auto image = GetLayerImage(lowerDirs[i]);
+            if (image.empty()) {
+                continue;
+            }
+
+            auto imagePath = imagesDir / std::to_string(i);
+
+            fs::create_directories(imagePath);
+            fs::permissions(imagePath, cDirPermissions);
+
+            MountLayerImage(image, imagePath);
+
+            stack.mImageLayers.push_back(imagePath);
+            lowerDirs[i] = imagePath;
+        }
+
+        // Layers installed without chown are mapped to their owner through idmapped mounts
+        for (size_t i = 0; i < lowerDirs.size(); i++) {
+            auto owner = GetLayerOwner(layers[i]);
+            if (!owner.has_value()) {
+                continue;
+            }
+
+            auto idMapPath = idMapDir / std::to_string(i);
+
+            fs::create_directories(idMapPath);
+            fs::permissions(idMapPath, cDirPermissions);
+
+            MountIDMapped(lowerDirs[i], idMapPath, owner->first, owner->second);
+
+            stack.mIDMappedLayers.push_back(idMapPath);
+            lowerDirs[i] = idMapPath;
+        }
+
+        MountOverlay(stackMountPoint, lowerDirs, "", "");
+    } catch (...) {
+        for (const auto& idMapPath : stack.mIDMappedLayers) {
+            umount2(idMapPath.c_str(), MNT_DETACH);
+        }
+
+        for (const auto& imagePath : stack.mImageLayers) {
+            umount2(imagePath.c_str(), MNT_DETACH);
+        }
+
+        stack.mIDMappedLayers.clear();
+        stack.mImageLayers.clear();
+
+        fs::remove_all(stackMountPoint);
+        fs::remove_all(idMapDir);
+        fs::remove_all(imagesDir);
+
+        lock.lock();
+
+        // Instance waiting for the stack retries to create it
+        if (--stack.mRefCount == 0) {
+            mLayerStacks.erase(key);
+        }
+
+        throw;
+    }
+
+    stack.mMountPoint = stackMountPoint;
+    stack.mLayers     = layers;
+    mountPoint        = stack.mMountPoint;
+
+    return key;
+}
+
+void Runtime::MountRootFSUpper(const fs::path& stackPath, const fs::path& mountPoint)
+{
+    std::unique_lock lock {mMutex};
+
+    auto upperBase = fs::path(mConfig.mWorkingDir) / cUpperDirsDir / std::to_string(mUpperDirID++);
+
+    lock.unlock();
+
+    LOG_DBG() << "Mount rootfs upper: mountPoint=" << mountPoint.c_str() << ", upper=" << upperBase.c_str();
+
+    fs::create_directories(upperBase);
+    fs::permissions(upperBase, cDirPermissions);
+
+    try {
+        if (mConfig.mRootFSUpper == RootFSUpperType::eTmpfs) {
+            MountDir("tmpfs", upperBase, "tmpfs", MS_NOSUID | MS_NODEV, "mode=0755");
+        }
+
+        fs::create_directories(upperBase / "upper");
+        fs::permissions(upperBase / "upper", cDirPermissions);
+
+        MountOverlay(mountPoint, {stackPath}, upperBase / "work", upperBase / "upper",
+            mConfig.mRootFSUpper == RootFSUpperType::eVolatile);
+    } catch (...) {
+        if (mConfig.mRootFSUpper == RootFSUpperType::eTmpfs) {
+            umount2(upperBase.c_str(), MNT_DETACH);
+        }
+
+        fs::remove_all(upperBase);
+
+        throw;
+    }
+
+    lock.lock();
+
+    mRootFSUpperDirs[fs::absolute(mountPoint).lexically_normal().string()] = upperBase;
+}
+
+std::vector<std::string> Runtime::ReleaseLayerStack(const std::string& key)
+{
+    std::unique_lock lock {mMutex};
+
+    auto it = mLayerStacks.find(key);
+    if (it == mLayerStacks.end()) {
+        return {};
+    }
+
+    if (--it->second.mRefCount > 0) {
+        return {};
+    }
+
+    LOG_DBG() << "Remove layer stack: mountPoint=" << it->second.mMountPoint.c_str();
+
+    auto mountPoint     = fs::path(it->second.mMountPoint);
+    auto layers         = std::move(it->second.mLayers);
+    auto idMappedLayers = std::move(it->second.mIDMappedLayers);
+    auto imageLayers    = std::move(it->second.mImageLayers);
+
+    mLayerStacks.erase(it);
+
+    // Stack is not reachable anymore, so it is unmounted without the runtime lock
+    lock.unlock();
+
+    UmountDir(mountPoint);
+    fs::remove_all(mountPoint);
+
+    for (const auto& idMapPath : idMappedLayers) {
+        UmountDir(idMapPath);
+    }
+
+    if (!idMappedLayers.empty()) {
+        fs::remove_all(fs::path(idMappedLayers.front()).parent_path());
+    }
+
+    for (const auto& imagePath : imageLayers) {
+        UmountDir(imagePath);
+    }
+
+    if (!imageLayers.empty()) {
+        fs::remove_all(fs::path(imageLayers.front()).parent_path());
+    }
+
+    return layers;
+}
+
+void Runtime::UpdateWhiteoutsTemplate(HostFSWhiteouts& whiteouts, const std::set<std::string>& hostBinds)
+{
+    auto templateDir = fs::path(whiteouts.mTemplateDir);
+
+    LOG_DBG() << "Update host FS whiteouts template: path=" << templateDir.c_str();
+
+    if (!mConfig.mWorkingDir.empty()) {
+        fs::remove_all(templateDir);
+    }
+
+    fs::create_directories(templateDir);
+    fs::permissions(templateDir, cDirPermissions);
+
+    whiteouts.mItems.clear();
+
+    for (const auto& entry : fs::directory_iterator("/")) {
+        if (hostBinds.count(entry.path().string()) != 0) {
+            continue;
+        }
+
+        whiteouts.mItems.push_back(entry.path().filename());
+
+        auto itemPath = templateDir / entry.path().filename();
+
+        if (fs::exists(itemPath)) {
+            continue;
+        }
+
+        LOG_DBG() << "Create rootfs white out: path=" << itemPath.c_str();
+
+        if (auto ret = mknod(itemPath.c_str(), S_IFCHR, makedev(0, 0)); ret != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create white out");
+        }
+    }
+
+    whiteouts.mGeneration = ++mWhiteoutsGeneration;
+}
+
+void Runtime::CloneWhiteoutsTemplate(const HostFSWhiteouts& whiteouts, const fs::path& destPath)
+{
+    LOG_DBG() << "Clone host FS whiteouts: path=" << destPath.c_str();
+
+    fs::create_directories(destPath);
+    fs::permissions(destPath, cDirPermissions);
+
+    for (const auto& item : whiteouts.mItems) {
+        auto templatePath = fs::path(whiteouts.mTemplateDir) / item;
+        auto itemPath     = destPath / item;
+
+        if (link(templatePath.c_str(), itemPath.c_str()) == 0 || errno == EEXIST) {
+            continue;
+        }
+
+        // Template and destination are on different file systems
+        if (errno != EXDEV || mknod(itemPath.c_str(), S_IFCHR, makedev(0, 0)) != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create white out");
+        }
+    }
+}
+
+Error Runtime::PrepareInstance(const InstanceEnvironment& instance)
+{
+    if (!instance.mMountPointDir.empty()) {
+        std::vector<Mount> instanceMounts = instance.mMounts;
+        Array<Mount>       mounts(instanceMounts.data(), instanceMounts.size());
+
+        if (auto err = CreateMountPoints(instance.mMountPointDir.c_str(), mounts); !err.IsNone()) {
+            return err;
+        }
+    }
+
+    if (!instance.mWhiteoutsPath.empty()) {
+        auto hostBinds = std::make_unique<StaticArray<StaticString<cFilePathLen>, cMaxNumHostBinds>>();
+
+        for (const auto& bind : instance.mHostBinds) {
+            if (auto err = hostBinds->PushBack(bind.c_str()); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
+
+        if (auto err = CreateHostFSWhiteouts(instance.mWhiteoutsPath.c_str(), *hostBinds); !err.IsNone()) {
+            return err;
+        }
+    }
+
+    if (!instance.mRootFSPath.empty()) {
+        auto layers = std::make_unique<StaticArray<StaticString<cFilePathLen>, cMaxNumLayers>>();
+
+        for (const auto& layer : instance.mLayers) {
+            if (auto err = layers->PushBack(layer.c_str()); !err.IsNone()) {
+                return AOS_ERROR_WRAP(err);
+            }
+        }
+
+        if (auto err = MountServiceRootFS(instance.mRootFSPath.c_str(), *layers); !err.IsNone()) {
+            return err;
+        }
+    }
+
+    auto err = [&]() -> Error {
+        if (!instance.mStoragePath.empty()) {
+            if (auto err = PrepareServiceStorage(instance.mStoragePath.c_str(), instance.mUID, instance.mGID);
+                !err.IsNone()) {
+                return err;
+            }
+        }
+
+        if (!instance.mStatePath.empty()) {
+            if (auto err = PrepareServiceState(instance.mStatePath.c_str(), instance.mUID, instance.mGID);
+                !err.IsNone()) {
+                return err;
+            }
+        }
+
+        if (!instance.mNetworkDir.empty()) {
+            if (auto err = PrepareNetworkDir(instance.mNetworkDir.c_str()); !err.IsNone()) {
+                return err;
+            }
+        }
+
+        return ErrorEnum::eNone;
+    }();
+
+    if (!err.IsNone() && !instance.mRootFSPath.empty()) {
+        if (auto umountErr = UmountServiceRootFS(instance.mRootFSPath.c_str()); !umountErr.IsNone()) {
+            LOG_ERR() << "Can't umount service rootfs: path=" << instance.mRootFSPath.c_str()
+                      << ", err=" << umountErr;
+        }
+    }
+
+    return err;
+}
+
+void Runtime::PrefetchLayers(const Array<StaticString<cFilePathLen>>& layers) const
+{
+    if (mConfig.mPrefetchDir.empty()) {
+        return;
+    }
+
+    for (const auto& layer : layers) {
+        if (auto err = mPrefetcher.Prefetch(layer.CStr()); !err.IsNone()) {
+            LOG_WRN() << "Can't prefetch layer: layer=" << layer << ", err=" << err;
+        }
+    }
+}
+
+void Runtime::LearnLayers(const std::vector<std::string>& layers)
+{
+    if (mConfig.mPrefetchDir.empty()) {
+        return;
+    }
+
+    // Sampling walks all layer files, so instance stop doesn't wait for it
+    mPrefetcher.ScheduleLearn(layers);
+}
+
+void Runtime::CleanupLayerStacks()
+{
+    if (mConfig.mWorkingDir.empty()) {
+        return;
+    }
+
+    const auto workingDir = fs::absolute(mConfig.mWorkingDir).lexically_normal();
+
+    // Mounts left from the previous run are only detached: bind and overlay mounts of still running instances keep
+    // them alive, so their dirs are never removed recursively. Idmapped layers may be mounted on top of layer images.
+    mLayerStackID = std::max(mLayerStackID, DetachMountPoints(workingDir / cLayerStacksDir, false));
+    mLayerStackID = std::max(mLayerStackID, DetachMountPoints(workingDir / cIDMappedDir, true));
+    mLayerStackID = std::max(mLayerStackID, DetachMountPoints(workingDir / cImagesDir, true));
+
+    const auto upperDirsDir = workingDir / cUpperDirsDir;
+
+    if (!fs::exists(upperDirsDir)) {
+        return;
+    }
+
+    // Upper dirs of still mounted rootfs are kept and removed when the rootfs is unmounted
+    std::set<std::string> usedUpperDirs;
+
+    for (const auto& [mountPoint, upperDir] : GetMountedUpperDirs(upperDirsDir)) {
+        LOG_DBG() << "Keep mounted rootfs upper: mountPoint=" << mountPoint.c_str() << ", upper=" << upperDir.c_str();
+
+        mRootFSUpperDirs[mountPoint] = upperDir;
+        usedUpperDirs.insert(upperDir);
+    }
+
+    for (const auto& entry : fs::directory_iterator(upperDirsDir)) {
+        mUpperDirID = std::max(mUpperDirID, GetDirID(entry.path()) + 1);
+
+        if (usedUpperDirs.count(entry.path().string()) != 0) {
+            continue;
+        }
+
+        if (mConfig.mRootFSUpper == RootFSUpperType::eTmpfs) {
+            umount2(entry.path().c_str(), MNT_DETACH);
+        }
+
+        LOG_DBG() << "Remove unused rootfs upper: upper=" << entry.path().c_str();
+
+        fs::remove_all(entry.path());
+    }
+}
+
 } // namespace aos::sm::launcher
@@ -7,12 +7,54 @@
 #ifndef RUNTIME_HPP_
 #define RUNTIME_HPP_
 
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
 #include <aos/sm/launcher.hpp>
 
+#include "config.hpp"
+#include "prefetch.hpp"
+#include "resourcemanager/deviceregistry.hpp"
+
 namespace aos::sm::launcher {
 
+/**
+ * Instance runtime environment. Steps with empty path are skipped on preparation.
+ */
+struct InstanceEnvironment {
+    std::string              mMountPointDir;
+    std::vector<Mount>       mMounts;
+    std::string              mWhiteoutsPath;
+    std::vector<std::string> mHostBinds;
+    std::string              mRootFSPath;
+    std::vector<std::string> mLayers;
+    std::string              mStoragePath;
+    std::string              mStatePath;
+    std::string              mNetworkDir;
+    uint32_t                 mUID = 0;
+    uint32_t                 mGID = 0;
+};
+
 class Runtime : public RuntimeItf {
 public:
+    /**
+     * Initializes runtime.
+     *
+     * @param config runtime configuration.
+     * @param deviceRegistry host device registry, if not set host devices are populated from the file system.
+     * @return Error.
+     */
+    Error Init(const RuntimeConfig& config, const resourcemanager::DeviceRegistry* deviceRegistry = nullptr);
+
     /**
      * Creates host FS whiteouts.
      *
@@ -77,6 +119,16 @@ public:
      */
     Error PrepareNetworkDir(const String& path) override;
 
+    /**
+     * Prepares environments of multiple instances in parallel. Failed instance doesn't affect others and its root FS
+     * is unmounted.
+     *
+     * @param instances instance environments.
+     * @param[out] errors preparation result per instance.
+     * @return Error: first instance error if any.
+     */
+    Error PrepareInstances(const std::vector<InstanceEnvironment>& instances, std::vector<Error>& errors);
+
     /**
      * Returns absolute path of FS item.
      *
@@ -101,6 +153,55 @@ public:
      * @return Error.
      */
     virtual Error PopulateHostDevices(const String& devicePath, Array<oci::LinuxDevice>& devices) override;
+
+private:
+    static constexpr auto cLayerStacksDir = "layerstacks";
+    static constexpr auto cWhiteoutsDir   = "whiteouts";
+    static constexpr auto cIDMappedDir    = "idmapped";
+    static constexpr auto cUpperDirsDir   = "upper";
+    static constexpr auto cImagesDir      = "images";
+
+    static constexpr auto cMaxPrepareThreads = 4;
+
+    struct LayerStack {
+        std::string                 mMountPoint;
+        std::vector<std::string>    mLayers;
+        std::vector<std::string>    mIDMappedLayers;
+        std::vector<std::string>    mImageLayers;
+        size_t                      mRefCount    = 0;
+        std::shared_ptr<std::mutex> mCreateMutex = std::make_shared<std::mutex>();
+    };
+
+    struct HostFSWhiteouts {
+        std::string              mTemplateDir;
+        std::vector<std::string> mItems;
+        struct timespec          mRootModTime {};
+        size_t                   mGeneration = 0;
+        std::shared_mutex        mMutex;
+    };
+
+    std::string              AcquireLayerStack(const std::vector<std::string>& layers, std::string& mountPoint);
+    std::vector<std::string> ReleaseLayerStack(const std::string& key);
+
+    void  CleanupLayerStacks();
+    void  PrefetchLayers(const Array<StaticString<cFilePathLen>>& layers) const;
+    void  LearnLayers(const std::vector<std::string>& layers);
+    Error PrepareInstance(const InstanceEnvironment& instance);
+    void  MountRootFSUpper(const std::filesystem::path& stackPath, const std::filesystem::path& mountPoint);
+    void  UpdateWhiteoutsTemplate(HostFSWhiteouts& whiteouts, const std::set<std::string>& hostBinds);
+    void  CloneWhiteoutsTemplate(const HostFSWhiteouts& whiteouts, const std::filesystem::path& destPath);
+
+    RuntimeConfig                          mConfig;
+    const resourcemanager::DeviceRegistry* mDeviceRegistry = nullptr;
+    std::mutex                             mMutex;
+    std::map<std::string, LayerStack>      mLayerStacks;
+    std::map<std::string, std::string>     mRootFSLayerStacks;
+    std::map<std::string, std::string>     mRootFSUpperDirs;
+    size_t                                 mLayerStackID = 0;
+    size_t                                 mUpperDirID   = 0;
+    std::map<std::string, HostFSWhiteouts> mHostFSWhiteouts;
+    std::atomic_size_t                     mWhiteoutsGeneration = 0;
+    LayerPrefetcher                        mPrefetcher;
 };
 
 } // namespace aos::sm::launcher
@@ -0,0 +1,711 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <net/if.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/pkt_cls.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+#include <linux/tc_act/tc_mirred.h>
+#include <map>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include <Poco/JSON/Object.h>
+#include <Poco/SHA2Engine.h>
+
+#include <utils/exception.hpp>
+#include <utils/json.hpp>
+#include <utils/parser.hpp>
+
+#include "bandwidth.hpp"
+#include "logger/logmodule.hpp"
+
+namespace aos::sm::cni {
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto     cIFBPrefix         = "bwp";
+constexpr auto     cIFBHashLen        = IFNAMSIZ - 1 - 3;
+constexpr auto     cLatencyUsec       = 25000.0;
+constexpr auto     cTimeUnitsPerSec   = 1000000.0;
+constexpr auto     cDefaultTickInUsec = 15.625;
+constexpr auto     cPSchedPath        = "/proc/net/psched";
+constexpr auto     cSysClassNetPath   = "/sys/class/net";
+constexpr auto     cNetlinkBufferSize = 8192;
+constexpr uint32_t cTBFHandle         = 0x00010000;
+constexpr uint32_t cIngressHandle     = 0xffff0000;
+constexpr uint32_t cFilterClassID     = 0x00010001;
+constexpr uint32_t cFilterPriority    = 1;
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+/**
+ * Rtnetlink request with attributes.
+ */
+class NetlinkRequest {
+public:
+    NetlinkRequest(uint16_t type, uint16_t flags)
+        : mBuffer(NLMSG_HDRLEN)
+    {
+        auto header = Header();
+
+        header->nlmsg_len   = NLMSG_HDRLEN;
+        header->nlmsg_type  = type;
+        header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+    }
+
+    template <typename T>
+    void Add(const T& data)
+    {
+        Append(&data, sizeof(data));
+    }
+
+    template <typename T>
+    void AddAttr(uint16_t type, const T& value)
+    {
+        AddAttr(type, &value, sizeof(value));
+    }
+
+    void AddAttr(uint16_t type, const void* data, size_t size)
+    {
+        rtattr attr {static_cast<uint16_t>(RTA_LENGTH(size)), type};
+
+        Append(&attr, sizeof(attr));
+        Append(data, size);
+    }
+
+    void AddStringAttr(uint16_t type, const std::string& value) { AddAttr(type, value.c_str(), value.size() + 1); }
+
+    size_t BeginNested(uint16_t type)
+    {
+        const auto offset = mBuffer.size();
+
+        AddAttr(type, nullptr, 0);
+
+        return offset;
+    }
+
+    void EndNested(size_t offset)
+    {
+        reinterpret_cast<rtattr*>(&mBuffer[offset])->rta_len = static_cast<uint16_t>(mBuffer.size() - offset);
+    }
+
+    nlmsghdr* Header() { return reinterpret_cast<nlmsghdr*>(mBuffer.data()); }
+
+private:
+    void Append(const void* data, size_t size)
+    {
+        const auto offset = mBuffer.size();
+
+        mBuffer.resize(offset + NLMSG_ALIGN(size));
+
+        if (size != 0) {
+            std::memcpy(&mBuffer[offset], data, size);
+        }
+
+        Header()->nlmsg_len = mBuffer.size();
+    }
+
+    std::vector<uint8_t> mBuffer;
+};
+
+/**
+ * Rtnetlink socket.
+ */
+class Netlink {
+public:
+    Netlink()
+        : mFD(socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE))
+    {
+        if (mFD < 0) {
+            AOS_ERROR_THROW(Error(errno), "can't open netlink socket");
+        }
+    }
+
+    Netlink(const Netlink&)            = delete;
+    Netlink& operator=(const Netlink&) = delete;
+
+    ~Netlink() { close(mFD); }
+
+    // Returns errno reported by kernel for the request
+    int Send(NetlinkRequest& request)
+    {
+        auto header = request.Header();
+
+        header->nlmsg_seq = ++mSeq;
+
+        sockaddr_nl addr {};
+
+        addr.nl_family = AF_NETLINK;
+
+        if (sendto(mFD, header, header->nlmsg_len, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            return errno;
+        }
+
+        std::vector<uint32_t> buffer(cNetlinkBufferSize / sizeof(uint32_t));
+
+        while (true) {
+            auto len = recv(mFD, buffer.data(), buffer.size() * sizeof(uint32_t), 0);
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return errno;
+            }
+
+            const auto data = reinterpret_cast<const uint8_t*>(buffer.data());
+
+            for (size_t offset = 0; offset + sizeof(nlmsghdr) <= static_cast<size_t>(len);) {
+                auto msg = reinterpret_cast<const nlmsghdr*>(data + offset);
+
+                if (msg->nlmsg_len < sizeof(nlmsghdr) || offset + msg->nlmsg_len > static_cast<size_t>(len)) {
+                    break;
+                }
+
+                if (msg->nlmsg_seq == mSeq && msg->nlmsg_type == NLMSG_ERROR) {
+                    return -static_cast<const nlmsgerr*>(NLMSG_DATA(msg))->error;
+                }
+
+                offset += NLMSG_ALIGN(msg->nlmsg_len);
+            }
+        }
+    }
+
+private:
+    int      mFD;
+    uint32_t mSeq = 0;
+};
+
+std::map<std::string, std::string> ParseArgs(const std::string& args)
+{
+    std::map<std::string, std::string> env;
+    std::istringstream                 iss(args);
+    std::string                        token;
+
+    while (std::getline(iss, token, ' ')) {
+        if (!token.empty()) {
+            if (auto keyValue = aos::common::utils::ParseKeyValue(token, true, "="); keyValue.has_value()) {
+                env[keyValue->mKey] = keyValue->mValue;
+            }
+        }
+    }
+
+    return env;
+}
+
+Error ValidateRateAndBurst(uint64_t rate, uint64_t burst)
+{
+    if ((rate == 0) != (burst == 0)) {
+        return Error(ErrorEnum::eInvalidArgument, "rate and burst should be set together");
+    }
+
+    if (burst / 8 >= UINT32_MAX) {
+        return Error(ErrorEnum::eInvalidArgument, "burst can't be more than 4GB");
+    }
+
+    return ErrorEnum::eNone;
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+RetWithError<BandwidthLimits> ParseBandwidthLimits(const Poco::JSON::Object::Ptr& config)
+{
+    try {
+        aos::common::utils::CaseInsensitiveObjectWrapper object(config);
+
+        const auto hasRuntimeLimits = object.Has("runtimeConfig") && object.GetObject("runtimeConfig").Has("bandwidth");
+        const auto source = hasRuntimeLimits ? object.GetObject("runtimeConfig").GetObject("bandwidth") : object;
+
+        BandwidthLimits limits;
+
+        limits.mIngressRate  = source.GetOptionalValue<uint64_t>("ingressRate").value_or(0);
+        limits.mIngressBurst = source.GetOptionalValue<uint64_t>("ingressBurst").value_or(0);
+        limits.mEgressRate   = source.GetOptionalValue<uint64_t>("egressRate").value_or(0);
+        limits.mEgressBurst  = source.GetOptionalValue<uint64_t>("egressBurst").value_or(0);
+
+        if (auto err = ValidateRateAndBurst(limits.mIngressRate, limits.mIngressBurst); !err.IsNone()) {
+            return {{}, AOS_ERROR_WRAP(err)};
+        }
+
+        if (auto err = ValidateRateAndBurst(limits.mEgressRate, limits.mEgressBurst); !err.IsNone()) {
+            return {{}, AOS_ERROR_WRAP(err)};
+        }
+
+        return limits;
+    } catch (const std::exception& e) {
+        return {{}, AOS_ERROR_WRAP(aos::common::utils::ToAosError(e))};
+    }
+}
+
+RetWithError<TBFParams> CalculateTBF(uint64_t rateInBits, uint64_t burstInBits, double tickInUsec)
+{
+    const auto rate  = rateInBits / 8;
+    const auto burst = burstInBits / 8;
+
+    if (rate == 0 || burst == 0) {
+        return {{}, AOS_ERROR_WRAP(Error(ErrorEnum::eInvalidArgument, "rate and burst should be at least 8 bits"))};
+    }
+
+    // Buffer is time to send the burst at the rate in scheduler ticks, limit is what is queued for the latency.
+    // Intermediate values are truncated as in the plugin binary to get the same qdisc.
+    const auto bufferInUsec = static_cast<uint32_t>(static_cast<double>(burst) * cTimeUnitsPerSec / rate);
+
+    TBFParams params;
+
+    params.mRate   = rate;
+    params.mBuffer = static_cast<uint32_t>(bufferInUsec * tickInUsec);
+    params.mLimit
+        = static_cast<uint32_t>(static_cast<double>(rate) * cLatencyUsec / cTimeUnitsPerSec) + static_cast<uint32_t>(burst);
+
+    return params;
+}
+
+// IFB device name matches the one created by the plugin binary, so either of them can delete it
+std::string GetIFBName(const std::string& networkName, const std::string& containerID)
+{
+    Poco::SHA2Engine engine(Poco::SHA2Engine::SHA_512);
+
+    engine.update(networkName + containerID);
+
+    return cIFBPrefix + Poco::DigestEngine::digestToHex(engine.digest()).substr(0, cIFBHashLen);
+}
+
+/***********************************************************************************************************************
+ * NetlinkTrafficControl
+ **********************************************************************************************************************/
+
+double NetlinkTrafficControl::GetTickInUsec() const
+{
+    std::ifstream file(cPSchedPath);
+    uint32_t      t2us = 0, us2t = 0, clockRes = 0;
+
+    if (!(file >> std::hex >> t2us >> us2t >> clockRes) || us2t == 0) {
+        return cDefaultTickInUsec;
+    }
+
+    return static_cast<double>(t2us) / us2t * (clockRes / cTimeUnitsPerSec);
+}
+
+RetWithError<LinkInfo> NetlinkTrafficControl::GetLink(const std::string& name) const
+{
+    LinkInfo link;
+
+    link.mIndex = static_cast<int>(if_nametoindex(name.c_str()));
+    if (link.mIndex == 0) {
+        return {link, AOS_ERROR_WRAP(Error(errno, "can't get interface index"))};
+    }
+
+    const auto    path = std::filesystem::path(cSysClassNetPath) / name;
+    std::ifstream file(path / "mtu");
+
+    if (!(file >> link.mMTU)) {
+        return {link, AOS_ERROR_WRAP(Error(ErrorEnum::eNotFound, "can't get interface MTU"))};
+    }
+
+    link.mBridge = std::filesystem::exists(path / "bridge");
+
+    return link;
+}
+
+Error NetlinkTrafficControl::AddTBF(int ifIndex, const TBFParams& params)
+{
+    try {
+        Netlink     netlink;
+        tcmsg       msg {};
+        tc_tbf_qopt qopt {};
+
+        msg.tcm_family  = AF_UNSPEC;
+        msg.tcm_ifindex = ifIndex;
+        msg.tcm_handle  = cTBFHandle;
+        msg.tcm_parent  = TC_H_ROOT;
+
+        qopt.rate.rate      = static_cast<uint32_t>(std::min<uint64_t>(params.mRate, UINT32_MAX));
+        qopt.rate.linklayer = TC_LINKLAYER_ETHERNET;
+        qopt.buffer         = params.mBuffer;
+        qopt.limit          = params.mLimit;
+
+        NetlinkRequest request(RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL);
+
+        request.Add(msg);
+        request.AddStringAttr(TCA_KIND, "tbf");
+
+        auto options = request.BeginNested(TCA_OPTIONS);
+
+        request.AddAttr(TCA_TBF_PARMS, qopt);
+
+        if (params.mRate > UINT32_MAX) {
+            request.AddAttr(TCA_TBF_RATE64, params.mRate);
+        }
+
+        request.EndNested(options);
+
+        if (auto err = netlink.Send(request); err != 0) {
+            return AOS_ERROR_WRAP(Error(err, "can't add tbf qdisc"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(aos::common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error NetlinkTrafficControl::AddIFB(const std::string& name, uint32_t mtu)
+{
+    try {
+        Netlink   netlink;
+        ifinfomsg msg {};
+
+        msg.ifi_family = AF_UNSPEC;
+        msg.ifi_flags  = IFF_UP;
+        msg.ifi_change = IFF_UP;
+
+        NetlinkRequest request(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL);
+
+        request.Add(msg);
+        request.AddStringAttr(IFLA_IFNAME, name);
+        request.AddAttr(IFLA_MTU, mtu);
+
+        auto linkInfo = request.BeginNested(IFLA_LINKINFO);
+
+        request.AddStringAttr(IFLA_INFO_KIND, "ifb");
+        request.EndNested(linkInfo);
+
+        if (auto err = netlink.Send(request); err != 0) {
+            return AOS_ERROR_WRAP(Error(err, "can't add ifb device"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(aos::common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error NetlinkTrafficControl::AddIngressRedirect(int ifIndex, int redirectIndex)
+{
+    try {
+        Netlink netlink;
+
+        {
+            tcmsg msg {};
+
+            msg.tcm_family  = AF_UNSPEC;
+            msg.tcm_ifindex = ifIndex;
+            msg.tcm_handle  = cIngressHandle;
+            msg.tcm_parent  = TC_H_INGRESS;
+
+            NetlinkRequest request(RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL);
+
+            request.Add(msg);
+            request.AddStringAttr(TCA_KIND, "ingress");
+
+            if (auto err = netlink.Send(request); err != 0) {
+                return AOS_ERROR_WRAP(Error(err, "can't add ingress qdisc"));
+            }
+        }
+
+        tcmsg msg {};
+
+        msg.tcm_family  = AF_UNSPEC;
+        msg.tcm_ifindex = ifIndex;
+        msg.tcm_parent  = cIngressHandle;
+        msg.tcm_info    = TC_H_MAKE(cFilterPriority << 16, htons(ETH_P_ALL));
+
+        // Selector with single zero key matches all packets
+        std::vector<uint8_t> selector(sizeof(tc_u32_sel) + sizeof(tc_u32_key));
+        tc_u32_sel           sel {};
+
+        sel.flags = TC_U32_TERMINAL;
+        sel.nkeys = 1;
+
+        std::memcpy(selector.data(), &sel, sizeof(sel));
+
+        tc_mirred mirred {};
+
+        mirred.action  = TC_ACT_STOLEN;
+        mirred.eaction = TCA_EGRESS_REDIR;
+        mirred.ifindex = redirectIndex;
+
+        NetlinkRequest request(RTM_NEWTFILTER, NLM_F_CREATE | NLM_F_EXCL);
+
+        request.Add(msg);
+        request.AddStringAttr(TCA_KIND, "u32");
+
+        auto options = request.BeginNested(TCA_OPTIONS);
+
+        request.AddAttr(TCA_U32_CLASSID, cFilterClassID);
+        request.AddAttr(TCA_U32_SEL, selector.data(), selector.size());
+
+        auto actions = request.BeginNested(TCA_U32_ACT);
+        auto action  = request.BeginNested(1);
+
+        request.AddStringAttr(TCA_ACT_KIND, "mirred");
+
+        auto actionOptions = request.BeginNested(TCA_ACT_OPTIONS);
+
+        request.AddAttr(TCA_MIRRED_PARMS, mirred);
+        request.EndNested(actionOptions);
+        request.EndNested(action);
+        request.EndNested(actions);
+        request.EndNested(options);
+
+        if (auto err = netlink.Send(request); err != 0) {
+            return AOS_ERROR_WRAP(Error(err, "can't add redirect filter"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(aos::common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error NetlinkTrafficControl::DeleteLink(const std::string& name)
+{
+    auto index = if_nametoindex(name.c_str());
+    if (index == 0) {
+        return ErrorEnum::eNone;
+    }
+
+    try {
+        Netlink   netlink;
+        ifinfomsg msg {};
+
+        msg.ifi_family = AF_UNSPEC;
+        msg.ifi_index  = static_cast<int>(index);
+
+        NetlinkRequest request(RTM_DELLINK, 0);
+
+        request.Add(msg);
+
+        if (auto err = netlink.Send(request); err != 0 && err != ENODEV) {
+            return AOS_ERROR_WRAP(Error(err, "can't delete link"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(aos::common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error NetlinkTrafficControl::DeleteQdisc(int ifIndex, uint32_t parent)
+{
+    try {
+        Netlink netlink;
+        tcmsg   msg {};
+
+        msg.tcm_family  = AF_UNSPEC;
+        msg.tcm_ifindex = ifIndex;
+        msg.tcm_parent  = parent;
+
+        NetlinkRequest request(RTM_DELQDISC, 0);
+
+        request.Add(msg);
+
+        if (auto err = netlink.Send(request); err != 0 && err != ENOENT && err != EINVAL && err != ENODEV) {
+            return AOS_ERROR_WRAP(Error(err, "can't delete qdisc"));
+        }
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(aos::common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+/***********************************************************************************************************************
+ * BandwidthPlugin
+ **********************************************************************************************************************/
+
+Error BandwidthPlugin::Init(TrafficControlItf& trafficControl)
+{
+    LOG_DBG() << "Init bandwidth plugin";
+
+    mTrafficControl = &trafficControl;
+
+    return ErrorEnum::eNone;
+}
+
+RetWithError<std::string> BandwidthPlugin::ExecPlugin(
+    const std::string& payload, [[maybe_unused]] const std::string& pluginPath, const std::string& args) const
+{
+    try {
+        auto env = ParseArgs(args);
+
+        auto [json, err] = aos::common::utils::ParseJson(payload);
+        AOS_ERROR_CHECK_AND_THROW(err, "failed to parse plugin config");
+
+        const auto  config  = json.extract<Poco::JSON::Object::Ptr>();
+        const auto& command = env["CNI_COMMAND"];
+        const auto  ifbName = GetIFBName(
+            aos::common::utils::CaseInsensitiveObjectWrapper(config).GetValue<std::string>("name"),
+            env["CNI_CONTAINERID"]);
+
+        if (command == "ADD") {
+            return {Add(config, ifbName), ErrorEnum::eNone};
+        }
+
+        if (command == "DEL") {
+            err = mTrafficControl->DeleteLink(ifbName);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't delete ifb device");
+
+            return {"", ErrorEnum::eNone};
+        }
+
+        AOS_ERROR_THROW(ErrorEnum::eNotSupported, "command not supported");
+    } catch (const std::exception& e) {
+        return {"", AOS_ERROR_WRAP(aos::common::utils::ToAosError(e))};
+    }
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+std::string BandwidthPlugin::Add(const Poco::JSON::Object::Ptr& config, const std::string& ifbName) const
+{
+    auto [limits, err] = ParseBandwidthLimits(config);
+    AOS_ERROR_CHECK_AND_THROW(err, "invalid bandwidth limits");
+
+    auto prevResult = config->getObject("prevResult");
+    if (!prevResult) {
+        AOS_ERROR_THROW(ErrorEnum::eInvalidArgument, "previous result is required");
+    }
+
+    std::ostringstream result;
+
+    prevResult->stringify(result);
+
+    if (limits.mIngressRate == 0 && limits.mEgressRate == 0) {
+        return result.str();
+    }
+
+    // Parameters are calculated before anything is configured, so invalid limits leave no state behind
+    const auto tickInUsec = mTrafficControl->GetTickInUsec();
+    TBFParams  ingress, egress;
+
+    if (limits.mIngressRate != 0) {
+        Tie(ingress, err) = CalculateTBF(limits.mIngressRate, limits.mIngressBurst, tickInUsec);
+        AOS_ERROR_CHECK_AND_THROW(err, "invalid ingress limits");
+    }
+
+    if (limits.mEgressRate != 0) {
+        Tie(egress, err) = CalculateTBF(limits.mEgressRate, limits.mEgressBurst, tickInUsec);
+        AOS_ERROR_CHECK_AND_THROW(err, "invalid egress limits");
+    }
+
+    LinkInfo   hostLink;
+    const auto hostIf = FindHostInterface(prevResult, hostLink);
+
+    LOG_DBG() << "Add bandwidth limits: hostIf=" << hostIf.c_str() << ", ingressRate=" << limits.mIngressRate
+              << ", egressRate=" << limits.mEgressRate;
+
+    bool tbfAdded = false, ifbAdded = false, redirectAdded = false;
+
+    try {
+        // Traffic to the instance leaves the host through its veth
+        if (limits.mIngressRate != 0) {
+            err = mTrafficControl->AddTBF(hostLink.mIndex, ingress);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't add ingress limit");
+
+            tbfAdded = true;
+        }
+
+        // Traffic from the instance enters the host through its veth and is shaped on IFB
+        if (limits.mEgressRate != 0) {
+            err = mTrafficControl->AddIFB(ifbName, hostLink.mMTU);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't add ifb device");
+
+            ifbAdded = true;
+
+            LinkInfo ifbLink;
+
+            Tie(ifbLink, err) = mTrafficControl->GetLink(ifbName);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't get ifb device");
+
+            // Ingress qdisc may be left even if the filter fails
+            redirectAdded = true;
+
+            err = mTrafficControl->AddIngressRedirect(hostLink.mIndex, ifbLink.mIndex);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't redirect traffic to ifb device");
+
+            err = mTrafficControl->AddTBF(ifbLink.mIndex, egress);
+            AOS_ERROR_CHECK_AND_THROW(err, "can't add egress limit");
+        }
+    } catch (...) {
+        // Only what was added here is removed, so qdiscs and devices of others are kept
+        if (redirectAdded) {
+            if (auto cleanupErr = mTrafficControl->DeleteQdisc(hostLink.mIndex, TC_H_INGRESS); !cleanupErr.IsNone()) {
+                LOG_WRN() << "Can't delete ingress qdisc: err=" << cleanupErr;
+            }
+        }
+
+        if (ifbAdded) {
+            if (auto cleanupErr = mTrafficControl->DeleteLink(ifbName); !cleanupErr.IsNone()) {
+                LOG_WRN() << "Can't delete ifb device: err=" << cleanupErr;
+            }
+        }
+
+        if (tbfAdded) {
+            if (auto cleanupErr = mTrafficControl->DeleteQdisc(hostLink.mIndex, TC_H_ROOT); !cleanupErr.IsNone()) {
+                LOG_WRN() << "Can't delete tbf qdisc: err=" << cleanupErr;
+            }
+        }
+
+        throw;
+    }
+
+    return result.str();
+}
+
+std::string BandwidthPlugin::FindHostInterface(const Poco::JSON::Object::Ptr& prevResult, LinkInfo& link) const
+{
+    const auto names = aos::common::utils::GetArrayValue<std::string>(
+        aos::common::utils::CaseInsensitiveObjectWrapper(prevResult), "interfaces", [](const auto& value) {
+            aos::common::utils::CaseInsensitiveObjectWrapper iface(value);
+
+            return iface.GetOptionalValue<std::string>("sandbox").value_or("").empty()
+                ? iface.GetOptionalValue<std::string>("name").value_or("")
+                : std::string();
+        });
+
+    // Host side interfaces are the bridge and the instance veth
+    for (const auto& name : names) {
+        if (name.empty()) {
+            continue;
+        }
+
+        Error err;
+
+        Tie(link, err) = mTrafficControl->GetLink(name);
+        if (err.IsNone() && !link.mBridge) {
+            return name;
+        }
+    }
+
+    AOS_ERROR_THROW(ErrorEnum::eNotFound, "host interface not found");
+}
+
+} // namespace aos::sm::cni
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BANDWIDTH_HPP_
+#define BANDWIDTH_HPP_
+
+#include <string>
+
+#include <Poco/JSON/Object.h>
+
+#include "exec.hpp"
+
+namespace aos::sm::cni {
+
+/**
+ * Bandwidth limits in bits per second and bits.
+ */
+struct BandwidthLimits {
+    uint64_t mIngressRate  = 0;
+    uint64_t mIngressBurst = 0;
+    uint64_t mEgressRate   = 0;
+    uint64_t mEgressBurst  = 0;
+};
+
+/**
+ * TBF qdisc parameters.
+ */
+struct TBFParams {
+    uint64_t mRate   = 0; // bytes per second
+    uint32_t mBuffer = 0; // scheduler ticks
+    uint32_t mLimit  = 0; // bytes
+};
+
+/**
+ * Network link info.
+ */
+struct LinkInfo {
+    int      mIndex  = 0;
+    uint32_t mMTU    = 0;
+    bool     mBridge = false;
+};
+
+/**
+ * Parses bandwidth limits from plugin config, runtime config limits take precedence.
+ *
+ * @param config plugin config.
+ * @return RetWithError<BandwidthLimits>.
+ */
+RetWithError<BandwidthLimits> ParseBandwidthLimits(const Poco::JSON::Object::Ptr& config);
+
+/**
+ * Calculates TBF parameters the same way as the CNI bandwidth plugin binary does.
+ *
+ * @param rateInBits rate in bits per second.
+ * @param burstInBits burst in bits.
+ * @param tickInUsec scheduler ticks per microsecond.
+ * @return RetWithError<TBFParams>.
+ */
+RetWithError<TBFParams> CalculateTBF(uint64_t rateInBits, uint64_t burstInBits, double tickInUsec);
+
+/**
+ * Returns IFB device name the CNI bandwidth plugin binary uses for the network and container.
+ *
+ * @param networkName network name.
+ * @param containerID container ID.
+ * @return std::string.
+ */
+std::string GetIFBName(const std::string& networkName, const std::string& containerID);
+
+/**
+ * Traffic control interface.
+ */
+class TrafficControlItf {
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~TrafficControlItf() = default;
+
+    /**
+     * Returns scheduler ticks per microsecond.
+     *
+     * @return double.
+     */
+    virtual double GetTickInUsec() const = 0;
+
+    /**
+     * Returns link info.
+     *
+     * @param name link name.
+     * @return RetWithError<LinkInfo>.
+     */
+    virtual RetWithError<LinkInfo> GetLink(const std::string& name) const = 0;
+
+    /**
+     * Adds root TBF qdisc.
+     *
+     * @param ifIndex link index.
+     * @param params TBF parameters.
+     * @return Error.
+     */
+    virtual Error AddTBF(int ifIndex, const TBFParams& params) = 0;
+
+    /**
+     * Adds IFB device and sets it up.
+     *
+     * @param name device name.
+     * @param mtu device MTU.
+     * @return Error.
+     */
+    virtual Error AddIFB(const std::string& name, uint32_t mtu) = 0;
+
+    /**
+     * Adds ingress qdisc with filter redirecting all traffic to another link.
+     *
+     * @param ifIndex link index.
+     * @param redirectIndex redirect link index.
+     * @return Error.
+     */
+    virtual Error AddIngressRedirect(int ifIndex, int redirectIndex) = 0;
+
+    /**
+     * Deletes link, missing link is not an error.
+     *
+     * @param name link name.
+     * @return Error.
+     */
+    virtual Error DeleteLink(const std::string& name) = 0;
+
+    /**
+     * Deletes qdisc, missing qdisc is not an error.
+     *
+     * @param ifIndex link index.
+     * @param parent qdisc parent handle.
+     * @return Error.
+     */
+    virtual Error DeleteQdisc(int ifIndex, uint32_t parent) = 0;
+};
+
+/**
+ * Traffic control over rtnetlink.
+ */
+class NetlinkTrafficControl : public TrafficControlItf {
+public:
+    /**
+     * Returns scheduler ticks per microsecond.
+     *
+     * @return double.
+     */
+    double GetTickInUsec() const override;
+
+    /**
+     * Returns link info.
+     *
+     * @param name link name.
+     * @return RetWithError<LinkInfo>.
+     */
+    RetWithError<LinkInfo> GetLink(const std::string& name) const override;
+
+    /**
+     * Adds root TBF qdisc.
+     *
+     * @param ifIndex link index.
+     * @param params TBF parameters.
+     * @return Error.
+     */
+    Error AddTBF(int ifIndex, const TBFParams& params) override;
+
+    /**
+     * Adds IFB device and sets it up.
+     *
+     * @param name device name.
+     * @param mtu device MTU.
+     * @return Error.
+     */
+    Error AddIFB(const std::string& name, uint32_t mtu) override;
+
+    /**
+     * Adds ingress qdisc with filter redirecting all traffic to another link.
+     *
+     * @param ifIndex link index.
+     * @param redirectIndex redirect link index.
+     * @return Error.
+     */
+    Error AddIngressRedirect(int ifIndex, int redirectIndex) override;
+
+    /**
+     * Deletes link, missing link is not an error.
+     *
+     * @param name link name.
+     * @return Error.
+     */
+    Error DeleteLink(const std::string& name) override;
+
+    /**
+     * Deletes qdisc, missing qdisc is not an error.
+     *
+     * @param ifIndex link index.
+     * @param parent qdisc parent handle.
+     * @return Error.
+     */
+    Error DeleteQdisc(int ifIndex, uint32_t parent) override;
+};
+
+/**
+ * Native implementation of the CNI bandwidth plugin. Traffic to the instance is shaped by TBF qdisc on the host veth,
+ * traffic from the instance is redirected to IFB device and shaped there. This is the only plugin of the chain
+ * implemented natively so far: bridge, IPAM and firewall are still executed by the external plugin binaries.
+ */
+class BandwidthPlugin : public ExecItf {
+public:
+    /**
+     * Initializes bandwidth plugin.
+     *
+     * @param trafficControl traffic control.
+     * @return Error.
+     */
+    Error Init(TrafficControlItf& trafficControl);
+
+    /**
+     * Executes bandwidth plugin action.
+     *
+     * @param payload Plugin payload.
+     * @param pluginPath Path to the plugin, not used.
+     * @param args Plugin arguments.
+     * @return RetWithError<std::string>.
+     */
+    RetWithError<std::string> ExecPlugin(
+        const std::string& payload, const std::string& pluginPath, const std::string& args) const override;
+
+private:
+    std::string Add(const Poco::JSON::Object::Ptr& config, const std::string& ifbName) const;
+    std::string FindHostInterface(const Poco::JSON::Object::Ptr& prevResult, LinkInfo& link) const;
+
+    TrafficControlItf* mTrafficControl {};
+};
+
+} // namespace aos::sm::cni
+
+#endif // BANDWIDTH_HPP_
@@ -9,6 +9,7 @@
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 
 #include <Poco/Base64Decoder.h>
@@ -28,6 +29,68 @@ namespace {
  * Static
  **********************************************************************************************************************/
 
+template <typename T>
+std::string Stringify(const T& json)
+{
+    std::ostringstream oss;
+
+    json.stringify(oss);
+
+    return oss.str();
+}
+
+void HashCombine(size_t& seed, size_t hash)
+{
+    seed ^= hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+void HashCombine(size_t& seed, const String& value)
+{
+    HashCombine(seed, std::hash<std::string_view> {}(std::string_view(value.CStr(), value.Size())));
+}
+
+void HashCombine(size_t& seed, bool value)
+{
+    HashCombine(seed, std::hash<bool> {}(value));
+}
+
+// Hash covers only fields rendered into plugin templates
+size_t CalculateTemplatesHash(const NetworkConfigList& net)
+{
+    size_t hash = 0;
+
+    HashCombine(hash, net.mBridge.mType);
+    HashCombine(hash, net.mBridge.mBridge);
+    HashCombine(hash, net.mBridge.mIsGateway);
+    HashCombine(hash, net.mBridge.mIPMasq);
+    HashCombine(hash, net.mBridge.mHairpinMode);
+    HashCombine(hash, net.mBridge.mIPAM.mType);
+    HashCombine(hash, net.mBridge.mIPAM.mName);
+    HashCombine(hash, net.mBridge.mIPAM.mDataDir);
+    HashCombine(hash, net.mBridge.mIPAM.mRange.mSubnet);
+    HashCombine(hash, net.mBridge.mIPAM.mRange.mGateway);
+
+    for (const auto& router : net.mBridge.mIPAM.mRouters) {
+        HashCombine(hash, router.mDst);
+        HashCombine(hash, router.mGW);
+    }
+
+    HashCombine(hash, net.mDNS.mType);
+    HashCombine(hash, net.mDNS.mMultiDomain);
+    HashCombine(hash, net.mDNS.mDomainName);
+    HashCombine(hash, net.mDNS.mCapabilities.mAliases);
+
+    for (const auto& server : net.mDNS.mRemoteServers) {
+        HashCombine(hash, server);
+    }
+
+    HashCombine(hash, net.mFirewall.mType);
+    HashCombine(hash, net.mFirewall.mAllowPublicConnections);
+    HashCombine(hash, net.mBandwidth.mType);
+
+    return hash;
+}
+
 template <typename InputContainer, typename OutputContainer>
 void Copy(const InputContainer& input, OutputContainer& output)
 {
@@ -191,13 +254,14 @@ Error CNI::AddNetworkList(const NetworkConfigList& net, const RuntimeConf& rt, R
     try {
         auto prevResult = ResultToJSON(net.mPrevResult);
         auto args       = ArgsAsString(rt, ActionEnum::eAdd);
+        auto templates  = GetPluginTemplates(net);
 
-        std::vector<std::string> plugins;
+        Poco::JSON::Array plugins;
 
-        prevResult = ExecuteBridgePlugin(net, prevResult, args, plugins);
-        prevResult = ExecuteDNSPlugin(net, rt, prevResult, args, plugins);
-        prevResult = ExecuteFirewallPlugin(net, prevResult, args, plugins);
-        prevResult = ExecuteBandwidthPlugin(net, prevResult, args, plugins);
+        prevResult = ExecuteBridgePlugin(net, templates, prevResult, args, plugins);
+        prevResult = ExecuteDNSPlugin(net, rt, templates, prevResult, args, plugins);
+        prevResult = ExecuteFirewallPlugin(net, templates, prevResult, args, plugins);
+        prevResult = ExecuteBandwidthPlugin(net, templates, prevResult, args, plugins);
 
         ParsePrevResult(prevResult, result);
         auto path = std::filesystem::path(mConfigDir) / (net.mName.CStr() + std::string("-") + rt.mContainerID.CStr());
@@ -217,13 +281,14 @@ Error CNI::DeleteNetworkList(const NetworkConfigList& net, const RuntimeConf& rt
     try {
         auto prevResult = ResultToJSON(net.mPrevResult);
         auto args       = ArgsAsString(rt, ActionEnum::eDel);
+        auto templates  = GetPluginTemplates(net);
 
-        std::vector<std::string> plugins;
+        Poco::JSON::Array plugins;
 
-        ExecuteBridgePlugin(net, prevResult, args, plugins);
-        ExecuteDNSPlugin(net, rt, prevResult, args, plugins);
-        ExecuteFirewallPlugin(net, prevResult, args, plugins);
-        ExecuteBandwidthPlugin(net, prevResult, args, plugins);
+        ExecuteBridgePlugin(net, templates, prevResult, args, plugins);
+        ExecuteDNSPlugin(net, rt, templates, prevResult, args, plugins);
+        ExecuteFirewallPlugin(net, templates, prevResult, args, plugins);
+        ExecuteBandwidthPlugin(net, templates, prevResult, args, plugins);
 
         if (!std::filesystem::remove(
                 std::filesystem::path(mConfigDir) / (net.mName.CStr() + std::string("-") + rt.mContainerID.CStr()))) {
@@ -334,7 +399,7 @@ Error CNI::GetNetworkListCachedConfig(NetworkConfigList& net, RuntimeConf& rt)
 
         rt.mIfName = cacheObj.GetOptionalValue<std::string>("ifName").value_or("").c_str();
 
-        ParsePrevResult(cacheObj.GetValue<std::string>("result"), net.mPrevResult);
+        ParsePrevResult(cacheJson.extract<Poco::JSON::Object::Ptr>()->getObject("result"), net.mPrevResult);
 
         return ErrorEnum::eNone;
     } catch (const std::exception& e) {
@@ -346,6 +411,26 @@ Error CNI::GetNetworkListCachedConfig(NetworkConfigList& net, RuntimeConf& rt)
  * Private
  **********************************************************************************************************************/
 
+CNI::PluginTemplates CNI::GetPluginTemplates(const NetworkConfigList& net)
+{
+    const auto hash = CalculateTemplatesHash(net);
+
+    std::lock_guard lock {mTemplatesMutex};
+
+    if (auto it = mTemplates.find(net.mName.CStr()); it != mTemplates.end() && it->second.mHash == hash) {
+        return it->second;
+    }
+
+    LOG_DBG() << "Create plugin templates: name=" << net.mName.CStr();
+
+    PluginTemplates templates {hash, CreateBridgePluginTemplate(net.mBridge), CreateDNSPluginTemplate(net.mDNS),
+        CreateFirewallPluginTemplate(net.mFirewall), CreateBandwidthPluginTemplate(net.mBandwidth)};
+
+    mTemplates[net.mName.CStr()] = templates;
+
+    return templates;
+}
+
 void CNI::WriteCacheEntryToFile(const std::string& cacheEntry, const std::string& cachePath) const
 {
     std::ofstream cacheFile(cachePath);
@@ -356,15 +441,15 @@ void CNI::WriteCacheEntryToFile(const std::string& cacheEntry, const std::string
     cacheFile << cacheEntry;
 }
 
-std::string CNI::ResultToJSON(const Result& result) const
+Poco::JSON::Object::Ptr CNI::ResultToJSON(const Result& result) const
 {
     if (result.mVersion.IsEmpty()) {
-        return std::string {};
+        return nullptr;
     }
 
-    Poco::JSON::Object jsonRoot;
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object();
 
-    jsonRoot.set("cniVersion", result.mVersion.CStr());
+    jsonRoot->set("cniVersion", result.mVersion.CStr());
 
     if (!result.mDNSServers.IsEmpty()) {
         Poco::JSON::Object dnsObj;
@@ -378,7 +463,7 @@ std::string CNI::ResultToJSON(const Result& result) const
 
         dnsObj.set("nameservers", nameserversArray);
 
-        jsonRoot.set("dns", dnsObj);
+        jsonRoot->set("dns", dnsObj);
     }
 
     Poco::JSON::Array interfacesArray;
@@ -398,7 +483,7 @@ std::string CNI::ResultToJSON(const Result& result) const
         }
     }
 
-    jsonRoot.set("interfaces", interfacesArray);
+    jsonRoot->set("interfaces", interfacesArray);
 
     Poco::JSON::Array ipsArray;
 
@@ -415,7 +500,7 @@ std::string CNI::ResultToJSON(const Result& result) const
         }
     }
 
-    jsonRoot.set("ips", ipsArray);
+    jsonRoot->set("ips", ipsArray);
 
     Poco::JSON::Array routesArray;
 
@@ -433,35 +518,32 @@ std::string CNI::ResultToJSON(const Result& result) const
         }
     }
 
-    jsonRoot.set("routes", routesArray);
-
-    std::ostringstream oss;
+    jsonRoot->set("routes", routesArray);
 
-    jsonRoot.stringify(oss);
-
-    return oss.str();
+    return jsonRoot;
 }
 
-std::string CNI::ExecuteBridgePlugin(const NetworkConfigList& net, const std::string& prevResult,
-    const std::string& args, std::vector<std::string>& plugins)
+Poco::JSON::Object::Ptr CNI::ExecuteBridgePlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+    const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins)
 {
     if (net.mBridge.mType.IsEmpty()) {
-        return std::string {};
+        return nullptr;
     }
 
     LOG_DBG() << "Execute bridge plugin: name=" << net.mName.CStr();
 
-    auto bridgeConfig = BridgeConfigToJSON(net, prevResult, plugins);
+    auto bridgeConfig = BridgeConfigToJSON(net, templates.mBridge, prevResult, plugins);
     auto pluginPath   = std::filesystem::path(cBinaryPluginDir) / net.mBridge.mType.CStr();
 
     auto [result, err] = mExec->ExecPlugin(bridgeConfig, pluginPath, args);
     AOS_ERROR_CHECK_AND_THROW(err, "failed to execute bridge plugin");
 
-    return result;
+    return ParsePluginResult(result);
 }
 
-std::string CNI::ExecuteDNSPlugin(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-    const std::string& args, std::vector<std::string>& plugins)
+Poco::JSON::Object::Ptr CNI::ExecuteDNSPlugin(const NetworkConfigList& net, const RuntimeConf& rt,
+    const PluginTemplates& templates, const Poco::JSON::Object::Ptr& prevResult, const std::string& args,
+    Poco::JSON::Array& plugins)
 {
     if (net.mDNS.mType.IsEmpty()) {
         return prevResult;
@@ -469,17 +551,17 @@ std::string CNI::ExecuteDNSPlugin(const NetworkConfigList& net, const RuntimeCon
 
     LOG_DBG() << "Execute DNS plugin: name=" << net.mName.CStr();
 
-    auto dnsConfig  = DNSConfigToJSON(net, rt, prevResult, plugins);
+    auto dnsConfig  = DNSConfigToJSON(net, rt, templates.mDNS, prevResult, plugins);
     auto pluginPath = std::filesystem::path(cBinaryPluginDir) / net.mDNS.mType.CStr();
 
     auto [result, err] = mExec->ExecPlugin(dnsConfig, pluginPath, args);
     AOS_ERROR_CHECK_AND_THROW(err, "failed to execute DNS plugin");
 
-    return result;
+    return ParsePluginResult(result);
 }
 
-std::string CNI::ExecuteFirewallPlugin(const NetworkConfigList& net, const std::string& prevResult,
-    const std::string& args, std::vector<std::string>& plugins)
+Poco::JSON::Object::Ptr CNI::ExecuteFirewallPlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+    const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins)
 {
     if (net.mFirewall.mType.IsEmpty()) {
         return prevResult;
@@ -487,46 +569,38 @@ std::string CNI::ExecuteFirewallPlugin(const NetworkConfigList& net, const std::
 
     LOG_DBG() << "Execute firewall plugin: name=" << net.mName.CStr();
 
-    auto firewallConfig = FirewallConfigToJSON(net, prevResult, plugins);
+    auto firewallConfig = FirewallConfigToJSON(net, templates.mFirewall, prevResult, plugins);
     auto pluginPath     = std::filesystem::path(cBinaryPluginDir) / net.mFirewall.mType.CStr();
 
     auto [result, err] = mExec->ExecPlugin(firewallConfig, pluginPath, args);
     AOS_ERROR_CHECK_AND_THROW(err, "failed to execute firewall plugin");
 
-    return result;
+    return ParsePluginResult(result);
 }
 
-std::string CNI::CreateBridgePluginConfig(const BridgePluginConf& bridge) const
+Poco::JSON::Object::Ptr CNI::CreateBridgePluginTemplate(const BridgePluginConf& bridge) const
 {
-    Poco::JSON::Object jsonRoot;
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object();
 
-    jsonRoot.set("type", bridge.mType.CStr());
-    jsonRoot.set("bridge", bridge.mBridge.CStr());
-    jsonRoot.set("isGateway", bridge.mIsGateway);
-    jsonRoot.set("ipMasq", bridge.mIPMasq);
-    jsonRoot.set("hairpinMode", bridge.mHairpinMode);
+    jsonRoot->set("type", bridge.mType.CStr());
+    jsonRoot->set("bridge", bridge.mBridge.CStr());
+    jsonRoot->set("isGateway", bridge.mIsGateway);
+    jsonRoot->set("ipMasq", bridge.mIPMasq);
+    jsonRoot->set("hairpinMode", bridge.mHairpinMode);
 
-    Poco::JSON::Object ipamObj;
+    Poco::JSON::Object::Ptr ipamObj = new Poco::JSON::Object();
 
-    ipamObj.set("type", bridge.mIPAM.mType.CStr());
-    ipamObj.set("Name", bridge.mIPAM.mName.CStr());
-    ipamObj.set("dataDir", bridge.mIPAM.mDataDir.CStr());
+    ipamObj->set("type", bridge.mIPAM.mType.CStr());
+    ipamObj->set("Name", bridge.mIPAM.mName.CStr());
+    ipamObj->set("dataDir", bridge.mIPAM.mDataDir.CStr());
 
     const auto& range = bridge.mIPAM.mRange;
     if (!range.mSubnet.IsEmpty()) {
-        ipamObj.set("subnet", range.mSubnet.CStr());
-    }
-
-    if (!range.mRangeStart.IsEmpty()) {
-        ipamObj.set("rangeStart", range.mRangeStart.CStr());
-    }
-
-    if (!range.mRangeEnd.IsEmpty()) {
-        ipamObj.set("rangeEnd", range.mRangeEnd.CStr());
+        ipamObj->set("subnet", range.mSubnet.CStr());
     }
 
     if (!range.mGateway.IsEmpty()) {
-        ipamObj.set("gateway", range.mGateway.CStr());
+        ipamObj->set("gateway", range.mGateway.CStr());
     }
 
     Poco::JSON::Array routesArray;
@@ -545,36 +619,71 @@ std::string CNI::CreateBridgePluginConfig(const BridgePluginConf& bridge) const
     }
 
     if (!routesArray.empty()) {
-        ipamObj.set("routes", routesArray);
+        ipamObj->set("routes", routesArray);
     }
 
-    jsonRoot.set("ipam", ipamObj);
+    jsonRoot->set("ipam", ipamObj);
 
-    std::ostringstream oss;
+    return jsonRoot;
+}
 
-    jsonRoot.stringify(oss);
+Poco::JSON::Object::Ptr CNI::CreateBridgePluginConfig(
+    const BridgePluginConf& bridge, const Poco::JSON::Object::Ptr& pluginTemplate) const
+{
+    const auto& range = bridge.mIPAM.mRange;
 
-    return oss.str();
+    if (range.mRangeStart.IsEmpty() && range.mRangeEnd.IsEmpty()) {
+        return pluginTemplate;
+    }
+
+    // Template is shared between instances, so changed objects are copied
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object(*pluginTemplate);
+    Poco::JSON::Object::Ptr ipamObj  = new Poco::JSON::Object(*pluginTemplate->getObject("ipam"));
+
+    if (!range.mRangeStart.IsEmpty()) {
+        ipamObj->set("rangeStart", range.mRangeStart.CStr());
+    }
+
+    if (!range.mRangeEnd.IsEmpty()) {
+        ipamObj->set("rangeEnd", range.mRangeEnd.CStr());
+    }
+
+    jsonRoot->set("ipam", ipamObj);
+
+    return jsonRoot;
 }
 
-std::string CNI::BridgeConfigToJSON(
-    const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins)
+std::string CNI::BridgeConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+    const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins)
 {
-    auto pluginConfig = CreateBridgePluginConfig(net.mBridge);
+    auto pluginConfig = CreateBridgePluginConfig(net.mBridge, pluginTemplate);
 
-    plugins.push_back(pluginConfig);
+    plugins.add(pluginConfig);
 
-    return AddCNIData(pluginConfig, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+    Poco::JSON::Object payload(*pluginConfig);
+
+    AddCNIData(payload, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+
+    return Stringify(payload);
 }
 
-std::string CNI::CreateFirewallPluginConfig(const FirewallPluginConf& firewall) const
+Poco::JSON::Object::Ptr CNI::CreateFirewallPluginTemplate(const FirewallPluginConf& firewall) const
 {
-    Poco::JSON::Object jsonRoot;
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object();
 
-    jsonRoot.set("type", firewall.mType.CStr());
-    jsonRoot.set("uuid", firewall.mUUID.CStr());
-    jsonRoot.set("iptablesAdminChainName", firewall.mIptablesAdminChainName.CStr());
-    jsonRoot.set("allowPublicConnections", firewall.mAllowPublicConnections);
+    jsonRoot->set("type", firewall.mType.CStr());
+    jsonRoot->set("allowPublicConnections", firewall.mAllowPublicConnections);
+
+    return jsonRoot;
+}
+
+Poco::JSON::Object::Ptr CNI::CreateFirewallPluginConfig(
+    const FirewallPluginConf& firewall, const Poco::JSON::Object::Ptr& pluginTemplate) const
+{
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object(*pluginTemplate);
+
+    jsonRoot->set("uuid", firewall.mUUID.CStr());
+    jsonRoot->set("iptablesAdminChainName", firewall.mIptablesAdminChainName.CStr());
 
     Poco::JSON::Array inputAccessArray;
 
@@ -592,7 +701,7 @@ std::string CNI::CreateFirewallPluginConfig(const FirewallPluginConf& firewall)
     }
 
     if (!inputAccessArray.empty()) {
-        jsonRoot.set("inputAccess", inputAccessArray);
+        jsonRoot->set("inputAccess", inputAccessArray);
     }
 
     Poco::JSON::Array outputAccessArray;
@@ -620,81 +729,90 @@ std::string CNI::CreateFirewallPluginConfig(const FirewallPluginConf& firewall)
     }
 
     if (!outputAccessArray.empty()) {
-        jsonRoot.set("outputAccess", outputAccessArray);
+        jsonRoot->set("outputAccess", outputAccessArray);
     }
 
-    std::ostringstream oss;
-
-    jsonRoot.stringify(oss);
-
-    return oss.str();
+    return jsonRoot;
 }
 
-std::string CNI::FirewallConfigToJSON(
-    const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins)
+std::string CNI::FirewallConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+    const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins)
 {
-    auto pluginConfig = CreateFirewallPluginConfig(net.mFirewall);
+    auto pluginConfig = CreateFirewallPluginConfig(net.mFirewall, pluginTemplate);
+
+    plugins.add(pluginConfig);
 
-    plugins.push_back(pluginConfig);
+    Poco::JSON::Object payload(*pluginConfig);
 
-    return AddCNIData(pluginConfig, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+    AddCNIData(payload, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+
+    return Stringify(payload);
 }
 
-std::string CNI::CreateBandwidthPluginConfig(const BandwidthNetConf& bandwidth) const
+Poco::JSON::Object::Ptr CNI::CreateBandwidthPluginTemplate(const BandwidthNetConf& bandwidth) const
 {
-    Poco::JSON::Object jsonRoot;
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object();
 
-    jsonRoot.set("type", bandwidth.mType.CStr());
-    jsonRoot.set("ingressRate", bandwidth.mIngressRate);
-    jsonRoot.set("ingressBurst", bandwidth.mIngressBurst);
-    jsonRoot.set("egressRate", bandwidth.mEgressRate);
-    jsonRoot.set("egressBurst", bandwidth.mEgressBurst);
+    jsonRoot->set("type", bandwidth.mType.CStr());
 
-    std::ostringstream oss;
+    return jsonRoot;
+}
 
-    jsonRoot.stringify(oss);
+Poco::JSON::Object::Ptr CNI::CreateBandwidthPluginConfig(
+    const BandwidthNetConf& bandwidth, const Poco::JSON::Object::Ptr& pluginTemplate) const
+{
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object(*pluginTemplate);
 
-    return oss.str();
+    jsonRoot->set("ingressRate", bandwidth.mIngressRate);
+    jsonRoot->set("ingressBurst", bandwidth.mIngressBurst);
+    jsonRoot->set("egressRate", bandwidth.mEgressRate);
+    jsonRoot->set("egressBurst", bandwidth.mEgressBurst);
+
+    return jsonRoot;
 }
 
-std::string CNI::BandwidthConfigToJSON(
-    const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins)
+std::string CNI::BandwidthConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+    const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins)
 {
-    auto pluginConfig = CreateBandwidthPluginConfig(net.mBandwidth);
+    auto pluginConfig = CreateBandwidthPluginConfig(net.mBandwidth, pluginTemplate);
+
+    plugins.add(pluginConfig);
 
-    plugins.push_back(pluginConfig);
+    Poco::JSON::Object payload(*pluginConfig);
 
-    return AddCNIData(pluginConfig, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+    AddCNIData(payload, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+
+    return Stringify(payload);
 }
 
-std::string CNI::ExecuteBandwidthPlugin(const NetworkConfigList& net, const std::string& prevResult,
-    const std::string& args, std::vector<std::string>& plugins)
+Poco::JSON::Object::Ptr CNI::ExecuteBandwidthPlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+    const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins)
 {
     if (net.mBandwidth.mType.IsEmpty()) {
         return prevResult;
     }
 
-    auto bandwidthConfig = BandwidthConfigToJSON(net, prevResult, plugins);
+    auto bandwidthConfig = BandwidthConfigToJSON(net, templates.mBandwidth, prevResult, plugins);
     auto pluginPath      = std::string(cBinaryPluginDir) + "/" + net.mBandwidth.mType.CStr();
 
     auto [result, err] = mExec->ExecPlugin(bandwidthConfig, pluginPath, args);
     AOS_ERROR_CHECK_AND_THROW(err, "failed to execute bandwidth plugin");
 
-    return result;
+    return ParsePluginResult(result);
 }
 
-std::string CNI::CreateDNSPluginConfig(const DNSPluginConf& dns) const
+Poco::JSON::Object::Ptr CNI::CreateDNSPluginTemplate(const DNSPluginConf& dns) const
 {
-    Poco::JSON::Object jsonRoot;
+    Poco::JSON::Object::Ptr jsonRoot = new Poco::JSON::Object();
 
-    jsonRoot.set("type", dns.mType.CStr());
-    jsonRoot.set("multiDomain", dns.mMultiDomain);
-    jsonRoot.set("domainName", dns.mDomainName.CStr());
+    jsonRoot->set("type", dns.mType.CStr());
+    jsonRoot->set("multiDomain", dns.mMultiDomain);
+    jsonRoot->set("domainName", dns.mDomainName.CStr());
 
     Poco::JSON::Object capabilitiesObj;
 
     capabilitiesObj.set("aliases", dns.mCapabilities.mAliases);
-    jsonRoot.set("capabilities", capabilitiesObj);
+    jsonRoot->set("capabilities", capabilitiesObj);
 
     Poco::JSON::Array remoteServersArray;
 
@@ -704,27 +822,13 @@ std::string CNI::CreateDNSPluginConfig(const DNSPluginConf& dns) const
         }
     }
 
-    jsonRoot.set("remoteServers", remoteServersArray);
-
-    std::ostringstream oss;
-
-    jsonRoot.stringify(oss);
+    jsonRoot->set("remoteServers", remoteServersArray);
 
-    return oss.str();
+    return jsonRoot;
 }
 
-std::string CNI::AddDNSRuntimeConfig(
-    const std::string& pluginConfig, const std::string& name, const RuntimeConf& rt) const
+void CNI::AddDNSRuntimeConfig(Poco::JSON::Object& pluginConfig, const std::string& name, const RuntimeConf& rt) const
 {
-    if (rt.mCapabilityArgs.mHost.IsEmpty()) {
-        return pluginConfig;
-    }
-
-    auto [json, err] = common::utils::ParseJson(pluginConfig);
-    AOS_ERROR_CHECK_AND_THROW(err, "failed to parse plugin config");
-
-    auto jsonRoot = json.extract<Poco::JSON::Object::Ptr>();
-
     Poco::JSON::Object runtimeConfig;
     Poco::JSON::Object aliases;
     Poco::JSON::Array  aliasesArray;
@@ -738,50 +842,37 @@ std::string CNI::AddDNSRuntimeConfig(
     if (!aliasesArray.empty()) {
         aliases.set(name, aliasesArray);
         runtimeConfig.set("aliases", aliases);
-        jsonRoot->set("runtimeConfig", runtimeConfig);
+        pluginConfig.set("runtimeConfig", runtimeConfig);
     }
-
-    std::ostringstream oss;
-
-    jsonRoot->stringify(oss);
-
-    return oss.str();
 }
 
-std::string CNI::AddCNIData(const std::string& pluginConfig, const std::string& version, const std::string& name,
-    const std::string& prevResult) const
+void CNI::AddCNIData(Poco::JSON::Object& pluginConfig, const std::string& version, const std::string& name,
+    const Poco::JSON::Object::Ptr& prevResult) const
 {
-    auto [json, err] = common::utils::ParseJson(pluginConfig);
-    AOS_ERROR_CHECK_AND_THROW(err, "failed to parse plugin config");
-
-    auto jsonRoot = json.extract<Poco::JSON::Object::Ptr>();
+    pluginConfig.set("cniVersion", version);
+    pluginConfig.set("name", name);
 
-    jsonRoot->set("cniVersion", version);
-    jsonRoot->set("name", name);
-
-    if (!prevResult.empty()) {
-        Tie(json, err) = common::utils::ParseJson(prevResult);
-        AOS_ERROR_CHECK_AND_THROW(err, "failed to parse previous result");
-
-        jsonRoot->set("prevResult", json.extract<Poco::JSON::Object::Ptr>());
+    if (prevResult) {
+        pluginConfig.set("prevResult", prevResult);
     }
-
-    std::ostringstream oss;
-
-    jsonRoot->stringify(oss);
-
-    return oss.str();
 }
 
-std::string CNI::DNSConfigToJSON(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-    std::vector<std::string>& plugins)
+std::string CNI::DNSConfigToJSON(const NetworkConfigList& net, const RuntimeConf& rt,
+    const Poco::JSON::Object::Ptr& pluginTemplate, const Poco::JSON::Object::Ptr& prevResult,
+    Poco::JSON::Array& plugins)
 {
-    auto pluginConfig = CreateDNSPluginConfig(net.mDNS);
+    // DNS plugin config has no instance fields, so the template is used as is
+    const auto& pluginConfig = pluginTemplate;
+
+    plugins.add(pluginConfig);
 
-    plugins.push_back(pluginConfig);
+    // Cache entry keeps plugin configs without runtime data, so runtime data is added to the payload copy
+    Poco::JSON::Object payload(*pluginConfig);
 
-    auto configWithRuntime = AddDNSRuntimeConfig(pluginConfig, net.mName.CStr(), rt);
-    return AddCNIData(configWithRuntime, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+    AddDNSRuntimeConfig(payload, net.mName.CStr(), rt);
+    AddCNIData(payload, net.mVersion.CStr(), net.mName.CStr(), prevResult);
+
+    return Stringify(payload);
 }
 
 std::string CNI::ArgsAsString(const RuntimeConf& rt, Action action) const
@@ -815,16 +906,25 @@ std::string CNI::ArgsAsString(const RuntimeConf& rt, Action action) const
         [](const std::string& acc, const std::string& env) { return acc.empty() ? env : acc + " " + env; });
 }
 
-void CNI::ParsePrevResult(const std::string& prevResult, Result& result) const
+Poco::JSON::Object::Ptr CNI::ParsePluginResult(const std::string& pluginResult) const
 {
-    if (prevResult.empty()) {
-        return;
+    if (pluginResult.empty()) {
+        return nullptr;
     }
 
-    auto [json, err] = common::utils::ParseJson(prevResult);
-    AOS_ERROR_CHECK_AND_THROW(err, "failed to parse previous result");
+    auto [json, err] = common::utils::ParseJson(pluginResult);
+    AOS_ERROR_CHECK_AND_THROW(err, "failed to parse plugin result");
+
+    return json.extract<Poco::JSON::Object::Ptr>();
+}
+
+void CNI::ParsePrevResult(const Poco::JSON::Object::Ptr& prevResult, Result& result) const
+{
+    if (!prevResult) {
+        return;
+    }
 
-    common::utils::CaseInsensitiveObjectWrapper object(json);
+    common::utils::CaseInsensitiveObjectWrapper object(prevResult);
 
     result.mVersion = object.GetValue<std::string>("cniVersion").c_str();
 
@@ -850,33 +950,15 @@ void CNI::ParsePrevResult(const std::string& prevResult, Result& result) const
     }
 }
 
-std::string CNI::CreatePluginsConfig(const NetworkConfigList& net, const std::vector<std::string>& plugins) const
+std::string CNI::CreatePluginsConfig(const NetworkConfigList& net, const Poco::JSON::Array& plugins) const
 {
     Poco::JSON::Object jsonRoot;
 
     jsonRoot.set("name", net.mName.CStr());
     jsonRoot.set("cniVersion", net.mVersion.CStr());
+    jsonRoot.set("plugins", plugins);
 
-    Poco::JSON::Array pluginsArray;
-
-    for (const auto& pluginConfig : plugins) {
-        if (!pluginConfig.empty()) {
-            auto [json, err] = common::utils::ParseJson(pluginConfig);
-            AOS_ERROR_CHECK_AND_THROW(err, "failed to parse plugin config");
-
-            auto jsonObject = json.extract<Poco::JSON::Object::Ptr>();
-
-            pluginsArray.add(jsonObject);
-        }
-    }
-
-    jsonRoot.set("plugins", pluginsArray);
-
-    std::ostringstream oss;
-
-    jsonRoot.stringify(oss);
-
-    return oss.str();
+    return Stringify(jsonRoot);
 }
 
 Poco::JSON::Array CNI::CreateCNIArgsArray(const RuntimeConf& rt) const
@@ -919,8 +1001,8 @@ Poco::JSON::Object CNI::CreateCapabilityArgsObject(const RuntimeConf& rt, const
     return capabilityArgs;
 }
 
-std::string CNI::CreateCacheEntry(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-    const std::vector<std::string>& plugins) const
+std::string CNI::CreateCacheEntry(const NetworkConfigList& net, const RuntimeConf& rt,
+    const Poco::JSON::Object::Ptr& prevResult, const Poco::JSON::Array& plugins) const
 {
     Poco::JSON::Object cacheEntry;
 
@@ -939,18 +1021,11 @@ std::string CNI::CreateCacheEntry(const NetworkConfigList& net, const RuntimeCon
     cacheEntry.set("cniArgs", CreateCNIArgsArray(rt));
     cacheEntry.set("capabilityArgs", CreateCapabilityArgsObject(rt, net.mName.CStr()));
 
-    if (!prevResult.empty()) {
-        auto [json, err] = common::utils::ParseJson(prevResult);
-        AOS_ERROR_CHECK_AND_THROW(err, "failed to parse previous result");
-
-        cacheEntry.set("result", json.extract<Poco::JSON::Object::Ptr>());
+    if (prevResult) {
+        cacheEntry.set("result", prevResult);
     }
 
-    std::ostringstream oss;
-
-    cacheEntry.stringify(oss);
-
-    return oss.str();
+    return Stringify(cacheEntry);
 }
 
 } // namespace aos::sm::cni
@@ -7,6 +7,7 @@
 #ifndef CNI_HPP_
 #define CNI_HPP_
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -93,51 +94,82 @@ private:
 
     static constexpr auto cBinaryPluginDir = "/opt/cni/bin";
 
-    std::string ExecuteBridgePlugin(const NetworkConfigList& net, const std::string& prevResult,
-        const std::string& args, std::vector<std::string>& plugins);
-    std::string ExecuteFirewallPlugin(const NetworkConfigList& net, const std::string& prevResult,
-        const std::string& args, std::vector<std::string>& plugins);
-    std::string ExecuteBandwidthPlugin(const NetworkConfigList& net, const std::string& prevResult,
-        const std::string& args, std::vector<std::string>& plugins);
-    std::string ExecuteDNSPlugin(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-        const std::string& args, std::vector<std::string>& plugins);
+    // Instance independent parts of network plugin configs
+    struct PluginTemplates {
+        size_t                  mHash {};
+        Poco::JSON::Object::Ptr mBridge;
+        Poco::JSON::Object::Ptr mDNS;
+        Poco::JSON::Object::Ptr mFirewall;
+        Poco::JSON::Object::Ptr mBandwidth;
+    };
+
+    PluginTemplates GetPluginTemplates(const NetworkConfigList& net);
+
+    Poco::JSON::Object::Ptr ExecuteBridgePlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+        const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins);
+    Poco::JSON::Object::Ptr ExecuteFirewallPlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+        const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins);
+    Poco::JSON::Object::Ptr ExecuteBandwidthPlugin(const NetworkConfigList& net, const PluginTemplates& templates,
+        const Poco::JSON::Object::Ptr& prevResult, const std::string& args, Poco::JSON::Array& plugins);
+    Poco::JSON::Object::Ptr ExecuteDNSPlugin(const NetworkConfigList& net, const RuntimeConf& rt,
+        const PluginTemplates& templates, const Poco::JSON::Object::Ptr& prevResult, const std::string& args,
+        Poco::JSON::Array& plugins);
+
     std::string ArgsAsString(const RuntimeConf& rt, Action action) const;
 
-    std::string CreateBridgePluginConfig(const BridgePluginConf& bridge) const;
-    std::string BridgeConfigToJSON(
-        const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins);
+    Poco::JSON::Object::Ptr CreateBridgePluginTemplate(const BridgePluginConf& bridge) const;
+
+    Poco::JSON::Object::Ptr CreateBridgePluginConfig(
+        const BridgePluginConf& bridge, const Poco::JSON::Object::Ptr& pluginTemplate) const;
+
+    std::string BridgeConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+        const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins);
+
+    Poco::JSON::Object::Ptr ParsePluginResult(const std::string& pluginResult) const;
+    void                    ParsePrevResult(const Poco::JSON::Object::Ptr& prevResult, Result& result) const;
 
-    void ParsePrevResult(const std::string& prevResult, Result& result) const;
+    Poco::JSON::Object::Ptr CreateDNSPluginTemplate(const DNSPluginConf& dns) const;
 
-    std::string CreateDNSPluginConfig(const DNSPluginConf& dns) const;
-    std::string DNSConfigToJSON(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-        std::vector<std::string>& plugins);
-    std::string AddDNSRuntimeConfig(
-        const std::string& pluginConfig, const std::string& name, const RuntimeConf& rt) const;
+    std::string DNSConfigToJSON(const NetworkConfigList& net, const RuntimeConf& rt,
+        const Poco::JSON::Object::Ptr& pluginTemplate, const Poco::JSON::Object::Ptr& prevResult,
+        Poco::JSON::Array& plugins);
 
-    std::string AddCNIData(const std::string& pluginConfig, const std::string& version, const std::string& name,
-        const std::string& prevResult) const;
+    void AddDNSRuntimeConfig(Poco::JSON::Object& pluginConfig, const std::string& name, const RuntimeConf& rt) const;
 
-    std::string CreateFirewallPluginConfig(const FirewallPluginConf& firewall) const;
-    std::string FirewallConfigToJSON(
-        const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins);
+    void AddCNIData(Poco::JSON::Object& pluginConfig, const std::string& version, const std::string& name,
+        const Poco::JSON::Object::Ptr& prevResult) const;
 
-    std::string CreateBandwidthPluginConfig(const BandwidthNetConf& bandwidth) const;
-    std::string BandwidthConfigToJSON(
-        const NetworkConfigList& net, const std::string& prevResult, std::vector<std::string>& plugins);
+    Poco::JSON::Object::Ptr CreateFirewallPluginTemplate(const FirewallPluginConf& firewall) const;
 
-    std::string        CreatePluginsConfig(const NetworkConfigList& net, const std::vector<std::string>& plugins) const;
+    Poco::JSON::Object::Ptr CreateFirewallPluginConfig(
+        const FirewallPluginConf& firewall, const Poco::JSON::Object::Ptr& pluginTemplate) const;
+
+    std::string FirewallConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+        const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins);
+
+    Poco::JSON::Object::Ptr CreateBandwidthPluginTemplate(const BandwidthNetConf& bandwidth) const;
+
+    Poco::JSON::Object::Ptr CreateBandwidthPluginConfig(
+        const BandwidthNetConf& bandwidth, const Poco::JSON::Object::Ptr& pluginTemplate) const;
+
+    std::string BandwidthConfigToJSON(const NetworkConfigList& net, const Poco::JSON::Object::Ptr& pluginTemplate,
+        const Poco::JSON::Object::Ptr& prevResult, Poco::JSON::Array& plugins);
+
+    std::string        CreatePluginsConfig(const NetworkConfigList& net, const Poco::JSON::Array& plugins) const;
     Poco::JSON::Array  CreateCNIArgsArray(const RuntimeConf& rt) const;
     Poco::JSON::Object CreateCapabilityArgsObject(const RuntimeConf& rt, const std::string& networkName) const;
-    std::string CreateCacheEntry(const NetworkConfigList& net, const RuntimeConf& rt, const std::string& prevResult,
-        const std::vector<std::string>& plugins) const;
+
+    std::string CreateCacheEntry(const NetworkConfigList& net, const RuntimeConf& rt,
+        const Poco::JSON::Object::Ptr& prevResult, const Poco::JSON::Array& plugins) const;
 
     void WriteCacheEntryToFile(const std::string& cacheEntry, const std::string& cachePath) const;
 
-    std::string ResultToJSON(const Result& result) const;
+    Poco::JSON::Object::Ptr ResultToJSON(const Result& result) const;
 
-    std::string mConfigDir;
-    ExecItf*    mExec {};
+    std::string                                      mConfigDir;
+    ExecItf*                                         mExec {};
+    std::mutex                                       mTemplatesMutex;
+    std::unordered_map<std::string, PluginTemplates> mTemplates;
 };
 } // namespace aos::sm::cni
 
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CNI_CONFIG_HPP_
+#define CNI_CONFIG_HPP_
+
+#include <string>
+#include <vector>
+
+namespace aos::sm::cni {
+
+/***
+ * CNI configuration.
+ */
+struct CNIConfig {
+    std::vector<std::string> mNativePlugins; // plugin types executed inside SM, only bandwidth is implemented
+};
+
+} // namespace aos::sm::cni
+
+#endif
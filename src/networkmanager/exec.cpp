@@ -4,22 +4,30 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sstream>
 #include <stdexcept>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
-#include <Poco/Exception.h>
-#include <Poco/Pipe.h>
-#include <Poco/PipeStream.h>
-#include <Poco/Process.h>
-
 #include <utils/exception.hpp>
 #include <utils/json.hpp>
 #include <utils/parser.hpp>
 
 #include "exec.hpp"
 
+extern char** environ;
+
 namespace aos::sm::cni {
 
 /***********************************************************************************************************************
@@ -28,20 +36,89 @@ namespace aos::sm::cni {
 
 namespace {
 
-Poco::Process::Env PrepareEnv(const std::string& args)
+constexpr auto cRetryDelay       = std::chrono::milliseconds(10);
+constexpr auto cMaxRetryDelay    = std::chrono::seconds(1);
+constexpr auto cWaitPollInterval = std::chrono::milliseconds(10);
+constexpr auto cMaxRetries       = 10;
+constexpr auto cReadChunkSize    = 4096;
+
+/**
+ * Pair of connected descriptors.
+ */
+class FDPair {
+public:
+    // Plugin stdin is a socket, so writing to the plugin that exited without reading fails with EPIPE instead of
+    // raising SIGPIPE in SM
+    explicit FDPair(bool socket = false)
+    {
+        int  fds[2] = {-1, -1};
+        auto ret    = socket ? socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) : pipe2(fds, O_CLOEXEC);
+
+        if (ret != 0) {
+            AOS_ERROR_THROW(Error(errno), "can't create plugin pipe");
+        }
+
+        mRead  = fds[0];
+        mWrite = fds[1];
+    }
+
+    FDPair(const FDPair&)            = delete;
+    FDPair& operator=(const FDPair&) = delete;
+
+    ~FDPair()
+    {
+        Close(mRead);
+        Close(mWrite);
+    }
+
+    static void Close(int& fd)
+    {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    int mRead  = -1;
+    int mWrite = -1;
+};
+
+struct PluginResult {
+    int         mSpawnErr = 0;
+    int         mExitCode = 0;
+    std::string mOutput;
+    std::string mError;
+};
+
+std::vector<std::string> PrepareEnv(const std::string& args)
 {
-    Poco::Process::Env env;
+    std::map<std::string, std::string> vars;
+
+    for (auto env = environ; env != nullptr && *env != nullptr; ++env) {
+        std::string var(*env);
+
+        if (auto pos = var.find('='); pos != std::string::npos) {
+            vars[var.substr(0, pos)] = var.substr(pos + 1);
+        }
+    }
+
     std::istringstream iss(args);
     std::string        token;
 
     while (std::getline(iss, token, ' ')) {
         if (!token.empty()) {
             if (auto keyValue = aos::common::utils::ParseKeyValue(token, true, "="); keyValue.has_value()) {
-                env[keyValue->mKey] = keyValue->mValue;
+                vars[keyValue->mKey] = keyValue->mValue;
             }
         }
     }
 
+    std::vector<std::string> env;
+
+    for (const auto& [key, value] : vars) {
+        env.push_back(key + "=" + value);
+    }
+
     return env;
 }
 
@@ -69,47 +146,205 @@ std::string PluginErr(
     return "plugin failed: " + stdoutContent;
 }
 
-std::string LaunchPlugin(
-    const std::string& payload, const std::string& pluginPath, Poco::Process::Env& env, int maxRetries = 5)
+int SpawnPlugin(const std::string& pluginPath, char* const envp[], const FDPair& in, const FDPair& out,
+    const FDPair& err, pid_t& pid)
+{
+    posix_spawn_file_actions_t actions;
+
+    if (auto ret = posix_spawn_file_actions_init(&actions); ret != 0) {
+        return ret;
+    }
+
+    // Dup2 clears close-on-exec flag, all other descriptors are closed on exec
+    auto ret = posix_spawn_file_actions_adddup2(&actions, in.mRead, STDIN_FILENO);
+
+    if (ret == 0) {
+        ret = posix_spawn_file_actions_adddup2(&actions, out.mWrite, STDOUT_FILENO);
+    }
+
+    if (ret == 0) {
+        ret = posix_spawn_file_actions_adddup2(&actions, err.mWrite, STDERR_FILENO);
+    }
+
+    char* const argv[] = {const_cast<char*>(pluginPath.c_str()), nullptr};
+
+    // posix_spawn uses vfork semantics, so SM address space is not copied, exec errors are returned directly
+    if (ret == 0) {
+        ret = posix_spawn(&pid, pluginPath.c_str(), &actions, nullptr, argv, envp);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    return ret;
+}
+
+void KillPlugin(pid_t pid)
 {
-    Poco::Pipe          inPipe, outPipe, errPipe;
-    Poco::Process::Args processArgs;
-    std::string         output, error;
+    kill(pid, SIGKILL);
+
+    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) { }
+}
+
+void ReadPipe(const pollfd& pfd, int& fd, std::string& data)
+{
+    if (pfd.revents == 0) {
+        return;
+    }
+
+    const auto size = data.size();
 
-    for (int i = 1; i <= maxRetries; ++i) {
-        Poco::ProcessHandle ph = Poco::Process::launch(pluginPath, processArgs, &inPipe, &outPipe, &errPipe, env);
+    data.resize(size + cReadChunkSize);
 
-        Poco::PipeOutputStream ostr(inPipe);
-        ostr << payload;
-        ostr.close();
-        inPipe.close();
+    auto ret = read(fd, &data[size], cReadChunkSize);
 
-        output.clear();
-        error.clear();
+    data.resize(size + std::max<ssize_t>(ret, 0));
+
+    if (ret == 0 || (ret < 0 && errno != EINTR)) {
+        FDPair::Close(fd);
+    }
+}
+
+void WritePipe(const pollfd& pfd, int& fd, const std::string& data, size_t& written)
+{
+    if (pfd.revents == 0) {
+        return;
+    }
 
-        Poco::PipeInputStream istr(outPipe);
-        std::string           line;
-        while (std::getline(istr, line)) {
-            output += line + "\n";
+    auto ret = send(fd, data.data() + written, data.size() - written, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (ret > 0) {
+        written += ret;
+    }
+
+    if (written == data.size() || (ret < 0 && errno != EAGAIN && errno != EINTR)) {
+        FDPair::Close(fd);
+    }
+}
+
+int WaitPlugin(pid_t pid, std::chrono::steady_clock::time_point deadline)
+{
+    int status = 0;
+
+    while (true) {
+        auto ret = waitpid(pid, &status, WNOHANG);
+        if (ret == pid) {
+            break;
         }
 
-        Poco::PipeInputStream estr(errPipe);
-        while (std::getline(estr, line)) {
-            error += line + "\n";
+        if (ret < 0 && errno != EINTR) {
+            AOS_ERROR_THROW(Error(errno), "can't wait plugin");
+        }
+
+        // Plugin closed its output but didn't exit yet
+        if (std::chrono::steady_clock::now() >= deadline) {
+            KillPlugin(pid);
+
+            AOS_ERROR_THROW(ErrorEnum::eTimeout, "plugin execution timed out");
+        }
+
+        std::this_thread::sleep_for(cWaitPollInterval);
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+PluginResult RunPlugin(
+    const std::string& payload, const std::string& pluginPath, char* const envp[], std::chrono::milliseconds timeout)
+{
+    PluginResult result;
+    FDPair       in(true), out, err;
+    pid_t        pid = 0;
+
+    if (result.mSpawnErr = SpawnPlugin(pluginPath, envp, in, out, err, pid); result.mSpawnErr != 0) {
+        return result;
+    }
+
+    // Child ends are closed in SM, so EOF is read as soon as the plugin exits
+    FDPair::Close(in.mRead);
+    FDPair::Close(out.mWrite);
+    FDPair::Close(err.mWrite);
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t     written  = 0;
+
+    if (payload.empty()) {
+        FDPair::Close(in.mWrite);
+    }
+
+    // Stdin, stdout and stderr are served together, so plugin blocked on any of them can't deadlock SM
+    while (out.mRead >= 0 || err.mRead >= 0) {
+        const auto remaining
+            = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+
+        if (remaining.count() <= 0) {
+            KillPlugin(pid);
+
+            AOS_ERROR_THROW(ErrorEnum::eTimeout, "plugin execution timed out");
         }
 
-        if (auto exitCode = ph.wait(); exitCode != 0) {
-            if (i < maxRetries && error.find("text file busy") != std::string::npos) {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+        pollfd fds[] = {{in.mWrite, POLLOUT, 0}, {out.mRead, POLLIN, 0}, {err.mRead, POLLIN, 0}};
 
+        if (poll(fds, std::size(fds), remaining.count()) < 0) {
+            if (errno == EINTR) {
                 continue;
             }
 
-            throw std::runtime_error(
-                PluginErr(error, output, "plugin execution failed with exit code " + std::to_string(exitCode)));
+            auto pollErr = errno;
+
+            KillPlugin(pid);
+
+            AOS_ERROR_THROW(Error(pollErr), "can't poll plugin pipes");
         }
 
-        return output;
+        WritePipe(fds[0], in.mWrite, payload, written);
+        ReadPipe(fds[1], out.mRead, result.mOutput);
+        ReadPipe(fds[2], err.mRead, result.mError);
+    }
+
+    FDPair::Close(in.mWrite);
+
+    result.mExitCode = WaitPlugin(pid, deadline);
+
+    return result;
+}
+
+std::string LaunchPlugin(const std::string& payload, const std::string& pluginPath, const std::vector<std::string>& env,
+    std::chrono::milliseconds timeout)
+{
+    std::vector<char*> envp;
+
+    for (const auto& var : env) {
+        envp.push_back(const_cast<char*>(var.c_str()));
+    }
+
+    envp.push_back(nullptr);
+
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(cRetryDelay);
+
+    for (int i = 1; i <= cMaxRetries; ++i) {
+        auto result = RunPlugin(payload, pluginPath, envp.data(), timeout);
+
+        // Plugin binary or a binary it delegates to may still be opened for writing right after the update
+        auto textFileBusy = result.mSpawnErr == ETXTBSY
+            || (result.mExitCode != 0 && result.mError.find("text file busy") != std::string::npos);
+
+        if (textFileBusy && i < cMaxRetries) {
+            std::this_thread::sleep_for(delay);
+
+            delay = std::min<std::chrono::milliseconds>(delay * 2, cMaxRetryDelay);
+
+            continue;
+        }
+
+        if (result.mSpawnErr != 0) {
+            AOS_ERROR_THROW(Error(result.mSpawnErr), "can't spawn plugin");
+        }
+
+        if (result.mExitCode != 0) {
+            throw std::runtime_error(PluginErr(result.mError, result.mOutput,
+                "plugin execution failed with exit code " + std::to_string(result.mExitCode)));
+        }
+
+        return result.mOutput;
     }
 
     throw std::runtime_error("max retries exceeded for plugin execution.");
@@ -125,9 +360,7 @@ RetWithError<std::string> Exec::ExecPlugin(
     const std::string& payload, const std::string& pluginPath, const std::string& args) const
 {
     try {
-        Poco::Process::Env env = PrepareEnv(args);
-
-        return LaunchPlugin(payload, pluginPath, env);
+        return LaunchPlugin(payload, pluginPath, PrepareEnv(args), mTimeout);
     } catch (const std::exception& e) {
         return {"", AOS_ERROR_WRAP(common::utils::ToAosError(e))};
     }
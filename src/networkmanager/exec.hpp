@@ -7,6 +7,7 @@
 #ifndef EXEC_HPP_
 #define EXEC_HPP_
 
+#include <chrono>
 #include <string>
 
 #include <aos/common/tools/error.hpp>
@@ -35,6 +36,21 @@ public:
  */
 class Exec : public ExecItf {
 public:
+    /**
+     * Default plugin execution timeout.
+     */
+    static constexpr auto cDefaultTimeout = std::chrono::seconds(30);
+
+    /**
+     * Constructor.
+     *
+     * @param timeout plugin execution timeout, plugin is killed when it is exceeded.
+     */
+    explicit Exec(std::chrono::milliseconds timeout = cDefaultTimeout)
+        : mTimeout(timeout)
+    {
+    }
+
     /**
      * Executes a plugin.
      *
@@ -45,6 +61,9 @@ public:
      */
     RetWithError<std::string> ExecPlugin(
         const std::string& payload, const std::string& pluginPath, const std::string& args) const override;
+
+private:
+    std::chrono::milliseconds mTimeout;
 };
 
 } // namespace aos::sm::cni
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <filesystem>
+
+#include "logger/logmodule.hpp"
+#include "nativeexec.hpp"
+
+namespace aos::sm::cni {
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+Error NativeExec::Init(ExecItf& fallback, const std::vector<std::string>& nativePlugins)
+{
+    LOG_DBG() << "Init native exec: plugins=" << nativePlugins.size();
+
+    // Plugin enabled without native implementation would silently run its binary
+    for (const auto& type : nativePlugins) {
+        if (mPlugins.find(type) == mPlugins.end()) {
+            LOG_ERR() << "Native plugin is not implemented: type=" << type.c_str();
+
+            return AOS_ERROR_WRAP(Error(ErrorEnum::eNotSupported, "native plugin is not implemented"));
+        }
+    }
+
+    mFallback      = &fallback;
+    mNativePlugins = nativePlugins;
+
+    return ErrorEnum::eNone;
+}
+
+Error NativeExec::RegisterPlugin(const std::string& type, ExecItf& plugin)
+{
+    if (!mPlugins.emplace(type, &plugin).second) {
+        return AOS_ERROR_WRAP(Error(ErrorEnum::eAlreadyExist, "plugin already registered"));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+RetWithError<std::string> NativeExec::ExecPlugin(
+    const std::string& payload, const std::string& pluginPath, const std::string& args) const
+{
+    const auto type = std::filesystem::path(pluginPath).filename().string();
+
+    if (auto it = mPlugins.find(type); it != mPlugins.end()
+        && std::find(mNativePlugins.begin(), mNativePlugins.end(), type) != mNativePlugins.end()) {
+        auto result = it->second->ExecPlugin(payload, pluginPath, args);
+        if (result.mError.IsNone()) {
+            return result;
+        }
+
+        // Native plugin cleans up after failure, so the action is retried by the plugin binary
+        LOG_WRN() << "Native plugin failed, fallback to binary: type=" << type.c_str() << ", err=" << result.mError;
+    }
+
+    return mFallback->ExecPlugin(payload, pluginPath, args);
+}
+
+} // namespace aos::sm::cni
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NATIVEEXEC_HPP_
+#define NATIVEEXEC_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "exec.hpp"
+
+namespace aos::sm::cni {
+
+/**
+ * Executes plugins implemented inside SM and falls back to external plugin binaries for the rest. Only bandwidth plugin
+ * has native implementation for now, other plugin types can't be enabled as native.
+ */
+class NativeExec : public ExecItf {
+public:
+    /**
+     * Initializes native exec. Native plugins should be registered before.
+     *
+     * @param fallback executes external plugin binaries.
+     * @param nativePlugins plugin types to execute natively, each of them should be registered.
+     * @return Error.
+     */
+    Error Init(ExecItf& fallback, const std::vector<std::string>& nativePlugins);
+
+    /**
+     * Registers native plugin implementation.
+     *
+     * @param type plugin type.
+     * @param plugin plugin implementation.
+     * @return Error.
+     */
+    Error RegisterPlugin(const std::string& type, ExecItf& plugin);
+
+    /**
+     * Executes a plugin.
+     *
+     * @param payload Plugin payload.
+     * @param pluginPath Path to the plugin.
+     * @param args Plugin arguments.
+     * @return RetWithError<std::string>.
+     */
+    RetWithError<std::string> ExecPlugin(
+        const std::string& payload, const std::string& pluginPath, const std::string& args) const override;
+
+private:
+    ExecItf*                        mFallback {};
+    std::vector<std::string>        mNativePlugins;
+    std::map<std::string, ExecItf*> mPlugins;
+};
+
+} // namespace aos::sm::cni
+
+#endif // NATIVEEXEC_HPP_
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <utils/exception.hpp>
+
+#include "deviceregistry.hpp"
+#include "logger/logmodule.hpp"
+
+namespace aos::sm::resourcemanager {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto cWatchMask
+    = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+// Busy dirs without hot-plugged devices, they are read on request instead of being watched
+constexpr const char* cUnwatchedDirs[] = {"shm", "mqueue", "pts"};
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+std::string NormalizePath(const std::string& path)
+{
+    auto normalized = fs::path(path).lexically_normal();
+
+    if (!normalized.has_filename() && normalized.has_parent_path() && normalized != normalized.root_path()) {
+        normalized = normalized.parent_path();
+    }
+
+    return normalized.string();
+}
+
+std::optional<oci::LinuxDevice> DeviceFromPath(const fs::path& path)
+{
+    struct stat sb;
+
+    // stat follows symlinks the same way as runtime does for device symlinks
+    if (stat(path.c_str(), &sb) != 0) {
+        return std::nullopt;
+    }
+
+    StaticString<oci::cDeviceTypeLen> type;
+
+    switch (sb.st_mode & S_IFMT) {
+    case S_IFBLK:
+        type = "b";
+        break;
+
+    case S_IFCHR:
+        type = "c";
+        break;
+
+    case S_IFIFO:
+        type = "p";
+        break;
+
+    default:
+        return std::nullopt;
+    }
+
+    return oci::LinuxDevice {
+        path.c_str(), type, major(sb.st_rdev), minor(sb.st_rdev), sb.st_mode & ~S_IFMT, sb.st_uid, sb.st_gid};
+}
+
+bool IsDeviceNode(const oci::LinuxDevice& device)
+{
+    return device.mType == "c" || device.mType == "b";
+}
+
+bool ContainsDeviceOnFS(const fs::path& path)
+{
+    if (auto device = DeviceFromPath(path); device.has_value()) {
+        return IsDeviceNode(*device);
+    }
+
+    std::error_code ec;
+
+    if (!fs::is_directory(path, ec)) {
+        return false;
+    }
+
+    for (auto it = fs::recursive_directory_iterator(path, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (auto device = DeviceFromPath(it->path()); device.has_value() && IsDeviceNode(*device)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CollectDevicesOnFS(const fs::path& path, std::vector<oci::LinuxDevice>& devices)
+{
+    std::error_code ec;
+
+    for (auto it = fs::recursive_directory_iterator(path, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (auto device = DeviceFromPath(it->path()); device.has_value()) {
+            devices.push_back(*device);
+        }
+    }
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Public
+ **********************************************************************************************************************/
+
+DeviceRegistry::~DeviceRegistry()
+{
+    Stop();
+
+    if (mInotifyFD != -1) {
+        close(mInotifyFD);
+    }
+
+    if (mStopFD != -1) {
+        close(mStopFD);
+    }
+}
+
+Error DeviceRegistry::Init(const std::string& devicesDir)
+{
+    LOG_DBG() << "Init device registry: devicesDir=" << devicesDir.c_str();
+
+    std::lock_guard lock {mMutex};
+
+    mDevicesDir = NormalizePath(devicesDir);
+
+    if (mInotifyFD == -1) {
+        if (mInotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); mInotifyFD == -1) {
+            return AOS_ERROR_WRAP(Error(errno, "can't init inotify"));
+        }
+    }
+
+    if (mStopFD == -1) {
+        if (mStopFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); mStopFD == -1) {
+            return AOS_ERROR_WRAP(Error(errno, "can't create event fd"));
+        }
+    }
+
+    try {
+        Scan();
+    } catch (const std::exception& e) {
+        return AOS_ERROR_WRAP(common::utils::ToAosError(e));
+    }
+
+    return ErrorEnum::eNone;
+}
+
+Error DeviceRegistry::Start()
+{
+    LOG_DBG() << "Start device registry";
+
+    if (mWatchThread.joinable()) {
+        return AOS_ERROR_WRAP(ErrorEnum::eWrongState);
+    }
+
+    mWatchThread = std::thread(&DeviceRegistry::WatchDevices, this);
+
+    return ErrorEnum::eNone;
+}
+
+Error DeviceRegistry::Stop()
+{
+    if (!mWatchThread.joinable()) {
+        return ErrorEnum::eNone;
+    }
+
+    LOG_DBG() << "Stop device registry";
+
+    uint64_t value = 1;
+
+    if (write(mStopFD, &value, sizeof(value)) == -1) {
+        return AOS_ERROR_WRAP(Error(errno, "can't notify device registry thread"));
+    }
+
+    mWatchThread.join();
+
+    std::ignore = read(mStopFD, &value, sizeof(value));
+
+    return ErrorEnum::eNone;
+}
+
+bool DeviceRegistry::HasDevice(const std::string& path) const
+{
+    std::lock_guard lock {mMutex};
+
+    auto normalized = NormalizePath(path);
+
+    if (normalized == mDevicesDir) {
+        return false;
+    }
+
+    return ContainsDevice(normalized, true);
+}
+
+Error DeviceRegistry::GetDevices(const std::string& path, std::vector<oci::LinuxDevice>& devices) const
+{
+    std::lock_guard lock {mMutex};
+
+    return CollectDevices(NormalizePath(path), devices);
+}
+
+/***********************************************************************************************************************
+ * Private
+ **********************************************************************************************************************/
+
+void DeviceRegistry::Scan()
+{
+    for (const auto& [wd, path] : mWatches) {
+        inotify_rm_watch(mInotifyFD, wd);
+    }
+
+    mWatches.clear();
+    mEntries.clear();
+
+    AddEntry(mDevicesDir);
+}
+
+void DeviceRegistry::AddEntry(const std::string& path)
+{
+    struct stat sb;
+
+    if (lstat(path.c_str(), &sb) != 0) {
+        return;
+    }
+
+    auto& entry = mEntries[path];
+
+    entry = Entry {};
+
+    if (auto parent = fs::path(path).parent_path().string(); path != mDevicesDir) {
+        mEntries[parent].mChildren.insert(path);
+    }
+
+    if (S_ISLNK(sb.st_mode)) {
+        std::error_code ec;
+
+        if (fs::is_directory(path, ec)) {
+            entry.mIsDirSymlink = true;
+
+            return;
+        }
+    }
+
+    if (!S_ISDIR(sb.st_mode)) {
+        entry.mDevice = DeviceFromPath(path);
+
+        return;
+    }
+
+    entry.mIsDir = true;
+
+    if (const auto name = fs::path(path).filename().string(); fs::path(path).parent_path().string() == mDevicesDir
+        && std::find(std::begin(cUnwatchedDirs), std::end(cUnwatchedDirs), name) != std::end(cUnwatchedDirs)) {
+        entry.mIsUnwatched = true;
+
+        return;
+    }
+
+    // Add watch before reading the directory to not miss entries created in between
+    AddWatch(path);
+
+    std::error_code ec;
+
+    for (const auto& item : fs::directory_iterator(path, fs::directory_options::skip_permission_denied, ec)) {
+        AddEntry(item.path().string());
+    }
+}
+
+void DeviceRegistry::RemoveEntry(const std::string& path)
+{
+    auto it = mEntries.find(path);
+    if (it == mEntries.end()) {
+        return;
+    }
+
+    auto children = std::move(it->second.mChildren);
+
+    mEntries.erase(it);
+
+    for (const auto& child : children) {
+        RemoveEntry(child);
+    }
+
+    if (auto parent = mEntries.find(fs::path(path).parent_path().string()); parent != mEntries.end()) {
+        parent->second.mChildren.erase(path);
+    }
+}
+
+bool DeviceRegistry::ContainsDevice(const std::string& path, bool followSymlink) const
+{
+    auto it = mEntries.find(path);
+    if (it == mEntries.end()) {
+        return IsUnderUnwatchedDir(path) && ContainsDeviceOnFS(path);
+    }
+
+    const auto& entry = it->second;
+
+    if (entry.mIsUnwatched) {
+        return ContainsDeviceOnFS(path);
+    }
+
+    if (entry.mIsDirSymlink) {
+        // Symlinks are followed for the requested path only, so symlink loops are not walked
+        if (!followSymlink) {
+            return false;
+        }
+
+        std::error_code ec;
+
+        auto target = fs::read_symlink(path, ec);
+        if (ec) {
+            return false;
+        }
+
+        return ContainsDevice(NormalizePath((fs::path(path).parent_path() / target).string()), false);
+    }
+
+    if (!entry.mIsDir) {
+        return entry.mDevice.has_value() && IsDeviceNode(*entry.mDevice);
+    }
+
+    for (const auto& child : entry.mChildren) {
+        if (ContainsDevice(child, false)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DeviceRegistry::IsUnderUnwatchedDir(const std::string& path) const
+{
+    for (auto parent = fs::path(path).parent_path(); parent.has_relative_path(); parent = parent.parent_path()) {
+        if (auto it = mEntries.find(parent.string()); it != mEntries.end()) {
+            return it->second.mIsUnwatched;
+        }
+    }
+
+    return false;
+}
+
+void DeviceRegistry::AddWatch(const std::string& path)
+{
+    auto wd = inotify_add_watch(mInotifyFD, path.c_str(), cWatchMask);
+    if (wd == -1) {
+        LOG_WRN() << "Can't watch devices dir: path=" << path.c_str() << ", err=" << Error(errno);
+
+        return;
+    }
+
+    mWatches[wd] = path;
+}
+
+Error DeviceRegistry::CollectDevices(const std::string& path, std::vector<oci::LinuxDevice>& devices) const
+{
+    auto it = mEntries.find(path);
+    if (it == mEntries.end() || it->second.mIsDirSymlink) {
+        return ErrorEnum::eNotFound;
+    }
+
+    const auto& entry = it->second;
+
+    if (entry.mIsUnwatched) {
+        CollectDevicesOnFS(path, devices);
+
+        return ErrorEnum::eNone;
+    }
+
+    if (!entry.mIsDir) {
+        if (!entry.mDevice.has_value()) {
+            return ErrorEnum::eNotFound;
+        }
+
+        devices.push_back(*entry.mDevice);
+
+        return ErrorEnum::eNone;
+    }
+
+    for (const auto& child : entry.mChildren) {
+        if (auto err = CollectDevices(child, devices); !err.IsNone()) {
+            return err;
+        }
+    }
+
+    return ErrorEnum::eNone;
+}
+
+void DeviceRegistry::WatchDevices()
+{
+    struct pollfd fds[] = {{mInotifyFD, POLLIN, 0}, {mStopFD, POLLIN, 0}};
+
+    while (true) {
+        if (poll(fds, std::size(fds), -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            LOG_ERR() << "Can't poll devices events: err=" << Error(errno);
+
+            return;
+        }
+
+        if (fds[1].revents != 0) {
+            return;
+        }
+
+        if (fds[0].revents != 0) {
+            HandleEvents();
+        }
+    }
+}
+
+void DeviceRegistry::HandleEvents()
+{
+    alignas(struct inotify_event) char buffer[cEventBufferSize];
+
+    while (true) {
+        auto len = read(mInotifyFD, buffer, sizeof(buffer));
+        if (len <= 0) {
+            return;
+        }
+
+        std::lock_guard lock {mMutex};
+
+        for (auto ptr = buffer; ptr < buffer + len;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(ptr);
+
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                LOG_WRN() << "Devices events queue overflow, rescan devices";
+
+                try {
+                    Scan();
+                } catch (const std::exception& e) {
+                    LOG_ERR() << "Can't rescan devices: err=" << common::utils::ToAosError(e);
+                }
+
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                mWatches.erase(event->wd);
+
+                continue;
+            }
+
+            auto it = mWatches.find(event->wd);
+            if (it == mWatches.end() || event->len == 0) {
+                continue;
+            }
+
+            auto path = (fs::path(it->second) / event->name).string();
+
+            LOG_DBG() << "Device event: path=" << path.c_str() << ", mask=" << event->mask;
+
+            RemoveEntry(path);
+
+            if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_ATTRIB)) {
+                AddEntry(path);
+            }
+        }
+    }
+}
+
+} // namespace aos::sm::resourcemanager
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DEVICEREGISTRY_HPP_
+#define DEVICEREGISTRY_HPP_
+
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <aos/common/ocispec/ocispec.hpp>
+
+namespace aos::sm::resourcemanager {
+
+/**
+ * Host device registry.
+ *
+ * Keeps records of host devices updated on device add/remove using inotify.
+ */
+class DeviceRegistry {
+public:
+    /**
+     * Destructor.
+     */
+    ~DeviceRegistry();
+
+    /**
+     * Initializes device registry and scans devices directory.
+     *
+     * @param devicesDir devices directory.
+     * @return Error.
+     */
+    Error Init(const std::string& devicesDir = cDevicesDirectory);
+
+    /**
+     * Starts watching devices directory.
+     *
+     * @return Error.
+     */
+    Error Start();
+
+    /**
+     * Stops watching devices directory.
+     *
+     * @return Error.
+     */
+    Error Stop();
+
+    /**
+     * Checks if path is a char or block device or a directory containing such devices.
+     *
+     * @param path device path.
+     * @return bool.
+     */
+    bool HasDevice(const std::string& path) const;
+
+    /**
+     * Returns OCI devices for device path. If path is a directory, all devices inside it are returned.
+     *
+     * @param path device path.
+     * @param[out] devices OCI devices.
+     * @return Error: eNotFound if registry can't resolve the path and it should be walked on the file system.
+     */
+    Error GetDevices(const std::string& path, std::vector<oci::LinuxDevice>& devices) const;
+
+private:
+    static constexpr auto cDevicesDirectory = "/dev";
+    static constexpr auto cEventBufferSize  = 4096;
+
+    struct Entry {
+        bool                            mIsDir        = false;
+        bool                            mIsDirSymlink = false;
+        bool                            mIsUnwatched  = false;
+        std::optional<oci::LinuxDevice> mDevice;
+        std::set<std::string>           mChildren;
+    };
+
+    void  Scan();
+    void  AddEntry(const std::string& path);
+    void  RemoveEntry(const std::string& path);
+    bool  ContainsDevice(const std::string& path, bool followSymlink) const;
+    bool  IsUnderUnwatchedDir(const std::string& path) const;
+    void  AddWatch(const std::string& path);
+    Error CollectDevices(const std::string& path, std::vector<oci::LinuxDevice>& devices) const;
+    void  WatchDevices();
+    void  HandleEvents();
+
+    std::string                            mDevicesDir;
+    int                                    mInotifyFD = -1;
+    int                                    mStopFD    = -1;
+    std::unordered_map<int, std::string>   mWatches;
+    std::unordered_map<std::string, Entry> mEntries;
+    mutable std::mutex                     mMutex;
+    std::thread                            mWatchThread;
+};
+
+} // namespace aos::sm::resourcemanager
+
+#endif
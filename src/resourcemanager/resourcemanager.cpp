@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <filesystem>
 #include <fstream>
 
 #include <utils/exception.hpp>
@@ -22,13 +21,11 @@ namespace aos::sm::resourcemanager {
  * Public
  **********************************************************************************************************************/
 
-Error HostDeviceManager::Init()
+Error HostDeviceManager::Init(const DeviceRegistry& deviceRegistry)
 {
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(cDevicesDirectory)) {
-            mDevices.insert(entry.path().string());
-        }
+    mDeviceRegistry = &deviceRegistry;
 
+    try {
         if (auto err = ParseGroups(); !err.IsNone()) {
             return AOS_ERROR_WRAP(err);
         }
@@ -51,7 +48,7 @@ Error HostDeviceManager::CheckDevice(const String& device) const
         return AOS_ERROR_WRAP(ErrorEnum::eFailed);
     }
 
-    if (mDevices.find(devices[0].CStr()) == mDevices.end()) {
+    if (!mDeviceRegistry->HasDevice(devices[0].CStr())) {
         return AOS_ERROR_WRAP(ErrorEnum::eNotFound);
     }
 
@@ -13,6 +13,8 @@
 
 #include <aos/sm/resourcemanager.hpp>
 
+#include "deviceregistry.hpp"
+
 namespace aos::sm::resourcemanager {
 
 /**
@@ -23,9 +25,10 @@ public:
     /**
      * Initializes host device manager object.
      *
+     * @param deviceRegistry device registry.
      * @return Error.
      */
-    Error Init();
+    Error Init(const DeviceRegistry& deviceRegistry);
 
     /**
      * Checks if device exists.
@@ -44,12 +47,11 @@ public:
     Error CheckGroup(const String& group) const override;
 
 private:
-    static constexpr auto cDevicesDirectory = "/dev/";
-    static constexpr auto cGroupsFile       = "/etc/group";
+    static constexpr auto cGroupsFile = "/etc/group";
 
     Error ParseGroups();
 
-    std::set<std::string> mDevices;
+    const DeviceRegistry* mDeviceRegistry = nullptr;
     std::set<std::string> mGroups;
 };
 
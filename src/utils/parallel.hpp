@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace aos::sm::utils {
+
+/**
+ * Calls func for each index in [0, count) on up to maxThreads threads. The calling thread is used as one of them.
+ *
+ * @param count number of items.
+ * @param maxThreads max number of threads.
+ * @param func function called with item index, should not throw.
+ */
+template <typename F>
+void ParallelFor(size_t count, size_t maxThreads, F func)
+{
+    std::atomic_size_t next {0};
+
+    auto worker = [&]() {
+        for (auto i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+
+    auto numThreads = std::min(count, std::max<size_t>(maxThreads, 1));
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < numThreads; i++) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace aos::sm::utils
+
+#endif
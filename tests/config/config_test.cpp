@@ -30,6 +30,9 @@ static constexpr auto cTestServiceManagerJSON          = R"({
     "caCert": "CACert",
     "certStorage": "sm",
     "cmServerUrl": "aoscm:8093",
+    "cni": {
+        "nativePlugins": ["bandwidth"]
+    },
     "downloadDir": "/var/aos/servicemanager/download",
     "extractDir": "/var/aos/servicemanager/extract",
     "hostBinds": [
@@ -49,6 +52,11 @@ static constexpr auto cTestServiceManagerJSON          = R"({
     ],
     "iamProtectedServerUrl": "localhost:8089",
     "iamPublicServerUrl": "localhost:8090",
+    "imageHandler": {
+        "idMappedMounts": true,
+        "fileStoreDir": "/var/aos/filestore",
+        "maxConcurrentInstalls": 2
+    },
     "journalAlerts": {
         "filter": [
             "test",
@@ -75,6 +83,11 @@ static constexpr auto cTestServiceManagerJSON          = R"({
         "pollPeriod": "1h1m5s"
     },
     "nodeConfigFile": "/var/aos/aos_node.cfg",
+    "runtime": {
+        "workingDir": "/run/aos/runtime",
+        "rootfsUpper": "tmpfs",
+        "prefetchDir": "/var/aos/prefetch"
+    },
     "serviceHealthCheckTimeout": "10s",
     "servicesDir": "/var/aos/servicemanager/services",
     "servicesPartLimit": 10,
@@ -198,6 +211,17 @@ TEST_F(ConfigTest, ParseConfig)
 
     EXPECT_EQ(config->mNodeConfigFile, "/var/aos/aos_node.cfg");
     EXPECT_EQ(config->mServicesPartLimit, 10);
+
+    EXPECT_TRUE(config->mImageHandlerConfig.mIDMappedMounts);
+    EXPECT_EQ(config->mImageHandlerConfig.mFileStoreDir, "/var/aos/filestore");
+    EXPECT_EQ(config->mImageHandlerConfig.mMaxConcurrentInstalls, 2);
+
+    ASSERT_EQ(config->mCNIConfig.mNativePlugins.size(), 1);
+    EXPECT_EQ(config->mCNIConfig.mNativePlugins[0], "bandwidth");
+
+    EXPECT_EQ(config->mRuntimeConfig.mWorkingDir, "/run/aos/runtime");
+    EXPECT_EQ(config->mRuntimeConfig.mRootFSUpper, aos::sm::launcher::RootFSUpperType::eTmpfs);
+    EXPECT_EQ(config->mRuntimeConfig.mPrefetchDir, "/var/aos/prefetch");
     EXPECT_EQ(config->mWorkingDir, "workingDir");
 }
 
@@ -232,6 +256,16 @@ TEST_F(ConfigTest, DefaultValuesAreUsed)
     EXPECT_EQ(config->mServiceManagerConfig.mServicesDir, "test/services");
     EXPECT_EQ(config->mServiceManagerConfig.mDownloadDir, "test/downloads");
     EXPECT_EQ(config->mNodeConfigFile, "test/aos_node.cfg");
+
+    EXPECT_FALSE(config->mImageHandlerConfig.mIDMappedMounts);
+    EXPECT_TRUE(config->mImageHandlerConfig.mFileStoreDir.empty());
+    EXPECT_EQ(config->mImageHandlerConfig.mMaxConcurrentInstalls, 0);
+
+    EXPECT_TRUE(config->mCNIConfig.mNativePlugins.empty());
+
+    EXPECT_EQ(config->mRuntimeConfig.mWorkingDir, "test/runtime");
+    EXPECT_EQ(config->mRuntimeConfig.mRootFSUpper, aos::sm::launcher::RootFSUpperType::eNone);
+    EXPECT_TRUE(config->mRuntimeConfig.mPrefetchDir.empty());
 }
 
 TEST_F(ConfigTest, ErrorReturnedOnFileMissing)
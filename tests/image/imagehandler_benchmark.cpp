@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <Poco/Pipe.h>
+#include <Poco/PipeStream.h>
+#include <Poco/Process.h>
+#include <Poco/StreamCopier.h>
+
+#include <aos/common/crypto/cryptoprovider.hpp>
+#include <aos/common/spaceallocator/spaceallocator.hpp>
+#include <ocispec/ocispec.hpp>
+#include <utils/filesystem.hpp>
+#include <utils/fsplatform.hpp>
+#include <utils/image.hpp>
+
+#include "image/imagehandler.hpp"
+#include "image/tarextractor.hpp"
+
+using namespace aos;
+using namespace aos::sm::image;
+
+namespace {
+
+/***********************************************************************************************************************
+ * Constants
+ **********************************************************************************************************************/
+
+constexpr auto cDefaultDir        = "/tmp/aos_image_benchmark";
+constexpr auto cSamplePeriod      = std::chrono::milliseconds(5);
+constexpr auto cMaxOutdatedItems  = 8;
+constexpr auto cWhiteoutPrefix    = ".wh.";
+constexpr auto cLayerMediaType    = "application/vnd.oci.image.layer.v1.tar+gzip";
+constexpr auto cConfigMediaType   = "application/vnd.oci.image.config.v1+json";
+constexpr auto cServiceMediaType  = "application/vnd.aos.service.config.v1+json";
+constexpr auto cManifestMediaType = "application/vnd.oci.image.manifest.v1+json";
+constexpr auto cConfigJSON        = R"({"architecture":"x86","os":"linux","config":{"Cmd":["/bin/true"]}})";
+constexpr auto cServiceJSON       = R"({"created":"2025-01-01T00:00:00Z","author":"benchmark","runner":"crun"})";
+
+/***********************************************************************************************************************
+ * Types
+ **********************************************************************************************************************/
+
+/**
+ * Synthetic image shape.
+ */
+struct Shape {
+    std::string mName;
+    size_t      mFileCount;
+    size_t      mFileSize;
+    size_t      mWhiteoutCount;
+};
+
+/**
+ * Benchmark options.
+ */
+struct Options {
+    std::filesystem::path mDir  = cDefaultDir;
+    size_t                mRuns = 3;
+    std::vector<Shape>    mShapes;
+};
+
+/**
+ * Synthetic OCI archive.
+ */
+struct Archive {
+    std::filesystem::path mPath;
+    std::filesystem::path mContentDir;
+    std::filesystem::path mContentArchive;
+    uint64_t              mSize = 0;
+    std::string           mSHA3;
+};
+
+/**
+ * Samples used space of the file system to find peak disk usage of an operation.
+ */
+class DiskUsageSampler {
+public:
+    explicit DiskUsageSampler(const std::filesystem::path& path)
+        : mPath(path)
+        , mBaseline(UsedSpace())
+        , mPeak(mBaseline)
+    {
+        mThread = std::thread([this]() {
+            while (!mStop) {
+                mPeak = std::max(mPeak.load(), UsedSpace());
+
+                std::this_thread::sleep_for(cSamplePeriod);
+            }
+        });
+    }
+
+    ~DiskUsageSampler() { Stop(); }
+
+    uint64_t Stop()
+    {
+        mStop = true;
+
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+
+        mPeak = std::max(mPeak.load(), UsedSpace());
+
+        return mPeak - mBaseline;
+    }
+
+private:
+    uint64_t UsedSpace() const
+    {
+        struct statvfs st {};
+
+        if (statvfs(mPath.c_str(), &st) != 0) {
+            return 0;
+        }
+
+        return static_cast<uint64_t>(st.f_blocks - st.f_bfree) * st.f_frsize;
+    }
+
+    std::filesystem::path mPath;
+    uint64_t              mBaseline;
+    std::atomic<uint64_t> mPeak;
+    std::atomic_bool      mStop {false};
+    std::thread           mThread;
+};
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+void Check(const Error& err, const std::string& message)
+{
+    if (!err.IsNone()) {
+        throw std::runtime_error(message + ": " + err.Message());
+    }
+}
+
+double Measure(const std::function<void()>& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    func();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Run(const std::string& command, const std::vector<std::string>& arguments)
+{
+    Poco::Process::Args args(arguments.begin(), arguments.end());
+    Poco::Pipe          outPipe;
+    Poco::ProcessHandle ph = Poco::Process::launch(command, args, nullptr, &outPipe, &outPipe);
+
+    if (int rc = ph.wait(); rc != 0) {
+        std::string           output;
+        Poco::PipeInputStream istr(outPipe);
+        Poco::StreamCopier::copyToString(istr, output);
+
+        throw std::runtime_error(command + " failed: " + output);
+    }
+}
+
+void CreateTar(const std::filesystem::path& tarPath, const std::filesystem::path& contentRoot)
+{
+    Run("tar", {"-czf", tarPath.string(), "-C", contentRoot.string(), "."});
+}
+
+void WriteFile(const std::filesystem::path& path, const std::string& content)
+{
+    std::filesystem::create_directories(path.parent_path());
+
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+void GenerateContent(const std::filesystem::path& dir, const Shape& shape)
+{
+    std::mt19937_64 random(shape.mFileCount * 31 + shape.mFileSize);
+    std::string     data(shape.mFileSize, '\0');
+
+    for (size_t i = 0; i < shape.mFileCount; i++) {
+        // Half of the file is random and half is repeated, so the content is compressible like real binaries
+        for (size_t j = 0; j < data.size() / 2; j++) {
+            data[j] = static_cast<char>(random());
+        }
+
+        WriteFile(dir / std::to_string(i % 100) / ("file" + std::to_string(i)), data);
+    }
+
+    for (size_t i = 0; i < shape.mWhiteoutCount; i++) {
+        WriteFile(dir / "deleted" / (cWhiteoutPrefix + std::to_string(i)), "");
+    }
+}
+
+std::string Descriptor(const char* mediaType, const std::string& digest, uint64_t size)
+{
+    return std::string(R"({"mediaType":")") + mediaType + R"(","digest":"sha256:)" + digest + R"(","size":)"
+        + std::to_string(size) + "}";
+}
+
+std::string SHA3(crypto::DefaultCryptoProvider& cryptoProvider, const std::filesystem::path& path)
+{
+    auto [hash, err] = cryptoProvider.CreateHash(crypto::HashEnum::eSHA3_256);
+    Check(err, "can't create hash");
+
+    std::ifstream     file(path, std::ios::binary);
+    std::vector<char> buffer(1024 * 1024);
+
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+        Check(hash->Update(Array<uint8_t>(reinterpret_cast<uint8_t*>(buffer.data()), file.gcount())), "hash failed");
+    }
+
+    StaticArray<uint8_t, cSHA256Size> digest;
+    StaticString<cSHA256Size * 2>     digestStr;
+
+    Check(hash->Finalize(digest), "hash failed");
+    Check(digestStr.ByteArrayToHex(digest), "hash failed");
+
+    return digestStr.CStr();
+}
+
+std::string SHA256(ImageHandler& imageHandler, const std::filesystem::path& path)
+{
+    auto [digest, err] = imageHandler.CalculateDigest(path.c_str());
+    Check(err, "can't calculate digest");
+
+    return digest.CStr();
+}
+
+Archive CreateLayerArchive(crypto::DefaultCryptoProvider& cryptoProvider, ImageHandler& imageHandler,
+    const std::filesystem::path& dir, const Shape& shape)
+{
+    Archive archive;
+
+    const auto root = dir / "layer";
+
+    archive.mContentDir     = dir / "layer-content";
+    archive.mContentArchive = dir / "layer-content.tar.gz";
+    archive.mPath           = dir / "layer.tar.gz";
+
+    GenerateContent(archive.mContentDir, shape);
+    CreateTar(archive.mContentArchive, archive.mContentDir);
+
+    const auto digest = SHA256(imageHandler, archive.mContentArchive);
+
+    std::filesystem::create_directories(root);
+    std::filesystem::copy_file(archive.mContentArchive, root / digest);
+
+    WriteFile(root / "layer.json",
+        Descriptor(cLayerMediaType, digest, std::filesystem::file_size(archive.mContentArchive)));
+
+    CreateTar(archive.mPath, root);
+    std::filesystem::remove_all(root);
+
+    archive.mSize = std::filesystem::file_size(archive.mPath);
+    archive.mSHA3 = SHA3(cryptoProvider, archive.mPath);
+
+    return archive;
+}
+
+Archive CreateServiceArchive(crypto::DefaultCryptoProvider& cryptoProvider, ImageHandler& imageHandler,
+    const std::filesystem::path& dir, const Shape& shape)
+{
+    Archive archive;
+
+    const auto root  = dir / "service";
+    const auto blobs = root / "blobs" / "sha256";
+
+    archive.mContentDir     = dir / "service-content";
+    archive.mContentArchive = dir / "service-content.tar.gz";
+    archive.mPath           = dir / "service.tar.gz";
+
+    GenerateContent(archive.mContentDir, shape);
+    CreateTar(archive.mContentArchive, archive.mContentDir);
+
+    WriteFile(blobs / "config", cConfigJSON);
+    WriteFile(blobs / "service", cServiceJSON);
+
+    const auto rootFSDigest  = SHA256(imageHandler, archive.mContentArchive);
+    const auto configDigest  = SHA256(imageHandler, blobs / "config");
+    const auto serviceDigest = SHA256(imageHandler, blobs / "service");
+
+    std::filesystem::copy_file(archive.mContentArchive, blobs / rootFSDigest);
+    std::filesystem::rename(blobs / "config", blobs / configDigest);
+    std::filesystem::rename(blobs / "service", blobs / serviceDigest);
+
+    WriteFile(root / "manifest.json",
+        std::string(R"({"schemaVersion":2,"mediaType":")") + cManifestMediaType + R"(","config":)"
+            + Descriptor(cConfigMediaType, configDigest, strlen(cConfigJSON)) + R"(,"aosService":)"
+            + Descriptor(cServiceMediaType, serviceDigest, strlen(cServiceJSON)) + R"(,"layers":[)"
+            + Descriptor(cLayerMediaType, rootFSDigest, std::filesystem::file_size(archive.mContentArchive)) + "]}");
+
+    CreateTar(archive.mPath, root);
+    std::filesystem::remove_all(root);
+
+    archive.mSize = std::filesystem::file_size(archive.mPath);
+    archive.mSHA3 = SHA3(cryptoProvider, archive.mPath);
+
+    return archive;
+}
+
+void PrintResult(const std::string& shape, const std::string& stage, double seconds, uint64_t bytes, uint64_t peak = 0)
+{
+    printf("%-24s %-16s %10.3f s %10.2f MB/s", shape.c_str(), stage.c_str(), seconds,
+        seconds > 0 ? static_cast<double>(bytes) / seconds / (1024 * 1024) : 0.0);
+
+    if (peak != 0) {
+        printf(" %10.2f MB peak", static_cast<double>(peak) / (1024 * 1024));
+    }
+
+    printf("\n");
+}
+
+void RunShape(const Options& options, const Shape& shape)
+{
+    const auto dir        = options.mDir / shape.mName;
+    const auto installDir = dir / "install";
+
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(installDir);
+
+    crypto::DefaultCryptoProvider                        cryptoProvider;
+    common::utils::FSPlatform                            platformFS;
+    spaceallocator::SpaceAllocator<cMaxOutdatedItems>    layerSpaceAllocator;
+    spaceallocator::SpaceAllocator<cMaxOutdatedItems>    serviceSpaceAllocator;
+    common::oci::OCISpec                                 ociSpec;
+    ImageHandler                                         imageHandler;
+
+    Check(cryptoProvider.Init(), "can't init crypto provider");
+    Check(layerSpaceAllocator.Init(installDir.c_str(), platformFS), "can't init space allocator");
+    Check(serviceSpaceAllocator.Init(installDir.c_str(), platformFS), "can't init space allocator");
+    Check(imageHandler.Init(cryptoProvider, layerSpaceAllocator, serviceSpaceAllocator, ociSpec, getuid()),
+        "can't init image handler");
+
+    const auto layer   = CreateLayerArchive(cryptoProvider, imageHandler, dir, shape);
+    const auto service = CreateServiceArchive(cryptoProvider, imageHandler, dir, shape);
+    const auto content = shape.mFileCount * shape.mFileSize;
+
+    printf("%-24s files=%zu, fileSize=%zu, whiteouts=%zu, layer=%lu, service=%lu\n", shape.mName.c_str(),
+        shape.mFileCount, shape.mFileSize, shape.mWhiteoutCount, static_cast<unsigned long>(layer.mSize),
+        static_cast<unsigned long>(service.mSize));
+
+    for (size_t run = 0; run < options.mRuns; run++) {
+        const auto unpackDir = dir / "unpack";
+
+        std::filesystem::remove_all(unpackDir);
+
+        // Individual stages are measured on the same data the installs below process
+        const auto hashTime = Measure([&]() { SHA256(imageHandler, service.mContentArchive); });
+
+        const auto unpackTime = Measure([&]() {
+            TarExtractor  extractor(unpackDir);
+            std::ifstream file(service.mContentArchive, std::ios::binary);
+
+            Check(extractor.Extract(file), "can't unpack archive");
+        });
+
+        const auto chownTime = Measure([&]() {
+            Check(common::utils::ChangeOwner(unpackDir, getuid(), getgid()), "can't change owner");
+        });
+
+        const auto hashDirTime
+            = Measure([&]() { Check(common::utils::HashDir(unpackDir.c_str()).mError, "can't hash dir"); });
+
+        PrintResult(shape.mName, "hash", hashTime, std::filesystem::file_size(service.mContentArchive));
+        PrintResult(shape.mName, "unpack", unpackTime, content);
+        PrintResult(shape.mName, "chown", chownTime, content);
+        PrintResult(shape.mName, "hashdir", hashDirTime, content);
+
+        std::filesystem::remove_all(unpackDir);
+
+        LayerInfo layerInfo;
+
+        layerInfo.mLayerID = "benchmark";
+        layerInfo.mSize    = layer.mSize;
+
+        Check(String(layer.mSHA3.c_str()).HexToByteArray(layerInfo.mSHA256), "invalid layer hash");
+
+        UniquePtr<spaceallocator::SpaceItf> layerSpace;
+        DiskUsageSampler                    layerSampler(installDir);
+
+        const auto layerTime = Measure([&]() {
+            Check(imageHandler.InstallLayer(layer.mPath.c_str(), (installDir / "layers").c_str(), layerInfo, layerSpace)
+                      .mError,
+                "can't install layer");
+        });
+
+        PrintResult(shape.mName, "install layer", layerTime, layer.mSize, layerSampler.Stop());
+
+        ServiceInfo serviceInfo;
+
+        serviceInfo.mServiceID = "benchmark";
+        serviceInfo.mVersion   = std::to_string(run).c_str();
+        serviceInfo.mGID       = getgid();
+        serviceInfo.mSize      = service.mSize;
+
+        Check(String(service.mSHA3.c_str()).HexToByteArray(serviceInfo.mSHA256), "invalid service hash");
+
+        UniquePtr<spaceallocator::SpaceItf> serviceSpace;
+        DiskUsageSampler                    serviceSampler(installDir);
+
+        const auto serviceTime = Measure([&]() {
+            Check(imageHandler
+                      .InstallService(service.mPath.c_str(), (installDir / "services").c_str(), serviceInfo,
+                          serviceSpace)
+                      .mError,
+                "can't install service");
+        });
+
+        PrintResult(shape.mName, "install service", serviceTime, service.mSize, serviceSampler.Stop());
+
+        layerSpace.Reset();
+        serviceSpace.Reset();
+
+        std::filesystem::remove_all(installDir / "layers");
+        std::filesystem::remove_all(installDir / "services");
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+Options ParseOptions(int argc, char* argv[])
+{
+    Options options;
+    Shape   custom {"custom", 0, 0, 0};
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg);
+        }
+
+        const std::string value = argv[++i];
+
+        if (arg == "--dir") {
+            options.mDir = value;
+        } else if (arg == "--runs") {
+            options.mRuns = std::stoul(value);
+        } else if (arg == "--files") {
+            custom.mFileCount = std::stoul(value);
+        } else if (arg == "--file-size") {
+            custom.mFileSize = std::stoul(value);
+        } else if (arg == "--whiteouts") {
+            custom.mWhiteoutCount = std::stoul(value);
+        } else {
+            throw std::runtime_error("unknown option " + arg);
+        }
+    }
+
+    if (custom.mFileCount != 0 && custom.mFileSize != 0) {
+        options.mShapes.push_back(custom);
+    } else {
+        options.mShapes = {
+            // Whiteouts are converted to device nodes, which requires root
+            {"many-small-files", 20000, 4 * 1024, getuid() == 0 ? 1000u : 0u},
+            {"few-large-files", 4, 64 * 1024 * 1024, 0},
+        };
+    }
+
+    return options;
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Main
+ **********************************************************************************************************************/
+
+/**
+ * Image install benchmark.
+ *
+ * Usage: image_benchmark [--dir DIR] [--runs N] [--files N --file-size BYTES [--whiteouts N]]
+ */
+int main(int argc, char* argv[])
+{
+    try {
+        const auto options = ParseOptions(argc, argv);
+
+        for (const auto& shape : options.mShapes) {
+            RunShape(options, shape);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Benchmark failed: %s\n", e.what());
+
+        return 1;
+    }
+
+    return 0;
+}
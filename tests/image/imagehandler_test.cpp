@@ -8,6 +8,10 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <thread>
+#include <vector>
 
 #include <Poco/JSON/Array.h>
 #include <Poco/JSON/Object.h>
@@ -20,6 +24,8 @@
 
 #include <aos/common/crypto/cryptoprovider.hpp>
 #include <aos/test/log.hpp>
+#include <utils/filesystem.hpp>
+#include <utils/image.hpp>
 #include <utils/json.hpp>
 
 #include <mocks/ocispecmock.hpp>
@@ -124,8 +130,8 @@ std::string Hash(const std::filesystem::path& path, crypto::Hash algorithm)
     return output;
 }
 
-void CreateTestTarFile(
-    const std::filesystem::path& tarPath, const std::string& contentFilePath, const std::string& content)
+void CreateTestTarFile(const std::filesystem::path& tarPath, const std::string& contentFilePath,
+    const std::string& content, const std::string& owner = {})
 {
     const auto tmpPath = std::filesystem::path(cTestDirRoot) / "tmp-service-artifacts";
 
@@ -136,6 +142,12 @@ void CreateTestTarFile(
     ofs.close();
 
     Poco::Process::Args args;
+
+    if (!owner.empty()) {
+        args.push_back("--owner=" + owner);
+        args.push_back("--group=" + owner);
+    }
+
     args.push_back("-czf");
     args.push_back(tarPath);
     args.push_back("-C");
@@ -159,7 +171,7 @@ void CreateTestTarFile(
     std::filesystem::remove(contentFilePath);
 }
 
-[[maybe_unused]] void CreateTestTarFile(const std::string& tarPath, const std::string& contentRoot)
+void CreateTestTarFile(const std::string& tarPath, const std::string& contentRoot)
 {
     Poco::Process::Args args;
     args.push_back("-czf");
@@ -183,6 +195,16 @@ void CreateTestTarFile(
     }
 }
 
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream     file(path);
+    std::stringstream buffer;
+
+    buffer << file.rdbuf();
+
+    return buffer.str();
+}
+
 struct ImageMetadata {
     std::filesystem::path mArchivePath;
     std::string           mImageDigest;
@@ -191,7 +213,7 @@ struct ImageMetadata {
     std::string           mEmbeddedArchiveDigest;
 };
 
-RetWithError<ImageMetadata> CreateLayerArchive()
+RetWithError<ImageMetadata> CreateLayerArchive(bool fsImage = false, const std::filesystem::path& contentRoot = {})
 {
     auto root            = std::filesystem::path(cTestDirRoot) / "tmp" / "layer";
     auto manifest        = root / "manifest.json";
@@ -202,7 +224,16 @@ RetWithError<ImageMetadata> CreateLayerArchive()
 
     std::filesystem::create_directories(root);
 
-    CreateTestTarFile(embeddedArchive, "main.py", cPythonMain);
+    if (fsImage) {
+        std::ofstream image(embeddedArchive, std::ios::binary);
+
+        // Only squashfs magic is checked on install, the rest of the image is opaque
+        image << "hsqs" << std::string(8192, '\0');
+    } else if (!contentRoot.empty()) {
+        CreateTestTarFile(embeddedArchive, contentRoot);
+    } else {
+        CreateTestTarFile(embeddedArchive, "main.py", cPythonMain);
+    }
 
     metadata.mEmbeddedArchiveDigest = Hash(embeddedArchive, crypto::HashEnum::eSHA256);
 
@@ -221,7 +252,8 @@ RetWithError<ImageMetadata> CreateLayerArchive()
     return {metadata, ErrorEnum::eNone};
 }
 
-RetWithError<ImageMetadata> CreateServiceArchive()
+RetWithError<ImageMetadata> CreateServiceArchive(
+    Poco::JSON::Object::Ptr delta = nullptr, const std::string& rootFSOwner = {})
 {
     auto root              = std::filesystem::path(cTestDirRoot) / "tmp";
     auto blobs             = root / "blobs" / "sha256";
@@ -235,7 +267,7 @@ RetWithError<ImageMetadata> CreateServiceArchive()
 
     std::filesystem::create_directories(blobs);
 
-    CreateTestTarFile(embeddedArchive, "main.py", cPythonMain);
+    CreateTestTarFile(embeddedArchive, "main.py", cPythonMain, rootFSOwner);
 
     if (std::ofstream of(manifest); of) {
         of << cManifestJSON;
@@ -255,6 +287,14 @@ RetWithError<ImageMetadata> CreateServiceArchive()
         return {{}, ErrorEnum::eFailed};
     }
 
+    if (delta) {
+        if (std::ofstream of(root / "delta.json"); of) {
+            delta->stringify(of);
+        } else {
+            return {{}, ErrorEnum::eFailed};
+        }
+    }
+
     metadata.mEmbeddedArchiveDigest = Hash(embeddedArchive, crypto::HashEnum::eSHA256);
     metadata.mConfigDigest          = Hash(configBlob, crypto::HashEnum::eSHA256);
     metadata.mServiceConfigDigest   = Hash(serviceConfigBlob, crypto::HashEnum::eSHA256);
@@ -305,12 +345,42 @@ ServiceInfo CreateServiceInfo(const ImageMetadata& metadata)
     return serviceInfo;
 }
 
+auto LoadServiceManifest(const ImageMetadata& metadata)
+{
+    return Invoke([metadata](const String&, oci::ImageManifest& manifest) {
+        manifest.mConfig.mDigest = "sha256:";
+        manifest.mConfig.mDigest.Append(metadata.mConfigDigest.c_str());
+
+        manifest.mAosService.SetValue({});
+        manifest.mAosService->mDigest = "sha256:";
+        manifest.mAosService->mDigest.Append(metadata.mServiceConfigDigest.c_str());
+
+        manifest.mLayers.PushBack({});
+        manifest.mLayers[0].mDigest = "sha256:";
+        manifest.mLayers[0].mDigest.Append(metadata.mEmbeddedArchiveDigest.c_str());
+
+        return ErrorEnum::eNone;
+    });
+}
+
 } // namespace
 
 /***********************************************************************************************************************
  * Suite
  **********************************************************************************************************************/
 
+class FreeSpaceCounter : public spaceallocator::SpaceAllocatorStub {
+public:
+    Error FreeSpace(size_t size) override
+    {
+        mFreed += size;
+
+        return SpaceAllocatorStub::FreeSpace(size);
+    }
+
+    size_t mFreed = 0;
+};
+
 class ImageTest : public Test {
 protected:
     void SetUp() override
@@ -324,6 +394,23 @@ protected:
 
     void TearDown() override { std::filesystem::remove_all(cTestDirRoot); }
 
+    void ExpectLayerDescriptor(const ImageMetadata& metadata, const Cardinality& times = Exactly(1))
+    {
+        EXPECT_CALL(mOCISpec, LoadContentDescriptor)
+            .Times(times)
+            .WillRepeatedly(Invoke([metadata](const String&, oci::ContentDescriptor& descriptor) {
+                descriptor.mDigest = "sha256:";
+                descriptor.mDigest.Append(metadata.mEmbeddedArchiveDigest.c_str());
+
+                return ErrorEnum::eNone;
+            }));
+    }
+
+    void ExpectServiceManifest(const ImageMetadata& metadata)
+    {
+        EXPECT_CALL(mOCISpec, LoadImageManifest).WillOnce(LoadServiceManifest(metadata));
+    }
+
     aos::crypto::DefaultCryptoProvider mCryptoProvider;
     oci::OCISpecMock                   mOCISpec;
     spaceallocator::SpaceAllocatorStub mSpaceAllocator;
@@ -344,13 +431,7 @@ TEST_F(ImageTest, InstallLayer)
 
     UniquePtr<aos::spaceallocator::SpaceItf> space;
 
-    EXPECT_CALL(mOCISpec, LoadContentDescriptor)
-        .WillOnce(Invoke([&archiveMetadata](const String&, oci::ContentDescriptor& descriptor) {
-            descriptor.mDigest = "sha256:";
-            descriptor.mDigest.Append(archiveMetadata.mEmbeddedArchiveDigest.c_str());
-
-            return ErrorEnum::eNone;
-        }));
+    ExpectLayerDescriptor(archiveMetadata);
     EXPECT_CALL(mOCISpec, SaveContentDescriptor).Times(0);
 
     const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
@@ -368,33 +449,404 @@ TEST_F(ImageTest, InstallLayer)
     EXPECT_EQ(space->Size(), cExpectedLayerSize);
 
     ASSERT_TRUE(fs::DirExist(path).mValue);
+
+    // Unpacked layers are not marked as file system images
+    EXPECT_LT(getxattr(path.CStr(), "user.aos.image", nullptr, 0), 0);
 }
 
-TEST_F(ImageTest, InstallService)
+TEST_F(ImageTest, InstallLayerWithFileStore)
 {
-    auto [archiveMetadata, err] = CreateServiceArchive();
+    auto [archiveMetadata, err] = CreateLayerArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ImageHandlerConfig config;
+    FreeSpaceCounter   layerSpaceAllocator;
+
+    config.mFileStoreDir = (std::filesystem::path(cTestDirRoot) / "filestore").string();
+
+    ASSERT_TRUE(
+        mImageHandler.Init(mCryptoProvider, layerSpaceAllocator, mSpaceAllocator, mOCISpec, getuid(), config).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata, AnyNumber());
+
+    const auto layerInfo = CreateLayerInfo(archiveMetadata);
+    size_t     sizes[3]  = {};
+
+    auto installLayer = [&](size_t i) {
+        const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / std::to_string(i);
+
+        std::filesystem::create_directories(installRoot);
+
+        UniquePtr<aos::spaceallocator::SpaceItf> space;
+        StaticString<cFilePathLen>               path;
+
+        Tie(path, err)
+            = mImageHandler.InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+        ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+        ASSERT_NE(space.Get(), nullptr);
+
+        EXPECT_EQ(ReadFile(std::filesystem::path(path.CStr()) / "main.py"), cPythonMain);
+
+        sizes[i] = space->Size();
+    };
+
+    installLayer(0);
+    installLayer(1);
+
+    // Shared files are charged to the store space, not to the layers which use them
+    EXPECT_EQ(sizes[0], 0u);
+    EXPECT_EQ(sizes[1], 0u);
+    EXPECT_EQ(layerSpaceAllocator.mFreed, 0u);
+
+    std::filesystem::remove_all(std::filesystem::path(cTestDirRoot) / "install" / "0");
+
+    installLayer(2);
+
+    // Store file is still used by the second layer
+    EXPECT_EQ(layerSpaceAllocator.mFreed, 0u);
+
+    std::filesystem::remove_all(std::filesystem::path(cTestDirRoot) / "install" / "1");
+    std::filesystem::remove_all(std::filesystem::path(cTestDirRoot) / "install" / "2");
+
+    ASSERT_TRUE(
+        mImageHandler.Init(mCryptoProvider, layerSpaceAllocator, mSpaceAllocator, mOCISpec, getuid(), config).IsNone());
+
+    EXPECT_EQ(layerSpaceAllocator.mFreed, cExpectedLayerSize);
+}
+
+TEST_F(ImageTest, InstallLayersConcurrently)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ImageHandlerConfig config;
+
+    config.mMaxConcurrentInstalls = 2;
+
+    ASSERT_TRUE(
+        mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid(), config).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata, AnyNumber());
+
+    const auto               layerInfo = CreateLayerInfo(archiveMetadata);
+    std::vector<std::thread> threads;
+    std::vector<Error>       errors(4);
+
+    // Same layer installed to the same dir twice is serialized, installs to other dirs run in parallel
+    for (size_t i = 0; i < errors.size(); i++) {
+        threads.emplace_back([&, i]() {
+            const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / std::to_string(i / 2);
+
+            UniquePtr<aos::spaceallocator::SpaceItf> space;
+
+            errors[i] = mImageHandler
+                            .InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space)
+                            .mError;
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& threadErr : errors) {
+        EXPECT_TRUE(threadErr.IsNone()) << "err= " << threadErr.StrValue() << ", message=" << threadErr.Message();
+    }
+}
+
+TEST_F(ImageTest, InstallLayersWithSameDigestConcurrently)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    // Second archive differs from the first one but contains the same embedded layer
+    auto otherMetadata = archiveMetadata;
+
+    otherMetadata.mArchivePath = std::filesystem::path(cTestDirRoot) / "other-layer.tar.gz";
+
+    std::ofstream(std::filesystem::path(cTestDirRoot) / "tmp" / "layer" / "other") << "other";
+
+    CreateTestTarFile(otherMetadata.mArchivePath, std::filesystem::path(cTestDirRoot) / "tmp" / "layer");
+
+    otherMetadata.mImageDigest = Hash(otherMetadata.mArchivePath, crypto::HashEnum::eSHA3_256);
+
+    ASSERT_NE(otherMetadata.mImageDigest, archiveMetadata.mImageDigest);
+
+    ImageHandlerConfig config;
+
+    config.mMaxConcurrentInstalls = 4;
+
+    ASSERT_TRUE(
+        mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid(), config).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata, AnyNumber());
+
+    const auto               installRoot = std::filesystem::path(cTestDirRoot) / "install";
+    const ImageMetadata*     archives[]  = {&archiveMetadata, &otherMetadata};
+    std::vector<std::thread> threads;
+    std::vector<Error>       errors(4);
+    std::vector<std::string> paths(errors.size());
+
+    // Installs of different archives are staged in parallel, but replace the same install dir one by one
+    for (size_t i = 0; i < errors.size(); i++) {
+        threads.emplace_back([&, i]() {
+            const auto& metadata  = *archives[i % 2];
+            const auto  layerInfo = CreateLayerInfo(metadata);
+
+            UniquePtr<aos::spaceallocator::SpaceItf> space;
+            StaticString<cFilePathLen>               path;
+
+            Tie(path, errors[i])
+                = mImageHandler.InstallLayer(metadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+            paths[i] = path.CStr();
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < errors.size(); i++) {
+        ASSERT_TRUE(errors[i].IsNone()) << "err= " << errors[i].StrValue() << ", message=" << errors[i].Message();
+        EXPECT_EQ(paths[i], paths[0]);
+    }
+
+    EXPECT_EQ(ReadFile(std::filesystem::path(paths[0]) / "main.py"), cPythonMain);
+}
+
+TEST_F(ImageTest, InstallLayerFromStream)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive();
 
     ASSERT_TRUE(err.IsNone());
 
     ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
 
+    ExpectLayerDescriptor(archiveMetadata);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
+    const auto layerInfo   = CreateLayerInfo(archiveMetadata);
+    const auto content     = ReadFile(archiveMetadata.mArchivePath);
+
+    // Archive is written to the pipe in small chunks as if it is being downloaded
+    Poco::Pipe  pipe;
+    std::thread downloader([&pipe, &content]() {
+        for (size_t offset = 0; offset < content.size(); offset += 512) {
+            pipe.writeBytes(content.data() + offset, static_cast<int>(std::min<size_t>(512, content.size() - offset)));
+        }
+
+        pipe.close(Poco::Pipe::CLOSE_WRITE);
+    });
+
+    Poco::PipeInputStream archive(pipe);
+
     UniquePtr<aos::spaceallocator::SpaceItf> space;
+    StaticString<cFilePathLen>               path;
 
-    EXPECT_CALL(mOCISpec, LoadImageManifest)
-        .WillOnce(Invoke([&archiveMetadata](const String&, oci::ImageManifest& manifest) {
-            manifest.mConfig.mDigest = "sha256:";
-            manifest.mConfig.mDigest.Append(archiveMetadata.mConfigDigest.c_str());
+    Tie(path, err) = mImageHandler.InstallLayer(archive, installRoot.c_str(), layerInfo, space);
 
-            manifest.mAosService.SetValue({});
-            manifest.mAosService->mDigest = "sha256:";
-            manifest.mAosService->mDigest.Append(archiveMetadata.mServiceConfigDigest.c_str());
+    downloader.join();
 
-            manifest.mLayers.PushBack({});
-            manifest.mLayers[0].mDigest = "sha256:";
-            manifest.mLayers[0].mDigest.Append(archiveMetadata.mEmbeddedArchiveDigest.c_str());
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
 
-            return ErrorEnum::eNone;
-        }));
+    EXPECT_EQ(ReadFile(std::filesystem::path(path.CStr()) / "main.py"), cPythonMain);
+
+    ASSERT_NE(space.Get(), nullptr);
+    EXPECT_EQ(space->Size(), cExpectedLayerSize);
+}
+
+TEST_F(ImageTest, InstallLayerResume)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
+    const auto stagingDir  = installRoot / ("layer-" + archiveMetadata.mImageDigest);
+    const auto layerInfo   = CreateLayerInfo(archiveMetadata);
+    const auto resumed     = std::string("print('resumed')");
+
+    // Simulate install interrupted after the layer archive has been unpacked
+    std::filesystem::create_directories(stagingDir / archiveMetadata.mEmbeddedArchiveDigest);
+
+    std::ofstream(stagingDir / "layer.json") << cManifestJSON;
+    std::ofstream(stagingDir / archiveMetadata.mEmbeddedArchiveDigest / "main.py") << resumed;
+
+    auto [stagedSize, sizeErr] = common::utils::CalculateSize(stagingDir);
+
+    ASSERT_TRUE(sizeErr.IsNone());
+
+    InstallJournal journal;
+
+    ASSERT_TRUE(journal.Init(stagingDir.string() + ".journal", archiveMetadata.mImageDigest).IsNone());
+    ASSERT_TRUE(journal.SetStage(InstallStage::eUnpacked, "", {stagingDir}, stagedSize).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    StaticString<cFilePathLen>               path;
+
+    Tie(path, err)
+        = mImageHandler.InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    EXPECT_EQ(ReadFile(std::filesystem::path(path.CStr()) / "main.py"), resumed);
+
+    ASSERT_NE(space.Get(), nullptr);
+    EXPECT_GE(space->Size(), resumed.size());
+
+    EXPECT_FALSE(std::filesystem::exists(stagingDir));
+    EXPECT_FALSE(std::filesystem::exists(stagingDir.string() + ".journal"));
+}
+
+TEST_F(ImageTest, InstallLayerResumeCorrupted)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
+    const auto stagingDir  = installRoot / ("layer-" + archiveMetadata.mImageDigest);
+    const auto layerInfo   = CreateLayerInfo(archiveMetadata);
+
+    std::filesystem::create_directories(stagingDir / archiveMetadata.mEmbeddedArchiveDigest);
+
+    std::ofstream(stagingDir / "layer.json") << cManifestJSON;
+    std::ofstream(stagingDir / archiveMetadata.mEmbeddedArchiveDigest / "main.py") << cPythonMain;
+
+    auto [stagedSize, sizeErr] = common::utils::CalculateSize(stagingDir);
+
+    ASSERT_TRUE(sizeErr.IsNone());
+
+    InstallJournal journal;
+
+    ASSERT_TRUE(journal.Init(stagingDir.string() + ".journal", archiveMetadata.mImageDigest).IsNone());
+    ASSERT_TRUE(journal.SetStage(InstallStage::eUnpacked, "", {stagingDir}, stagedSize).IsNone());
+
+    // Simulate staged file lost its content on power loss after the stage was saved
+    std::ofstream(stagingDir / archiveMetadata.mEmbeddedArchiveDigest / "main.py", std::ios::trunc);
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    StaticString<cFilePathLen>               path;
+
+    Tie(path, err)
+        = mImageHandler.InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    EXPECT_EQ(ReadFile(std::filesystem::path(path.CStr()) / "main.py"), cPythonMain);
+}
+
+TEST_F(ImageTest, InstallLayerImage)
+{
+    auto [archiveMetadata, err] = CreateLayerArchive(true);
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+
+    ExpectLayerDescriptor(archiveMetadata);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
+    const auto layerInfo   = CreateLayerInfo(archiveMetadata);
+
+    std::filesystem::create_directories(installRoot);
+
+    StaticString<cFilePathLen> path;
+    Tie(path, err)
+        = mImageHandler.InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    const auto image = std::filesystem::path(path.CStr()) / "layer.img";
+    char       imageName[256] {};
+
+    ASSERT_TRUE(std::filesystem::is_regular_file(image));
+    ASSERT_GT(getxattr(path.CStr(), "user.aos.image", imageName, sizeof(imageName) - 1), 0);
+    EXPECT_STREQ(imageName, "layer.img");
+    EXPECT_EQ(std::filesystem::file_size(image), 4 + 8192u);
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(path.CStr()) / "main.py"));
+
+    ASSERT_NE(space.Get(), nullptr);
+    EXPECT_EQ(space->Size(), 4 + 8192u);
+}
+
+TEST_F(ImageTest, InstallLayerWithWhiteouts)
+{
+    // Whiteouts are converted to root owned device nodes, which requires root
+    if (geteuid() != 0) {
+        GTEST_SKIP() << "Test requires root";
+    }
+
+    const auto content = std::filesystem::path(cTestDirRoot) / "tmp" / "layer-content";
+
+    std::filesystem::create_directories(content / "opaque");
+
+    std::ofstream(content / "main.py") << cPythonMain;
+    std::ofstream(content / ".wh.foo");
+    std::ofstream(content / "opaque" / ".wh..wh..opq");
+
+    auto [archiveMetadata, err] = CreateLayerArchive(false, content);
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    ExpectLayerDescriptor(archiveMetadata);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "layers";
+    const auto layerInfo   = CreateLayerInfo(archiveMetadata);
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    StaticString<cFilePathLen>               path;
+
+    Tie(path, err)
+        = mImageHandler.InstallLayer(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), layerInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    const auto layerPath = std::filesystem::path(path.CStr());
+
+    struct stat st;
+
+    ASSERT_EQ(lstat((layerPath / "foo").c_str(), &st), 0);
+
+    EXPECT_TRUE(S_ISCHR(st.st_mode));
+    EXPECT_EQ(st.st_rdev, 0u);
+    EXPECT_EQ(st.st_uid, 0u);
+    EXPECT_EQ(st.st_gid, 0u);
+
+    char opaque[8] {};
+
+    ASSERT_EQ(lgetxattr((layerPath / "opaque").c_str(), "trusted.overlay.opaque", opaque, sizeof(opaque) - 1), 1);
+    EXPECT_STREQ(opaque, "y");
+}
+
+TEST_F(ImageTest, InstallService)
+{
+    auto [archiveMetadata, err] = CreateServiceArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+
+    ExpectServiceManifest(archiveMetadata);
 
     EXPECT_CALL(mOCISpec, SaveImageManifest)
         .WillOnce(Invoke([](const String& path, const oci::ImageManifest& manifest) {
@@ -420,4 +872,248 @@ TEST_F(ImageTest, InstallService)
     ASSERT_TRUE(fs::DirExist(path).mValue);
 }
 
+TEST_F(ImageTest, InstallServiceInvalidChecksum)
+{
+    auto [archiveMetadata, err] = CreateServiceArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+
+    EXPECT_CALL(mOCISpec, LoadImageManifest).Times(0);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "services";
+    auto       serviceInfo = CreateServiceInfo(archiveMetadata);
+
+    serviceInfo.mSHA256[0] ^= 0xff;
+
+    StaticString<cFilePathLen> path;
+    Tie(path, err)
+        = mImageHandler.InstallService(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), serviceInfo, space);
+
+    EXPECT_TRUE(err.Is(ErrorEnum::eInvalidChecksum)) << "err= " << err.StrValue();
+    EXPECT_TRUE(std::filesystem::is_empty(installRoot));
+}
+
+TEST_F(ImageTest, InstallServiceIDMapped)
+{
+    // Image files owned by non root user are stored root owned, as only root is mapped to the service owner
+    auto [archiveMetadata, err] = CreateServiceArchive(nullptr, "1000");
+
+    ASSERT_TRUE(err.IsNone());
+
+    ImageHandlerConfig config;
+
+    config.mIDMappedMounts = true;
+
+    ASSERT_TRUE(
+        mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid(), config).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    std::string                              rootFSDigest;
+
+    ExpectServiceManifest(archiveMetadata);
+
+    EXPECT_CALL(mOCISpec, SaveImageManifest)
+        .WillOnce(Invoke([&rootFSDigest](const String&, const oci::ImageManifest& manifest) {
+            rootFSDigest = manifest.mLayers[0].mDigest.CStr();
+
+            return ErrorEnum::eNone;
+        }));
+
+    EXPECT_CALL(mOCISpec, LoadServiceConfig).Times(1);
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "services";
+    const auto serviceInfo = CreateServiceInfo(archiveMetadata);
+
+    StaticString<cFilePathLen> path;
+    Tie(path, err)
+        = mImageHandler.InstallService(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), serviceInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    const auto [algorithm, hash] = common::utils::ParseDigest(rootFSDigest);
+    const auto rootFSPath        = std::filesystem::path(path.CStr()) / "blobs" / algorithm / hash;
+
+    char owner[32] {};
+
+    ASSERT_GT(getxattr(rootFSPath.c_str(), "user.aos.owner", owner, sizeof(owner) - 1), 0);
+    EXPECT_EQ(std::string(owner), std::to_string(getuid()) + ":" + std::to_string(serviceInfo.mGID));
+
+    struct stat st;
+
+    ASSERT_EQ(lstat((rootFSPath / "main.py").c_str(), &st), 0);
+
+    // Extracted files are owned by the current user when not running as root
+    EXPECT_EQ(st.st_uid, geteuid() == 0 ? 0u : geteuid());
+    EXPECT_EQ(st.st_gid, geteuid() == 0 ? 0u : getegid());
+}
+
+TEST_F(ImageTest, InstallServiceDelta)
+{
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "services";
+    const auto baseRootFS  = std::filesystem::path(cTestDirRoot) / "base-rootfs";
+    const auto newRootFS   = std::filesystem::path(cTestDirRoot) / "new-rootfs";
+
+    std::filesystem::create_directories(baseRootFS / "data");
+    std::filesystem::create_directories(newRootFS / "data");
+
+    std::ofstream(baseRootFS / "main.py") << "print('base')";
+    std::ofstream(baseRootFS / "data" / "removed.txt") << "removed";
+    std::ofstream(baseRootFS / "data" / "kept.txt") << "kept";
+    std::ofstream(newRootFS / "main.py") << cPythonMain;
+    std::ofstream(newRootFS / "data" / "kept.txt") << "kept";
+
+    auto baseDigest = common::utils::HashDir(baseRootFS);
+    auto newDigest  = common::utils::HashDir(newRootFS);
+
+    ASSERT_TRUE(baseDigest.mError.IsNone());
+    ASSERT_TRUE(newDigest.mError.IsNone());
+
+    // Installed base service is found by its rootfs digest
+    const auto baseDir                   = installRoot / "test-service-v0.9.0";
+    const auto [baseAlgorithm, baseHash] = common::utils::ParseDigest(baseDigest.mValue);
+
+    std::filesystem::create_directories(baseDir / "blobs" / baseAlgorithm);
+    std::filesystem::rename(baseRootFS, baseDir / "blobs" / baseAlgorithm / baseHash);
+    std::ofstream(baseDir / "manifest.json") << "{}";
+
+    auto delta   = Poco::makeShared<Poco::JSON::Object>();
+    auto removed = Poco::makeShared<Poco::JSON::Array>();
+
+    removed->add("/data/removed.txt");
+
+    delta->set("baseDigest", baseDigest.mValue);
+    delta->set("digest", newDigest.mValue);
+    delta->set("removed", removed);
+
+    auto [archiveMetadata, err] = CreateServiceArchive(delta);
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    std::string                              rootFSDigest;
+
+    EXPECT_CALL(mOCISpec, LoadImageManifest)
+        .WillOnce(LoadServiceManifest(archiveMetadata))
+        .WillOnce(Invoke([&baseDigest](const String&, oci::ImageManifest& manifest) {
+            manifest.mLayers.PushBack({});
+            manifest.mLayers[0].mDigest = baseDigest.mValue.c_str();
+
+            return ErrorEnum::eNone;
+        }));
+
+    EXPECT_CALL(mOCISpec, SaveImageManifest)
+        .WillOnce(Invoke([&rootFSDigest](const String&, const oci::ImageManifest& manifest) {
+            rootFSDigest = manifest.mLayers[0].mDigest.CStr();
+
+            return ErrorEnum::eNone;
+        }));
+
+    EXPECT_CALL(mOCISpec, LoadServiceConfig).Times(1);
+
+    const auto serviceInfo = CreateServiceInfo(archiveMetadata);
+
+    StaticString<cFilePathLen> path;
+    Tie(path, err)
+        = mImageHandler.InstallService(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), serviceInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    EXPECT_EQ(rootFSDigest, newDigest.mValue);
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(path.CStr()) / "delta.json"));
+
+    const auto [algorithm, hash] = common::utils::ParseDigest(rootFSDigest);
+    const auto rootFSPath        = std::filesystem::path(path.CStr()) / "blobs" / algorithm / hash;
+
+    EXPECT_EQ(ReadFile(rootFSPath / "main.py"), cPythonMain);
+    EXPECT_EQ(ReadFile(rootFSPath / "data" / "kept.txt"), "kept");
+    EXPECT_FALSE(std::filesystem::exists(rootFSPath / "data" / "removed.txt"));
+}
+
+TEST_F(ImageTest, ValidateServiceDigestCache)
+{
+    auto [archiveMetadata, err] = CreateServiceArchive();
+
+    ASSERT_TRUE(err.IsNone());
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    UniquePtr<aos::spaceallocator::SpaceItf> space;
+    std::string                              rootFSDigest;
+
+    EXPECT_CALL(mOCISpec, LoadImageManifest)
+        .WillRepeatedly(Invoke([&archiveMetadata, &rootFSDigest](const String&, oci::ImageManifest& manifest) {
+            manifest.mConfig.mDigest = "sha256:";
+            manifest.mConfig.mDigest.Append(archiveMetadata.mConfigDigest.c_str());
+
+            manifest.mLayers.PushBack({});
+
+            if (rootFSDigest.empty()) {
+                manifest.mLayers[0].mDigest = "sha256:";
+                manifest.mLayers[0].mDigest.Append(archiveMetadata.mEmbeddedArchiveDigest.c_str());
+            } else {
+                manifest.mLayers[0].mDigest = rootFSDigest.c_str();
+            }
+
+            return ErrorEnum::eNone;
+        }));
+
+    EXPECT_CALL(mOCISpec, SaveImageManifest)
+        .WillOnce(Invoke([&rootFSDigest](const String&, const oci::ImageManifest& manifest) {
+            rootFSDigest = manifest.mLayers[0].mDigest.CStr();
+
+            return ErrorEnum::eNone;
+        }));
+
+    const auto installRoot = std::filesystem::path(cTestDirRoot) / "install" / "services";
+    const auto serviceInfo = CreateServiceInfo(archiveMetadata);
+
+    StaticString<cFilePathLen> path;
+    Tie(path, err)
+        = mImageHandler.InstallService(archiveMetadata.mArchivePath.c_str(), installRoot.c_str(), serviceInfo, space);
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue() << ", message=" << err.Message();
+
+    const auto blobsDir   = std::filesystem::path(path.CStr()) / "blobs" / "sha256";
+    const auto configBlob = blobsDir / archiveMetadata.mConfigDigest;
+    const auto cacheKey   = "user.aos.digest.sha256." + archiveMetadata.mConfigDigest;
+
+    ASSERT_TRUE(mImageHandler.ValidateService(path).IsNone());
+    EXPECT_GT(getxattr(blobsDir.c_str(), cacheKey.c_str(), nullptr, 0), 0);
+
+    // Cached digest is used while blob is unchanged
+    ASSERT_TRUE(mImageHandler.ValidateService(path).IsNone());
+
+    std::ofstream(configBlob, std::ios::app) << " ";
+
+    EXPECT_TRUE(mImageHandler.ValidateService(path).Is(ErrorEnum::eInvalidChecksum));
+}
+
+TEST_F(ImageTest, CalculateDigest)
+{
+    const auto root     = std::filesystem::path(cTestDirRoot) / "digest";
+    const auto combined = std::filesystem::path(cTestDirRoot) / "combined";
+
+    std::filesystem::create_directories(root / "dir");
+
+    // Files bigger than read buffer are hashed by several chunks
+    const std::string bigContent(3 * 1024 * 1024 + 17, 'a');
+
+    std::ofstream(root / "dir" / "b") << bigContent;
+    std::ofstream(root / "a") << cPythonMain;
+    std::ofstream(combined) << cPythonMain << bigContent;
+
+    ASSERT_TRUE(mImageHandler.Init(mCryptoProvider, mSpaceAllocator, mSpaceAllocator, mOCISpec, getuid()).IsNone());
+
+    auto [digest, err] = mImageHandler.CalculateDigest(root.c_str());
+
+    ASSERT_TRUE(err.IsNone()) << "err= " << err.StrValue();
+    EXPECT_EQ(std::string(digest.CStr()), Hash(combined, crypto::HashEnum::eSHA256));
+}
+
 } // namespace aos::sm::image
@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+#include <Poco/Pipe.h>
+#include <Poco/PipeStream.h>
+#include <Poco/Process.h>
+#include <Poco/StreamCopier.h>
+
+#include <gtest/gtest.h>
+#include <zstd.h>
+
+#include <aos/test/log.hpp>
+
+#include "image/tarextractor.hpp"
+
+using namespace testing;
+
+namespace aos::sm::image {
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto cTestDir    = "test_dir/tarextractor";
+constexpr auto cContent    = "Hello, world!";
+constexpr auto cLongDirLen = 120;
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+void CreateTar(const std::filesystem::path& tarPath, const std::filesystem::path& contentRoot, bool compress)
+{
+    Poco::Process::Args args;
+    args.push_back(compress ? "-czf" : "-cf");
+    args.push_back(tarPath);
+    args.push_back("-C");
+    args.push_back(contentRoot);
+    args.push_back(".");
+
+    Poco::Pipe          outPipe;
+    Poco::ProcessHandle ph = Poco::Process::launch("tar", args, nullptr, &outPipe, &outPipe);
+
+    if (int rc = ph.wait(); rc != 0) {
+        std::string           output;
+        Poco::PipeInputStream istr(outPipe);
+        Poco::StreamCopier::copyToString(istr, output);
+
+        throw std::runtime_error("Failed to create test tar file: " + output);
+    }
+}
+
+void AppendTar(const std::filesystem::path& tarPath, const std::filesystem::path& contentRoot, const std::string& name)
+{
+    Poco::Process::Args args;
+    args.push_back("-rf");
+    args.push_back(tarPath);
+    args.push_back("-C");
+    args.push_back(contentRoot);
+    args.push_back(name);
+
+    if (int rc = Poco::Process::launch("tar", args).wait(); rc != 0) {
+        throw std::runtime_error("Failed to append test tar file");
+    }
+}
+
+void CreateXAttrTar(const std::filesystem::path& tarPath, const std::filesystem::path& contentRoot, const std::string& name)
+{
+    Poco::Process::Args args;
+    args.push_back("--format=posix");
+    args.push_back("--xattrs");
+    args.push_back("--xattrs-include=*");
+    args.push_back("-cf");
+    args.push_back(tarPath);
+    args.push_back("-C");
+    args.push_back(contentRoot);
+    args.push_back(name);
+
+    if (int rc = Poco::Process::launch("tar", args).wait(); rc != 0) {
+        throw std::runtime_error("Failed to create test tar file");
+    }
+}
+
+void SetFirstEntryType(const std::filesystem::path& tarPath, char type)
+{
+    std::fstream file(tarPath, std::ios::in | std::ios::out | std::ios::binary);
+    char         header[512];
+
+    file.read(header, sizeof(header));
+
+    header[156] = type;
+
+    // Checksum is calculated with the checksum field filled with spaces
+    memset(header + 148, ' ', 8);
+
+    unsigned checksum = 0;
+
+    for (auto c : header) {
+        checksum += static_cast<unsigned char>(c);
+    }
+
+    snprintf(header + 148, 8, "%06o", checksum);
+
+    file.seekp(0);
+    file.write(header, sizeof(header));
+}
+
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream     file(path);
+    std::stringstream buffer;
+
+    buffer << file.rdbuf();
+
+    return buffer.str();
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class TarExtractorTest : public Test {
+protected:
+    void SetUp() override
+    {
+        aos::test::InitLog();
+
+        std::filesystem::remove_all(cTestDir);
+
+        mContentDir = std::filesystem::path(cTestDir) / "content";
+        mLongDir    = mContentDir / std::string(cLongDirLen, 'd');
+
+        std::filesystem::create_directories(mLongDir);
+
+        std::ofstream(mContentDir / "file") << cContent;
+        std::ofstream(mLongDir / "file") << cContent;
+
+        std::filesystem::permissions(mContentDir / "file", std::filesystem::perms(0640));
+        std::filesystem::create_symlink("file", mContentDir / "link");
+    }
+
+    void TearDown() override { std::filesystem::remove_all(cTestDir); }
+
+    void CheckExtracted(const std::filesystem::path& destination)
+    {
+        EXPECT_EQ(ReadFile(destination / "file"), cContent);
+        EXPECT_EQ(ReadFile(destination / mLongDir.filename() / "file"), cContent);
+        EXPECT_EQ(std::filesystem::read_symlink(destination / "link"), "file");
+
+        struct stat st;
+
+        ASSERT_EQ(stat((destination / "file").c_str(), &st), 0);
+        EXPECT_EQ(st.st_mode & 07777, 0640u);
+    }
+
+    std::filesystem::path mContentDir;
+    std::filesystem::path mLongDir;
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(TarExtractorTest, ExtractTar)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "tar";
+
+    CreateTar(archive, mContentDir, false);
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    CheckExtracted(destination);
+
+    EXPECT_EQ(extractor.ExtractedSize(), 2 * strlen(cContent));
+}
+
+TEST_F(TarExtractorTest, ExtractGzip)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar.gz";
+    const auto destination = std::filesystem::path(cTestDir) / "gzip";
+
+    CreateTar(archive, mContentDir, true);
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    CheckExtracted(destination);
+}
+
+TEST_F(TarExtractorTest, ExtractTarWithMagicLikeName)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "magic.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "magic";
+    const auto name        = std::string("(paren");
+
+    // Plain tar starts with the first entry name, which here starts with the first byte of zstd magic
+    std::ofstream(mContentDir / name) << cContent;
+
+    AppendTar(archive, mContentDir, name);
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    EXPECT_EQ(ReadFile(destination / name), cContent);
+}
+
+TEST_F(TarExtractorTest, ExtractZstd)
+{
+    const auto tarArchive  = std::filesystem::path(cTestDir) / "archive.tar";
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar.zst";
+    const auto destination = std::filesystem::path(cTestDir) / "zstd";
+
+    CreateTar(tarArchive, mContentDir, false);
+
+    const auto  tarContent = ReadFile(tarArchive);
+    std::string compressed(ZSTD_compressBound(tarContent.size()), '\0');
+
+    auto size = ZSTD_compress(compressed.data(), compressed.size(), tarContent.data(), tarContent.size(), 3);
+    ASSERT_FALSE(ZSTD_isError(size));
+
+    std::ofstream(archive, std::ios::binary) << compressed.substr(0, size);
+
+    std::ifstream         file(archive, std::ios::binary);
+    TarExtractor          extractor(destination);
+    std::vector<uint64_t> sizes;
+
+    extractor.SetSizeHandler([&sizes](uint64_t size) {
+        sizes.push_back(size);
+
+        return ErrorEnum::eNone;
+    });
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    CheckExtracted(destination);
+
+    // Whole tar size is requested first from the frame header
+    ASSERT_FALSE(sizes.empty());
+    EXPECT_EQ(sizes.front(), tarContent.size());
+}
+
+TEST_F(TarExtractorTest, ExtractTruncatedZstd)
+{
+    const auto tarArchive  = std::filesystem::path(cTestDir) / "archive.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "truncated";
+
+    CreateTar(tarArchive, mContentDir, false);
+
+    const auto  tarContent = ReadFile(tarArchive);
+    std::string compressed(ZSTD_compressBound(tarContent.size()), '\0');
+
+    auto size = ZSTD_compress(compressed.data(), compressed.size(), tarContent.data(), tarContent.size(), 3);
+    ASSERT_FALSE(ZSTD_isError(size));
+
+    std::istringstream stream(compressed.substr(0, size / 2));
+    TarExtractor       extractor(destination);
+
+    EXPECT_FALSE(extractor.Extract(stream).IsNone());
+}
+
+TEST_F(TarExtractorTest, EntryAndSizeHandlers)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar.gz";
+    const auto destination = std::filesystem::path(cTestDir) / "handlers";
+
+    CreateTar(archive, mContentDir, true);
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+    std::string   content;
+    uint64_t      extractedSize = 0;
+
+    extractor.SetEntryHandler([&content](const TarEntry& entry, TarReader& reader) -> RetWithError<bool> {
+        if (entry.mPath != "file") {
+            return {false, ErrorEnum::eNone};
+        }
+
+        content.resize(entry.mSize);
+
+        auto [size, err] = reader.Read(content.data(), content.size());
+
+        return {size == entry.mSize, err};
+    });
+
+    extractor.SetSizeHandler([&extractedSize](uint64_t size) {
+        extractedSize = size;
+
+        return ErrorEnum::eNone;
+    });
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    EXPECT_EQ(content, cContent);
+    EXPECT_FALSE(std::filesystem::exists(destination / "file"));
+    EXPECT_EQ(extractedSize, strlen(cContent));
+}
+
+TEST_F(TarExtractorTest, SizeHandlerError)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar.gz";
+    const auto destination = std::filesystem::path(cTestDir) / "nospace";
+
+    CreateTar(archive, mContentDir, true);
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    extractor.SetSizeHandler([](uint64_t) { return ErrorEnum::eNoMemory; });
+
+    EXPECT_TRUE(extractor.Extract(file).Is(ErrorEnum::eNoMemory));
+}
+
+TEST_F(TarExtractorTest, DirEntryOverSymlink)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "dirsymlink";
+    const auto target      = std::filesystem::absolute(std::filesystem::path(cTestDir) / "target");
+    const auto linkRoot    = std::filesystem::path(cTestDir) / "linkroot";
+    const auto dirRoot     = std::filesystem::path(cTestDir) / "dirroot";
+
+    std::filesystem::create_directories(target);
+    std::filesystem::create_directories(linkRoot);
+    std::filesystem::create_directories(dirRoot / "x");
+    std::filesystem::permissions(target, std::filesystem::perms(0700));
+    std::filesystem::permissions(dirRoot / "x", std::filesystem::perms(0777));
+    std::filesystem::create_directory_symlink(target, linkRoot / "x");
+
+    AppendTar(archive, linkRoot, "x");
+    AppendTar(archive, dirRoot, "x");
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    EXPECT_TRUE(extractor.Extract(file).Is(ErrorEnum::eInvalidArgument));
+
+    struct stat st;
+
+    ASSERT_EQ(stat(target.c_str(), &st), 0);
+    EXPECT_EQ(st.st_mode & 07777, 0700u);
+}
+
+TEST_F(TarExtractorTest, EntryUnderExistingSymlink)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "archive.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "basetree";
+    const auto target      = std::filesystem::absolute(std::filesystem::path(cTestDir) / "target");
+    const auto fileRoot    = std::filesystem::path(cTestDir) / "fileroot";
+
+    std::filesystem::create_directories(target);
+    std::filesystem::create_directories(destination);
+    std::filesystem::create_directories(fileRoot / "lib");
+    std::ofstream(fileRoot / "lib" / "file") << cContent;
+
+    // Symlink already present in destination, as in a cloned delta base tree
+    std::filesystem::create_directory_symlink(target, destination / "lib");
+
+    AppendTar(archive, fileRoot, "lib/file");
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    EXPECT_TRUE(extractor.Extract(file).Is(ErrorEnum::eInvalidArgument));
+    EXPECT_FALSE(std::filesystem::exists(target / "file"));
+}
+
+TEST_F(TarExtractorTest, UnsupportedEntryType)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "sparse.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "sparse";
+
+    AppendTar(archive, mContentDir, "file");
+
+    // GNU sparse file
+    SetFirstEntryType(archive, 'S');
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    EXPECT_TRUE(extractor.Extract(file).Is(ErrorEnum::eNotSupported));
+}
+
+TEST_F(TarExtractorTest, ExtractXAttrs)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "xattrs.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "xattrs";
+    const auto value       = std::string("value");
+
+    if (setxattr((mContentDir / "file").c_str(), "user.test", value.c_str(), value.size(), 0) != 0) {
+        GTEST_SKIP() << "User xattrs are not supported";
+    }
+
+    CreateXAttrTar(archive, mContentDir, "file");
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    ASSERT_TRUE(extractor.Extract(file).IsNone());
+
+    char extracted[16] {};
+
+    ASSERT_EQ(getxattr((destination / "file").c_str(), "user.test", extracted, sizeof(extracted) - 1), value.size());
+    EXPECT_EQ(extracted, value);
+}
+
+TEST_F(TarExtractorTest, RejectAOSXAttrs)
+{
+    const auto archive     = std::filesystem::path(cTestDir) / "aosxattrs.tar";
+    const auto destination = std::filesystem::path(cTestDir) / "aosxattrs";
+    const auto value       = std::string("file");
+
+    if (setxattr(mLongDir.c_str(), "user.aos.image", value.c_str(), value.size(), 0) != 0) {
+        GTEST_SKIP() << "User xattrs are not supported";
+    }
+
+    // Image marker set by the archive would make runtime mount a file from the layer as the layer image
+    CreateXAttrTar(archive, mContentDir, mLongDir.filename());
+
+    std::ifstream file(archive, std::ios::binary);
+    TarExtractor  extractor(destination);
+
+    EXPECT_TRUE(extractor.Extract(file).Is(ErrorEnum::eNotSupported));
+    EXPECT_LT(getxattr((destination / mLongDir.filename()).c_str(), "user.aos.image", nullptr, 0), 0);
+}
+
+} // namespace aos::sm::image
@@ -9,6 +9,7 @@
 
 #include <gmock/gmock.h>
 
+#include "networkmanager/bandwidth.hpp"
 #include "networkmanager/cni.hpp"
 
 namespace aos::sm::cni {
@@ -19,6 +20,17 @@ public:
         (const std::string& payload, const std::string& pluginPath, const std::string& args), (const, override));
 };
 
+class MockTrafficControl : public TrafficControlItf {
+public:
+    MOCK_METHOD(double, GetTickInUsec, (), (const, override));
+    MOCK_METHOD(RetWithError<LinkInfo>, GetLink, (const std::string& name), (const, override));
+    MOCK_METHOD(Error, AddTBF, (int ifIndex, const TBFParams& params), (override));
+    MOCK_METHOD(Error, AddIFB, (const std::string& name, uint32_t mtu), (override));
+    MOCK_METHOD(Error, AddIngressRedirect, (int ifIndex, int redirectIndex), (override));
+    MOCK_METHOD(Error, DeleteLink, (const std::string& name), (override));
+    MOCK_METHOD(Error, DeleteQdisc, (int ifIndex, uint32_t parent), (override));
+};
+
 } // namespace aos::sm::cni
 
 #endif // AOS_CNI_MOCK_HPP_
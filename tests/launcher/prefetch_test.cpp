@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <aos/test/log.hpp>
+
+#include "launcher/prefetch.hpp"
+
+using namespace testing;
+
+namespace aos::sm::launcher {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto cTestDirRoot = "test_dir/prefetch";
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+size_t CountHotLists()
+{
+    return std::distance(fs::directory_iterator(fs::path(cTestDirRoot) / "hotlists"), fs::directory_iterator());
+}
+
+void CreateLayer(const fs::path& layer)
+{
+    fs::create_directories(layer / "bin");
+
+    // Just written file is resident in the page cache
+    std::ofstream(layer / "bin" / "app") << std::string(16384, 'a');
+    fs::create_symlink("bin/app", layer / "app");
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class PrefetchTest : public Test {
+protected:
+    void SetUp() override
+    {
+        aos::test::InitLog();
+
+        fs::remove_all(cTestDirRoot);
+
+        ASSERT_TRUE(mPrefetcher.Init(fs::path(cTestDirRoot) / "hotlists").IsNone());
+    }
+
+    void TearDown() override { fs::remove_all(cTestDirRoot); }
+
+    LayerPrefetcher mPrefetcher;
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(PrefetchTest, LearnAndPrefetch)
+{
+    const auto layer = fs::path(cTestDirRoot) / "layer";
+
+    CreateLayer(layer);
+
+    ASSERT_TRUE(mPrefetcher.Prefetch(layer).IsNone());
+
+    ASSERT_TRUE(mPrefetcher.Learn(layer).IsNone());
+
+    ASSERT_EQ(CountHotLists(), 1);
+
+    const auto hotList = fs::directory_iterator(fs::path(cTestDirRoot) / "hotlists")->path();
+
+    // Hot list name is a stable digest of the layer path
+    EXPECT_EQ(hotList.filename().string().size(), 64);
+
+    std::ifstream file(hotList);
+    std::string   line;
+
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line, layer.lexically_normal().string());
+
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_NE(line.find("bin/app"), std::string::npos);
+
+    EXPECT_TRUE(mPrefetcher.Prefetch(layer).IsNone());
+
+    // Removed layer drops its hot list
+    fs::remove_all(layer);
+
+    ASSERT_TRUE(mPrefetcher.Learn(layer).IsNone());
+    EXPECT_FALSE(fs::exists(hotList));
+}
+
+TEST_F(PrefetchTest, ScheduleLearn)
+{
+    const auto layer = fs::path(cTestDirRoot) / "layer";
+
+    CreateLayer(layer);
+
+    mPrefetcher.ScheduleLearn({layer.string()});
+
+    for (auto i = 0; i < 100 && CountHotLists() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    EXPECT_EQ(CountHotLists(), 1);
+}
+
+TEST_F(PrefetchTest, Prune)
+{
+    const auto layer1 = fs::path(cTestDirRoot) / "layer1";
+    const auto layer2 = fs::path(cTestDirRoot) / "layer2";
+
+    CreateLayer(layer1);
+    CreateLayer(layer2);
+
+    ASSERT_TRUE(mPrefetcher.Learn(layer1).IsNone());
+    ASSERT_TRUE(mPrefetcher.Learn(layer2).IsNone());
+
+    ASSERT_EQ(CountHotLists(), 2);
+
+    // Hot list left from an interrupted write
+    std::ofstream(fs::path(cTestDirRoot) / "hotlists" / "stale.tmp") << "0 4096 bin/app";
+
+    fs::remove_all(layer1);
+
+    ASSERT_TRUE(mPrefetcher.Prune().IsNone());
+
+    EXPECT_EQ(CountHotLists(), 1);
+}
+
+} // namespace aos::sm::launcher
@@ -5,6 +5,8 @@
  */
 
 #include <filesystem>
+#include <fstream>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
@@ -79,6 +81,302 @@ TEST_F(LauncherTest, CreateHostFSWhiteouts)
     }
 }
 
+TEST_F(LauncherTest, CreateHostFSWhiteoutsFromTemplate)
+{
+    RuntimeConfig config;
+
+    config.mWorkingDir = fs::path(cTestDirRoot) / "runtime";
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumHostBinds> hostBinds;
+
+    ASSERT_TRUE(hostBinds.PushBack("usr").IsNone());
+
+    const auto whiteouts1 = fs::path(cTestDirRoot) / "instance1" / "whiteouts";
+    const auto whiteouts2 = fs::path(cTestDirRoot) / "instance2" / "whiteouts";
+
+    ASSERT_TRUE(mRuntime.CreateHostFSWhiteouts(whiteouts1.c_str(), hostBinds).IsNone());
+    ASSERT_TRUE(mRuntime.CreateHostFSWhiteouts(whiteouts2.c_str(), hostBinds).IsNone());
+
+    EXPECT_FALSE(fs::exists(whiteouts1 / "usr"));
+
+    for (const auto& entry : fs::directory_iterator(whiteouts1)) {
+        auto clone = whiteouts2 / entry.path().filename();
+
+        EXPECT_TRUE(fs::is_character_file(fs::status(clone)));
+        EXPECT_TRUE(fs::equivalent(entry.path(), clone));
+    }
+}
+
+TEST_F(LauncherTest, CreateHostFSWhiteoutsRestoresMissingItems)
+{
+    RuntimeConfig config;
+
+    config.mWorkingDir = fs::path(cTestDirRoot) / "runtime";
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumHostBinds> hostBinds;
+
+    const auto whiteouts = fs::path(cTestDirRoot) / "instance" / "whiteouts";
+
+    ASSERT_TRUE(mRuntime.CreateHostFSWhiteouts(whiteouts.c_str(), hostBinds).IsNone());
+
+    std::vector<fs::path> items;
+
+    for (const auto& entry : fs::directory_iterator(whiteouts)) {
+        items.push_back(entry.path());
+    }
+
+    ASSERT_FALSE(items.empty());
+
+    fs::remove(items.back());
+
+    ASSERT_TRUE(mRuntime.CreateHostFSWhiteouts(whiteouts.c_str(), hostBinds).IsNone());
+
+    for (const auto& item : items) {
+        EXPECT_TRUE(fs::is_character_file(fs::symlink_status(item))) << item;
+    }
+}
+
+TEST_F(LauncherTest, MountServiceRootFS)
+{
+    constexpr auto cNumLayers = 8;
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumLayers> layers;
+
+    for (auto i = 0; i < cNumLayers; i++) {
+        auto layerPath = fs::absolute(fs::path(cTestDirRoot) / "layers" / ("layer" + std::to_string(i)));
+
+        fs::create_directories(layerPath);
+
+        std::ofstream(layerPath / ("file" + std::to_string(i))) << "layer" << i;
+
+        ASSERT_TRUE(layers.PushBack(layerPath.c_str()).IsNone());
+    }
+
+    auto rootfsPath = fs::path(cTestDirRoot) / "rootfs";
+
+    auto err = mRuntime.MountServiceRootFS(rootfsPath.c_str(), layers);
+    ASSERT_TRUE(err.IsNone()) << "failed: " << test::ErrorToStr(err);
+
+    for (auto i = 0; i < cNumLayers; i++) {
+        EXPECT_TRUE(fs::exists(rootfsPath / ("file" + std::to_string(i))));
+    }
+
+    err = mRuntime.UmountServiceRootFS(rootfsPath.c_str());
+    EXPECT_TRUE(err.IsNone()) << "failed: " << test::ErrorToStr(err);
+
+    EXPECT_FALSE(fs::exists(rootfsPath));
+}
+
+TEST_F(LauncherTest, MountServiceRootFSSharesLayerStack)
+{
+    const auto workingDir = fs::path(cTestDirRoot) / "runtime";
+
+    RuntimeConfig config;
+
+    config.mWorkingDir = workingDir;
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumLayers> layers;
+
+    for (const auto& layer : {"layer0", "layer1"}) {
+        auto layerPath = fs::absolute(fs::path(cTestDirRoot) / "layers" / layer);
+
+        fs::create_directories(layerPath);
+
+        std::ofstream(layerPath / layer) << layer;
+
+        ASSERT_TRUE(layers.PushBack(layerPath.c_str()).IsNone());
+    }
+
+    const auto rootfs1 = fs::path(cTestDirRoot) / "instance1" / "rootfs";
+    const auto rootfs2 = fs::path(cTestDirRoot) / "instance2" / "rootfs";
+
+    ASSERT_TRUE(mRuntime.MountServiceRootFS(rootfs1.c_str(), layers).IsNone());
+    ASSERT_TRUE(mRuntime.MountServiceRootFS(rootfs2.c_str(), layers).IsNone());
+
+    EXPECT_EQ(std::distance(fs::directory_iterator(workingDir / "layerstacks"), fs::directory_iterator {}), 1);
+
+    ASSERT_TRUE(mRuntime.UmountServiceRootFS(rootfs1.c_str()).IsNone());
+
+    EXPECT_TRUE(fs::exists(rootfs2 / "layer0"));
+    EXPECT_TRUE(fs::exists(rootfs2 / "layer1"));
+
+    ASSERT_TRUE(mRuntime.UmountServiceRootFS(rootfs2.c_str()).IsNone());
+
+    EXPECT_TRUE(fs::is_empty(workingDir / "layerstacks"));
+}
+
+TEST_F(LauncherTest, MountServiceRootFSWithTmpfsUpper)
+{
+    const auto workingDir = fs::path(cTestDirRoot) / "runtime";
+
+    RuntimeConfig config;
+
+    config.mWorkingDir  = workingDir;
+    config.mRootFSUpper = RootFSUpperType::eTmpfs;
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumLayers> layers;
+
+    auto layerPath = fs::absolute(fs::path(cTestDirRoot) / "layers" / "layer0");
+
+    fs::create_directories(layerPath);
+
+    std::ofstream(layerPath / "layer0") << "layer0";
+
+    ASSERT_TRUE(layers.PushBack(layerPath.c_str()).IsNone());
+
+    const auto rootfs = fs::path(cTestDirRoot) / "instance" / "rootfs";
+
+    ASSERT_TRUE(mRuntime.MountServiceRootFS(rootfs.c_str(), layers).IsNone());
+
+    std::ofstream(rootfs / "scratch") << "scratch";
+
+    EXPECT_TRUE(fs::exists(rootfs / "scratch"));
+    EXPECT_FALSE(fs::exists(layerPath / "scratch"));
+
+    ASSERT_TRUE(mRuntime.UmountServiceRootFS(rootfs.c_str()).IsNone());
+
+    EXPECT_TRUE(fs::is_empty(workingDir / "upper"));
+}
+
+TEST_F(LauncherTest, InitKeepsMountedRootFSUpper)
+{
+    const auto workingDir = fs::path(cTestDirRoot) / "runtime";
+
+    RuntimeConfig config;
+
+    config.mWorkingDir  = workingDir;
+    config.mRootFSUpper = RootFSUpperType::eVolatile;
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    StaticArray<StaticString<cFilePathLen>, cMaxNumLayers> layers;
+
+    auto layerPath = fs::absolute(fs::path(cTestDirRoot) / "layers" / "layer0");
+
+    fs::create_directories(layerPath);
+
+    std::ofstream(layerPath / "layer0") << "layer0";
+
+    ASSERT_TRUE(layers.PushBack(layerPath.c_str()).IsNone());
+
+    const auto rootfs = fs::path(cTestDirRoot) / "instance" / "rootfs";
+
+    ASSERT_TRUE(mRuntime.MountServiceRootFS(rootfs.c_str(), layers).IsNone());
+
+    std::ofstream(rootfs / "scratch") << "scratch";
+
+    // Restarted runtime must not remove state of the still running instance
+    Runtime restarted;
+
+    ASSERT_TRUE(restarted.Init(config).IsNone());
+
+    EXPECT_TRUE(fs::exists(rootfs / "layer0"));
+    EXPECT_TRUE(fs::exists(rootfs / "scratch"));
+    EXPECT_FALSE(fs::is_empty(workingDir / "upper"));
+
+    ASSERT_TRUE(restarted.UmountServiceRootFS(rootfs.c_str()).IsNone());
+
+    EXPECT_TRUE(fs::is_empty(workingDir / "upper"));
+    EXPECT_TRUE(fs::is_empty(workingDir / "layerstacks"));
+}
+
+TEST_F(LauncherTest, PrepareInstances)
+{
+    constexpr auto cNumInstances = 8;
+
+    std::vector<InstanceEnvironment> instances(cNumInstances);
+
+    for (auto i = 0; i < cNumInstances; i++) {
+        auto instanceDir = fs::path(cTestDirRoot) / ("instance" + std::to_string(i));
+
+        instances[i].mStoragePath = instanceDir / "storage";
+        instances[i].mNetworkDir  = instanceDir / "network";
+        instances[i].mUID         = getuid();
+        instances[i].mGID         = getgid();
+    }
+
+    // Storage can't be created under a regular file
+    fs::create_directories(cTestDirRoot);
+    std::ofstream(fs::path(cTestDirRoot) / "file");
+
+    instances[1].mStoragePath = fs::path(cTestDirRoot) / "file" / "storage";
+
+    std::vector<Error> errors;
+
+    EXPECT_FALSE(mRuntime.PrepareInstances(instances, errors).IsNone());
+
+    ASSERT_EQ(errors.size(), cNumInstances);
+
+    for (auto i = 0; i < cNumInstances; i++) {
+        EXPECT_EQ(errors[i].IsNone(), i != 1);
+        EXPECT_EQ(fs::exists(instances[i].mNetworkDir + "/etc"), i != 1);
+    }
+}
+
+TEST_F(LauncherTest, PrepareInstancesSharesLayerStack)
+{
+    constexpr auto cNumInstances = 8;
+
+    const auto workingDir = fs::path(cTestDirRoot) / "runtime";
+
+    RuntimeConfig config;
+
+    config.mWorkingDir = workingDir;
+
+    ASSERT_TRUE(mRuntime.Init(config).IsNone());
+
+    std::vector<std::string> layers;
+
+    for (const auto& layer : {"layer0", "layer1"}) {
+        auto layerPath = fs::absolute(fs::path(cTestDirRoot) / "layers" / layer);
+
+        fs::create_directories(layerPath);
+
+        std::ofstream(layerPath / layer) << layer;
+
+        layers.push_back(layerPath);
+    }
+
+    std::vector<InstanceEnvironment> instances(cNumInstances);
+
+    for (auto i = 0; i < cNumInstances; i++) {
+        auto instanceDir = fs::path(cTestDirRoot) / ("instance" + std::to_string(i));
+
+        instances[i].mWhiteoutsPath = instanceDir / "whiteouts";
+        instances[i].mHostBinds     = {"usr"};
+        instances[i].mRootFSPath    = instanceDir / "rootfs";
+        instances[i].mLayers        = layers;
+    }
+
+    std::vector<Error> errors;
+
+    ASSERT_TRUE(mRuntime.PrepareInstances(instances, errors).IsNone());
+
+    // Instances prepared concurrently share one layer stack and one whiteouts template
+    EXPECT_EQ(std::distance(fs::directory_iterator(workingDir / "layerstacks"), fs::directory_iterator {}), 1);
+    EXPECT_EQ(std::distance(fs::directory_iterator(workingDir / "whiteouts"), fs::directory_iterator {}), 1);
+
+    for (const auto& instance : instances) {
+        EXPECT_TRUE(fs::exists(fs::path(instance.mRootFSPath) / "layer0"));
+        EXPECT_TRUE(fs::exists(fs::path(instance.mRootFSPath) / "layer1"));
+        EXPECT_FALSE(fs::exists(fs::path(instance.mWhiteoutsPath) / "usr"));
+    }
+
+    for (const auto& instance : instances) {
+        ASSERT_TRUE(mRuntime.UmountServiceRootFS(instance.mRootFSPath.c_str()).IsNone());
+    }
+
+    EXPECT_TRUE(fs::is_empty(workingDir / "layerstacks"));
+}
+
 TEST_F(LauncherTest, PopulateHostDevices)
 {
     const auto cRootDevicePath     = fs::path(cTestDirRoot) / "dev";
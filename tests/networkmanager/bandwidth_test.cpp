@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <linux/pkt_sched.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <Poco/JSON/Parser.h>
+#include <Poco/SHA2Engine.h>
+
+#include <aos/test/log.hpp>
+
+#include "networkmanager/bandwidth.hpp"
+
+#include "mocks/cnimock.hpp"
+
+using namespace aos;
+using namespace aos::sm::cni;
+using namespace testing;
+
+namespace aos::sm::cni {
+
+bool operator==(const TBFParams& lhs, const TBFParams& rhs)
+{
+    return lhs.mRate == rhs.mRate && lhs.mBuffer == rhs.mBuffer && lhs.mLimit == rhs.mLimit;
+}
+
+} // namespace aos::sm::cni
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto cTickInUsec = 15.625;
+constexpr auto cNetwork    = "sp1";
+constexpr auto cContainer  = "instance0";
+constexpr auto cHostIndex  = 5;
+constexpr auto cIFBIndex   = 6;
+constexpr auto cMTU        = 1500;
+
+/***********************************************************************************************************************
+ * Static
+ **********************************************************************************************************************/
+
+Poco::JSON::Object::Ptr ParseObject(const std::string& json)
+{
+    return Poco::JSON::Parser().parse(json).extract<Poco::JSON::Object::Ptr>();
+}
+
+std::string CreatePayload(const std::string& limits, bool withPrevResult = true)
+{
+    std::string payload = R"({"cniVersion":"0.4.0","name":")" + std::string(cNetwork) + R"(","type":"bandwidth")";
+
+    if (!limits.empty()) {
+        payload += "," + limits;
+    }
+
+    if (withPrevResult) {
+        payload += R"(,"prevResult":{"interfaces":[{"name":"br-sp1"},{"name":"veth0"},)"
+                   R"({"name":"eth0","sandbox":"/run/netns/instance0"}]})";
+    }
+
+    return payload + "}";
+}
+
+std::string CreateArgs(const std::string& command)
+{
+    return "CNI_COMMAND=" + command + " CNI_CONTAINERID=" + cContainer + " CNI_IFNAME=eth0";
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class BandwidthTest : public ::Test {
+protected:
+    void SetUp() override
+    {
+        aos::test::InitLog();
+
+        ASSERT_TRUE(mPlugin.Init(mTrafficControl).IsNone());
+    }
+
+    void ExpectHostLink()
+    {
+        EXPECT_CALL(mTrafficControl, GetTickInUsec()).WillRepeatedly(Return(cTickInUsec));
+        EXPECT_CALL(mTrafficControl, GetLink("br-sp1"))
+            .WillRepeatedly(Return(RetWithError<LinkInfo>(LinkInfo {1, cMTU, true})));
+        EXPECT_CALL(mTrafficControl, GetLink("veth0"))
+            .WillRepeatedly(Return(RetWithError<LinkInfo>(LinkInfo {cHostIndex, cMTU, false})));
+    }
+
+    const std::string mIFBName = GetIFBName(cNetwork, cContainer);
+
+    StrictMock<MockTrafficControl> mTrafficControl;
+    BandwidthPlugin                mPlugin;
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(BandwidthTest, CalculateTBF)
+{
+    // Expected values are produced by the CNI bandwidth plugin binary for the same tick
+    struct TestData {
+        uint64_t  mRateInBits;
+        uint64_t  mBurstInBits;
+        TBFParams mParams;
+    };
+
+    const TestData testData[] = {
+        {1000000, 100000, {125000, 1562500, 15625}},
+        {2000000, 200000, {250000, 1562500, 31250}},
+        // Buffer time is truncated before it is converted to ticks
+        {24, 80, {3, 52083328, 10}},
+        // Rate doesn't fit 32 bits
+        {80000000000, 8000000, {10000000000, 1562, 251000000}},
+    };
+
+    for (const auto& data : testData) {
+        auto [params, err] = CalculateTBF(data.mRateInBits, data.mBurstInBits, cTickInUsec);
+        ASSERT_TRUE(err.IsNone()) << err.Message();
+
+        EXPECT_EQ(params.mRate, data.mParams.mRate);
+        EXPECT_EQ(params.mBuffer, data.mParams.mBuffer);
+        EXPECT_EQ(params.mLimit, data.mParams.mLimit);
+    }
+
+    EXPECT_TRUE(CalculateTBF(7, 100000, cTickInUsec).mError.Is(ErrorEnum::eInvalidArgument));
+    EXPECT_TRUE(CalculateTBF(1000000, 7, cTickInUsec).mError.Is(ErrorEnum::eInvalidArgument));
+}
+
+TEST_F(BandwidthTest, ParseBandwidthLimits)
+{
+    auto [limits, err] = ParseBandwidthLimits(ParseObject(
+        R"({"ingressRate":1000,"ingressBurst":100,"egressRate":2000,"egressBurst":200})"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    EXPECT_EQ(limits.mIngressRate, 1000u);
+    EXPECT_EQ(limits.mIngressBurst, 100u);
+    EXPECT_EQ(limits.mEgressRate, 2000u);
+    EXPECT_EQ(limits.mEgressBurst, 200u);
+
+    // Runtime config limits take precedence
+    Tie(limits, err) = ParseBandwidthLimits(ParseObject(R"({"ingressRate":1000,"ingressBurst":100,)"
+                                                        R"("runtimeConfig":{"bandwidth":{"egressRate":3000,)"
+                                                        R"("egressBurst":300}}})"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    EXPECT_EQ(limits.mIngressRate, 0u);
+    EXPECT_EQ(limits.mIngressBurst, 0u);
+    EXPECT_EQ(limits.mEgressRate, 3000u);
+    EXPECT_EQ(limits.mEgressBurst, 300u);
+
+    Tie(limits, err) = ParseBandwidthLimits(ParseObject(R"({"runtimeConfig":{"portMappings":[]}})"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    EXPECT_EQ(limits.mIngressRate, 0u);
+    EXPECT_EQ(limits.mEgressRate, 0u);
+
+    EXPECT_TRUE(ParseBandwidthLimits(ParseObject(R"({"ingressRate":1000})")).mError.Is(ErrorEnum::eInvalidArgument));
+    EXPECT_TRUE(ParseBandwidthLimits(ParseObject(R"({"egressBurst":1000})")).mError.Is(ErrorEnum::eInvalidArgument));
+    EXPECT_TRUE(ParseBandwidthLimits(ParseObject(R"({"egressRate":1000,"egressBurst":34359738360})"))
+                    .mError.Is(ErrorEnum::eInvalidArgument));
+}
+
+TEST_F(BandwidthTest, IFBName)
+{
+    Poco::SHA2Engine engine(Poco::SHA2Engine::SHA_512);
+
+    engine.update(std::string(cNetwork) + cContainer);
+
+    EXPECT_EQ(mIFBName, "bwp" + Poco::DigestEngine::digestToHex(engine.digest()).substr(0, 12));
+    EXPECT_NE(mIFBName, GetIFBName("sp2", cContainer));
+}
+
+TEST_F(BandwidthTest, Add)
+{
+    ExpectHostLink();
+
+    InSequence sequence;
+
+    EXPECT_CALL(mTrafficControl, AddTBF(cHostIndex, TBFParams {125000, 1562500, 15625}))
+        .WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, AddIFB(mIFBName, cMTU)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, GetLink(mIFBName))
+        .WillOnce(Return(RetWithError<LinkInfo>(LinkInfo {cIFBIndex, cMTU, false})));
+    EXPECT_CALL(mTrafficControl, AddIngressRedirect(cHostIndex, cIFBIndex)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, AddTBF(cIFBIndex, TBFParams {250000, 1562500, 31250}))
+        .WillOnce(Return(ErrorEnum::eNone));
+
+    auto [result, err] = mPlugin.ExecPlugin(
+        CreatePayload(R"("ingressRate":1000000,"ingressBurst":100000,"egressRate":2000000,"egressBurst":200000)"),
+        "/opt/cni/bin/bandwidth", CreateArgs("ADD"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    auto interfaces = ParseObject(result)->getArray("interfaces");
+
+    ASSERT_TRUE(interfaces);
+    EXPECT_EQ(interfaces->size(), 3u);
+}
+
+TEST_F(BandwidthTest, AddWithoutLimits)
+{
+    auto [result, err] = mPlugin.ExecPlugin(CreatePayload(""), "/opt/cni/bin/bandwidth", CreateArgs("ADD"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    EXPECT_TRUE(ParseObject(result)->has("interfaces"));
+}
+
+TEST_F(BandwidthTest, AddInvalidPayload)
+{
+    // Invalid payload is rejected before traffic control is touched
+    EXPECT_FALSE(mPlugin
+                     .ExecPlugin(CreatePayload(R"("ingressRate":1000000,"ingressBurst":100000)", false),
+                         "/opt/cni/bin/bandwidth", CreateArgs("ADD"))
+                     .mError.IsNone());
+    EXPECT_FALSE(mPlugin
+                     .ExecPlugin(CreatePayload(R"("ingressRate":1000000)"), "/opt/cni/bin/bandwidth", CreateArgs("ADD"))
+                     .mError.IsNone());
+    EXPECT_FALSE(mPlugin.ExecPlugin("{", "/opt/cni/bin/bandwidth", CreateArgs("ADD")).mError.IsNone());
+    EXPECT_TRUE(mPlugin.ExecPlugin(CreatePayload(""), "/opt/cni/bin/bandwidth", CreateArgs("CHECK"))
+                    .mError.Is(ErrorEnum::eNotSupported));
+}
+
+TEST_F(BandwidthTest, AddCleanupOnError)
+{
+    ExpectHostLink();
+
+    EXPECT_CALL(mTrafficControl, AddTBF(cHostIndex, _)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, AddIFB(mIFBName, cMTU)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, GetLink(mIFBName))
+        .WillOnce(Return(RetWithError<LinkInfo>(LinkInfo {cIFBIndex, cMTU, false})));
+    EXPECT_CALL(mTrafficControl, AddIngressRedirect(cHostIndex, cIFBIndex)).WillOnce(Return(ErrorEnum::eFailed));
+
+    EXPECT_CALL(mTrafficControl, DeleteQdisc(cHostIndex, TC_H_INGRESS)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, DeleteLink(mIFBName)).WillOnce(Return(ErrorEnum::eNone));
+    EXPECT_CALL(mTrafficControl, DeleteQdisc(cHostIndex, TC_H_ROOT)).WillOnce(Return(ErrorEnum::eNone));
+
+    auto [result, err] = mPlugin.ExecPlugin(
+        CreatePayload(R"("ingressRate":1000000,"ingressBurst":100000,"egressRate":2000000,"egressBurst":200000)"),
+        "/opt/cni/bin/bandwidth", CreateArgs("ADD"));
+    EXPECT_TRUE(err.Is(ErrorEnum::eFailed));
+}
+
+TEST_F(BandwidthTest, AddCleanupOnlyAdded)
+{
+    ExpectHostLink();
+
+    // Existing qdisc of the host interface is not removed
+    EXPECT_CALL(mTrafficControl, AddTBF(cHostIndex, _)).WillOnce(Return(Error(EEXIST)));
+
+    auto [result, err] = mPlugin.ExecPlugin(
+        CreatePayload(R"("ingressRate":1000000,"ingressBurst":100000,"egressRate":2000000,"egressBurst":200000)"),
+        "/opt/cni/bin/bandwidth", CreateArgs("ADD"));
+    EXPECT_FALSE(err.IsNone());
+}
+
+TEST_F(BandwidthTest, Del)
+{
+    EXPECT_CALL(mTrafficControl, DeleteLink(mIFBName)).WillOnce(Return(ErrorEnum::eNone));
+
+    auto [result, err] = mPlugin.ExecPlugin(CreatePayload("", false), "/opt/cni/bin/bandwidth", CreateArgs("DEL"));
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+
+    EXPECT_TRUE(result.empty());
+}
@@ -6,6 +6,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <vector>
 
 #include <Poco/JSON/Parser.h>
 #include <gmock/gmock.h>
@@ -1250,3 +1251,48 @@ TEST_F(CNITest, TestNetworkListLifecycle)
 
     EXPECT_FALSE(std::filesystem::exists(cacheFilePath));
 }
+
+TEST_F(CNITest, TestPluginTemplatesPerInstanceFields)
+{
+    auto netConfig = CreateTestBridgeNetworkConfig();
+    auto rtConfig  = CreateTestRuntimeConfig();
+
+    std::vector<std::string> configs;
+
+    EXPECT_CALL(*mExec, ExecPlugin(_, "/opt/cni/bin/bridge", _))
+        .Times(3)
+        .WillRepeatedly(DoAll(WithArg<0>(Invoke([&](const std::string& config) { configs.push_back(config); })),
+            Return(RetWithError<std::string> {"", ErrorEnum::eNone})));
+
+    Result result;
+
+    ASSERT_TRUE(mCNI.AddNetworkList(netConfig, rtConfig, result).IsNone());
+
+    // Second instance on the same network
+    netConfig.mBridge.mIPAM.mRange.mRangeStart = "172.17.0.3";
+    netConfig.mBridge.mIPAM.mRange.mRangeEnd   = "172.17.0.3";
+    rtConfig.mContainerID                      = "3a1c6e1e-62a5-4bd6-8dd5-5d3f1b8d1c47";
+
+    ASSERT_TRUE(mCNI.AddNetworkList(netConfig, rtConfig, result).IsNone());
+
+    // Network config is changed
+    netConfig.mBridge.mIPAM.mRange.mSubnet = "172.18.0.0/16";
+
+    ASSERT_TRUE(mCNI.AddNetworkList(netConfig, rtConfig, result).IsNone());
+
+    ASSERT_EQ(configs.size(), 3);
+
+    auto getIPAM = [](const std::string& config) {
+        auto [json, err] = common::utils::ParseJson(config);
+        EXPECT_TRUE(err.IsNone());
+
+        return json.extract<Poco::JSON::Object::Ptr>()->getObject("ipam");
+    };
+
+    EXPECT_EQ(getIPAM(configs[0])->getValue<std::string>("rangeStart"), "172.17.0.2");
+    EXPECT_EQ(getIPAM(configs[0])->getValue<std::string>("subnet"), "172.17.0.0/16");
+    EXPECT_EQ(getIPAM(configs[1])->getValue<std::string>("rangeStart"), "172.17.0.3");
+    EXPECT_EQ(getIPAM(configs[1])->getValue<std::string>("subnet"), "172.17.0.0/16");
+    EXPECT_EQ(getIPAM(configs[2])->getValue<std::string>("rangeStart"), "172.17.0.3");
+    EXPECT_EQ(getIPAM(configs[2])->getValue<std::string>("subnet"), "172.18.0.0/16");
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include <aos/test/log.hpp>
+
+#include "networkmanager/exec.hpp"
+
+using namespace aos;
+using namespace aos::sm::cni;
+using namespace testing;
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class ExecTest : public ::Test {
+protected:
+    void SetUp() override
+    {
+        aos::test::InitLog();
+
+        std::filesystem::remove_all(mTestDir);
+        ASSERT_TRUE(std::filesystem::create_directories(mTestDir));
+    }
+
+    void TearDown() override { std::filesystem::remove_all(mTestDir); }
+
+    std::string CreatePlugin(const std::string& name, const std::string& script)
+    {
+        const auto path = mTestDir / name;
+
+        std::ofstream file(path);
+
+        file << "#!/bin/sh\n" << script;
+        file.close();
+
+        std::filesystem::permissions(path, std::filesystem::perms::owner_all);
+
+        return path.string();
+    }
+
+    std::filesystem::path mTestDir = "/tmp/exec_test";
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(ExecTest, ExecPlugin)
+{
+    // Plugin writes more than pipe buffer to stderr before stdout
+    auto plugin = CreatePlugin("plugin", "head -c 1000000 /dev/zero >&2\ncat\necho \"$CNI_COMMAND\"\n");
+
+    const auto payload = std::string(300000, 'x');
+
+    auto [output, err] = Exec().ExecPlugin(payload, plugin, "CNI_COMMAND=ADD CNI_IFNAME=eth0");
+    ASSERT_TRUE(err.IsNone()) << err.Message();
+    EXPECT_EQ(output, payload + "ADD\n");
+}
+
+TEST_F(ExecTest, PluginFailed)
+{
+    auto plugin = CreatePlugin("plugin", "echo '{\"msg\": \"plugin error\"}'\nexit 1\n");
+
+    EXPECT_FALSE(Exec().ExecPlugin("{}", plugin, "CNI_COMMAND=ADD").mError.IsNone());
+    EXPECT_FALSE(Exec().ExecPlugin("{}", (mTestDir / "absent").string(), "CNI_COMMAND=ADD").mError.IsNone());
+}
+
+TEST_F(ExecTest, PluginTimeout)
+{
+    auto plugin = CreatePlugin("plugin", "sleep 10\n");
+
+    auto [output, err] = Exec(std::chrono::milliseconds(200)).ExecPlugin("{}", plugin, "CNI_COMMAND=ADD");
+    EXPECT_TRUE(err.Is(ErrorEnum::eTimeout)) << err.Message();
+}
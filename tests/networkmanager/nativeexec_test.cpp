@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <aos/test/log.hpp>
+
+#include "networkmanager/nativeexec.hpp"
+
+#include "mocks/cnimock.hpp"
+
+using namespace aos;
+using namespace aos::sm::cni;
+using namespace testing;
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class NativeExecTest : public ::Test {
+protected:
+    void SetUp() override { aos::test::InitLog(); }
+
+    StrictMock<MockExec> mFallback;
+    StrictMock<MockExec> mNativePlugin;
+    NativeExec           mNativeExec;
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(NativeExecTest, ExecNativePlugin)
+{
+    ASSERT_TRUE(mNativeExec.RegisterPlugin("bandwidth", mNativePlugin).IsNone());
+    ASSERT_TRUE(mNativeExec.Init(mFallback, {"bandwidth"}).IsNone());
+    EXPECT_TRUE(mNativeExec.RegisterPlugin("bandwidth", mNativePlugin).Is(ErrorEnum::eAlreadyExist));
+
+    EXPECT_CALL(mNativePlugin, ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD"))
+        .WillOnce(Return(RetWithError<std::string>("result")));
+
+    auto [result, err] = mNativeExec.ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD");
+    ASSERT_TRUE(err.IsNone());
+    EXPECT_EQ(result, "result");
+
+    EXPECT_CALL(mFallback, ExecPlugin("payload", "/opt/cni/bin/bridge", "CNI_COMMAND=ADD"))
+        .WillOnce(Return(RetWithError<std::string>("bridge")));
+
+    auto [bridgeResult, bridgeErr] = mNativeExec.ExecPlugin("payload", "/opt/cni/bin/bridge", "CNI_COMMAND=ADD");
+    ASSERT_TRUE(bridgeErr.IsNone());
+    EXPECT_EQ(bridgeResult, "bridge");
+}
+
+TEST_F(NativeExecTest, NativePluginNotEnabled)
+{
+    ASSERT_TRUE(mNativeExec.RegisterPlugin("bandwidth", mNativePlugin).IsNone());
+    ASSERT_TRUE(mNativeExec.Init(mFallback, {}).IsNone());
+
+    EXPECT_CALL(mFallback, ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD"))
+        .WillOnce(Return(RetWithError<std::string>("result")));
+
+    auto [result, err] = mNativeExec.ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD");
+    ASSERT_TRUE(err.IsNone());
+    EXPECT_EQ(result, "result");
+}
+
+TEST_F(NativeExecTest, FallbackOnNativePluginError)
+{
+    ASSERT_TRUE(mNativeExec.RegisterPlugin("bandwidth", mNativePlugin).IsNone());
+    ASSERT_TRUE(mNativeExec.Init(mFallback, {"bandwidth"}).IsNone());
+
+    EXPECT_CALL(mNativePlugin, ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD"))
+        .WillOnce(Return(RetWithError<std::string>("", ErrorEnum::eFailed)));
+    EXPECT_CALL(mFallback, ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD"))
+        .WillOnce(Return(RetWithError<std::string>("result")));
+
+    auto [result, err] = mNativeExec.ExecPlugin("payload", "/opt/cni/bin/bandwidth", "CNI_COMMAND=ADD");
+    ASSERT_TRUE(err.IsNone());
+    EXPECT_EQ(result, "result");
+}
+
+TEST_F(NativeExecTest, NativePluginNotImplemented)
+{
+    ASSERT_TRUE(mNativeExec.RegisterPlugin("bandwidth", mNativePlugin).IsNone());
+
+    EXPECT_TRUE(mNativeExec.Init(mFallback, {"bandwidth", "bridge"}).Is(ErrorEnum::eNotSupported));
+}
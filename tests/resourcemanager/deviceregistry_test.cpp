@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2025 EPAM Systems, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <gtest/gtest.h>
+
+#include <aos/test/log.hpp>
+#include <aos/test/utils.hpp>
+
+#include "resourcemanager/deviceregistry.hpp"
+
+using namespace testing;
+
+namespace aos::sm::resourcemanager {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/***********************************************************************************************************************
+ * Consts
+ **********************************************************************************************************************/
+
+constexpr auto cTestDevicesDir = "test_dir/devices";
+constexpr auto cWaitTimeout    = std::chrono::seconds(5);
+
+/***********************************************************************************************************************
+ * Utils
+ **********************************************************************************************************************/
+
+void CreateCharDevice(const fs::path& path)
+{
+    ASSERT_EQ(mknod(path.c_str(), S_IFCHR | 0600, makedev(1, 3)), 0);
+}
+
+bool WaitFor(const std::function<bool()>& condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + cWaitTimeout;
+
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return true;
+}
+
+} // namespace
+
+/***********************************************************************************************************************
+ * Suite
+ **********************************************************************************************************************/
+
+class DeviceRegistryTest : public Test {
+public:
+    void SetUp() override
+    {
+        test::InitLog();
+
+        fs::remove_all(cTestDevicesDir);
+        fs::create_directories(fs::path(cTestDevicesDir) / "group");
+
+        CreateCharDevice(fs::path(cTestDevicesDir) / "group" / "dev0");
+    }
+
+    void TearDown() override
+    {
+        mDeviceRegistry.Stop();
+
+        fs::remove_all(cTestDevicesDir);
+    }
+
+    DeviceRegistry mDeviceRegistry;
+};
+
+/***********************************************************************************************************************
+ * Tests
+ **********************************************************************************************************************/
+
+TEST_F(DeviceRegistryTest, GetDevices)
+{
+    ASSERT_TRUE(mDeviceRegistry.Init(cTestDevicesDir).IsNone());
+
+    const auto devicePath = fs::path(cTestDevicesDir) / "group" / "dev0";
+
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(devicePath));
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(fs::path(cTestDevicesDir) / "group/"));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(fs::path(cTestDevicesDir) / "unknown"));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(cTestDevicesDir));
+
+    std::vector<oci::LinuxDevice> devices;
+
+    auto err = mDeviceRegistry.GetDevices(fs::path(cTestDevicesDir) / "group", devices);
+    ASSERT_TRUE(err.IsNone()) << test::ErrorToStr(err);
+
+    ASSERT_EQ(devices.size(), 1);
+    EXPECT_EQ(devices[0].mPath, devicePath.c_str());
+    EXPECT_EQ(devices[0].mType, "c");
+    EXPECT_EQ(devices[0].mMajor, 1);
+    EXPECT_EQ(devices[0].mMinor, 3);
+    EXPECT_EQ(devices[0].mFileMode, 0600u);
+
+    EXPECT_TRUE(mDeviceRegistry.GetDevices(fs::path(cTestDevicesDir) / "unknown", devices).Is(ErrorEnum::eNotFound));
+}
+
+TEST_F(DeviceRegistryTest, TrackDeviceChanges)
+{
+    ASSERT_TRUE(mDeviceRegistry.Init(cTestDevicesDir).IsNone());
+    ASSERT_TRUE(mDeviceRegistry.Start().IsNone());
+
+    const auto newDir    = fs::path(cTestDevicesDir) / "new";
+    const auto newDevice = newDir / "dev1";
+
+    fs::create_directories(newDir);
+
+    CreateCharDevice(newDevice);
+
+    EXPECT_TRUE(WaitFor([&]() { return mDeviceRegistry.HasDevice(newDevice); }));
+
+    std::vector<oci::LinuxDevice> devices;
+
+    EXPECT_TRUE(mDeviceRegistry.GetDevices(cTestDevicesDir, devices).IsNone());
+    EXPECT_EQ(devices.size(), 2);
+
+    fs::remove_all(newDir);
+
+    EXPECT_TRUE(WaitFor([&]() { return !mDeviceRegistry.HasDevice(newDevice); }));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(newDir));
+
+    fs::remove(fs::path(cTestDevicesDir) / "group" / "dev0");
+
+    EXPECT_TRUE(WaitFor([&]() { return !mDeviceRegistry.HasDevice(fs::path(cTestDevicesDir) / "group" / "dev0"); }));
+
+    EXPECT_TRUE(mDeviceRegistry.Stop().IsNone());
+}
+
+TEST_F(DeviceRegistryTest, HasDeviceOnlyForDeviceNodes)
+{
+    const auto pipePath  = fs::path(cTestDevicesDir) / "pipes" / "pipe0";
+    const auto filePath  = fs::path(cTestDevicesDir) / "files" / "file0";
+    const auto groupLink = fs::path(cTestDevicesDir) / "link";
+
+    fs::create_directories(pipePath.parent_path());
+    fs::create_directories(filePath.parent_path());
+
+    ASSERT_EQ(mkfifo(pipePath.c_str(), 0600), 0);
+    std::ofstream(filePath.c_str()) << "file";
+    fs::create_directory_symlink("group", groupLink);
+
+    ASSERT_TRUE(mDeviceRegistry.Init(cTestDevicesDir).IsNone());
+
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(pipePath));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(pipePath.parent_path()));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(filePath));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(filePath.parent_path()));
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(groupLink));
+}
+
+TEST_F(DeviceRegistryTest, UnwatchedDirs)
+{
+    const auto shmDir = fs::path(cTestDevicesDir) / "shm";
+    const auto ptsDir = fs::path(cTestDevicesDir) / "pts";
+
+    fs::create_directories(shmDir);
+    fs::create_directories(ptsDir);
+
+    std::ofstream((shmDir / "segment").c_str()) << "data";
+    CreateCharDevice(ptsDir / "0");
+
+    ASSERT_TRUE(mDeviceRegistry.Init(cTestDevicesDir).IsNone());
+    ASSERT_TRUE(mDeviceRegistry.Start().IsNone());
+
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(shmDir));
+    EXPECT_FALSE(mDeviceRegistry.HasDevice(shmDir / "segment"));
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(ptsDir));
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(ptsDir / "0"));
+
+    // Unwatched dirs are read on request
+    CreateCharDevice(ptsDir / "1");
+
+    EXPECT_TRUE(mDeviceRegistry.HasDevice(ptsDir / "1"));
+
+    std::vector<oci::LinuxDevice> devices;
+
+    auto err = mDeviceRegistry.GetDevices(ptsDir, devices);
+    ASSERT_TRUE(err.IsNone()) << test::ErrorToStr(err);
+
+    EXPECT_EQ(devices.size(), 2);
+
+    EXPECT_TRUE(mDeviceRegistry.Stop().IsNone());
+}
+
+} // namespace aos::sm::resourcemanager
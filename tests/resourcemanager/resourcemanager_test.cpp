@@ -17,8 +17,14 @@ namespace aos::sm::resourcemanager {
 
 class ResourcemanagerTest : public Test {
 public:
-    void SetUp() override { test::InitLog(); }
+    void SetUp() override
+    {
+        test::InitLog();
 
+        ASSERT_TRUE(mDeviceRegistry.Init().IsNone());
+    }
+
+    DeviceRegistry    mDeviceRegistry;
     HostDeviceManager mHostDeviceManager;
 };
 
@@ -28,7 +34,7 @@ public:
 
 TEST_F(ResourcemanagerTest, CheckDevice)
 {
-    ASSERT_TRUE(mHostDeviceManager.Init().IsNone());
+    ASSERT_TRUE(mHostDeviceManager.Init(mDeviceRegistry).IsNone());
 
     auto err = mHostDeviceManager.CheckDevice("/dev/null");
     EXPECT_TRUE(err.IsNone()) << test::ErrorToStr(err);
@@ -39,21 +45,21 @@ TEST_F(ResourcemanagerTest, CheckDevice)
 
 TEST_F(ResourcemanagerTest, CheckDeviceReturnsNotFound)
 {
-    ASSERT_TRUE(mHostDeviceManager.Init().IsNone());
+    ASSERT_TRUE(mHostDeviceManager.Init(mDeviceRegistry).IsNone());
 
     EXPECT_TRUE(mHostDeviceManager.CheckDevice("not found test folder").Is(ErrorEnum::eNotFound));
 }
 
 TEST_F(ResourcemanagerTest, CheckGroup)
 {
-    ASSERT_TRUE(mHostDeviceManager.Init().IsNone());
+    ASSERT_TRUE(mHostDeviceManager.Init(mDeviceRegistry).IsNone());
 
     EXPECT_TRUE(mHostDeviceManager.CheckGroup("root").IsNone());
 }
 
 TEST_F(ResourcemanagerTest, CheckGroupReturnsNotFound)
 {
-    ASSERT_TRUE(mHostDeviceManager.Init().IsNone());
+    ASSERT_TRUE(mHostDeviceManager.Init(mDeviceRegistry).IsNone());
 
     EXPECT_TRUE(mHostDeviceManager.CheckGroup("not found test group").Is(ErrorEnum::eNotFound));
 }